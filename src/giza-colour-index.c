@@ -445,6 +445,36 @@ giza_get_colour_index_range (int *cimin, int *cimax)
   *cimax = _giza_colour_index_max;
 }
 
+/**
+ * Internal routine to fill a lookup table of packed cairo ARGB32 pixels
+ * for colour indices cimin..cimax, so that image rendering does not need
+ * to query (and convert) the colour representation for every pixel.
+ * Entries are indexed by colour index and are fully opaque; callers that
+ * need a different alpha replace the top byte.
+ *
+ * Input:
+ *  -cimin :- lowest colour index to fill
+ *  -cimax :- highest colour index to fill
+ *  -lut   :- table of at least GIZA_COLOUR_INDEX_MAX+1 entries
+ */
+void
+_giza_colour_index_to_argb (int cimin, int cimax, uint32_t *lut)
+{
+  int ci;
+
+  if (cimin < GIZA_COLOUR_INDEX_MIN) cimin = GIZA_COLOUR_INDEX_MIN;
+  if (cimax > GIZA_COLOUR_INDEX_MAX) cimax = GIZA_COLOUR_INDEX_MAX;
+
+  for (ci = cimin; ci <= cimax; ci++)
+    {
+      /* same truncation as the per-pixel conversion in giza-render.c */
+      lut[ci] = ((uint32_t) 255 << 24)
+              | ((uint32_t) (unsigned char) (colourIndex[ci][0] * 255.) << 16)
+              | ((uint32_t) (unsigned char) (colourIndex[ci][1] * 255.) << 8)
+              |  (uint32_t) (unsigned char) (colourIndex[ci][2] * 255.);
+    }
+}
+
 /**
  * Settings: giza_set_range_as_colour_table
  *
@@ -22,9 +22,16 @@
  *      Daniel Price <daniel.price@monash.edu> (main contact)
  */
 
+#include <stdint.h>
+
 #define GIZA_CTAB_SAVE_MAX 10
 #define GIZA_CTAB_MAXSIZE 256
 
+/* entries in the colour table sampled for continuous colour images; also
+ * sizes the tables of pixels used by the image code, so must exceed
+ * GIZA_COLOUR_INDEX_MAX */
+#define GIZA_CTAB_LUT_SIZE 4096
+
 typedef struct
 {
   int n;
@@ -36,6 +43,8 @@ typedef struct
 
 void _giza_set_range_from_colour_table (int cimin, int cimax);
 void _giza_init_colour_index (void);
+void _giza_colour_index_to_argb (int cimin, int cimax, uint32_t *lut);
+const uint32_t *_giza_colour_table_argb (void);
 void _giza_init_colour_table (void);
 void _giza_free_colour_table (void);
 void _giza_hls_to_rgb (double hue, double lightness, double saturation,
@@ -33,6 +33,25 @@ static giza_ctab _giza_colour_table;
 static giza_ctab _giza_saved_colour_tables[GIZA_CTAB_SAVE_MAX];
 static int _giza_save_ctab_ncalls;
 
+/* the colour table sampled for continuous colour images, see
+ * _giza_colour_table_argb; rebuilt when first needed after a change */
+static uint32_t _giza_colour_table_lut[GIZA_CTAB_LUT_SIZE];
+static int _giza_colour_table_lut_valid;
+
+/* For each of GIZA_CTAB_NBUCKETS equal slices of the range of control
+ * points, a control point at or below the first one above any position in
+ * the slice, so that lookups scan forward over a handful of points at
+ * most; rebuilt when first needed after a change. Tables whose control
+ * points decrease somewhere are searched from the start as before. */
+#define GIZA_CTAB_NBUCKETS (4*GIZA_CTAB_MAXSIZE)
+static int _giza_colour_table_bucket[GIZA_CTAB_NBUCKETS];
+static double _giza_colour_table_bucket_scale;
+static int _giza_colour_table_sorted;
+static int _giza_colour_table_bucket_valid;
+
+static void _giza_colour_table_changed (void);
+static void _giza_rgb_lookup (double pos, double *red, double *green, double *blue);
+
 /**
  * Settings: giza_set_colour_table
  *
@@ -108,6 +127,7 @@ giza_set_colour_table (const double *controlPoints, const double *red, const dou
     }
 
   _giza_colour_table.n = tmpn;
+  _giza_colour_table_changed ();
    if (tmpn < n)
    {
        /* require at least two valid control points in our table to remain! */
@@ -177,60 +197,176 @@ giza_rgb_from_table (double pos, double *red, double *green, double *blue)
   if (!_giza_check_device_ready ("giza_rgb_from_table"))
     return;
 
-  *red = -1.;
+  _giza_rgb_lookup (pos, red, green, blue);
+}
+
+/**
+ * Settings: giza_rgb_from_table_array
+ *
+ * Synopsis: Same functionality as giza_rgb_from_table for an array of positions
+ *
+ * Looking up many colours this way costs the same for each whatever the
+ * number of control points in the colour table.
+ *
+ * Input:
+ *  -n     :- The number of positions
+ *  -pos   :- The fractions along the table to retrieve the colours from
+ *  -red   :- Gets set to the red components of the colours at pos
+ *  -green :- Gets set to the green components of the colours at pos
+ *  -blue  :- Gets set to the blue components of the colours at pos
+ *
+ * See Also: giza_rgb_from_table, giza_set_colour_table
+ */
+void
+giza_rgb_from_table_array (int n, const double *pos, double *red, double *green, double *blue)
+{
+  int k;
+
+  if (!_giza_check_device_ready ("giza_rgb_from_table_array"))
+    return;
+
+  for (k = 0; k < n; k++)
+    _giza_rgb_lookup (pos[k], &red[k], &green[k], &blue[k]);
+}
+
+/**
+ * Settings: giza_rgb_from_table_array_float
+ *
+ * Synopsis: Same functionality as giza_rgb_from_table_array but takes floats
+ *
+ * See Also: giza_rgb_from_table_array
+ */
+void
+giza_rgb_from_table_array_float (int n, const float *pos, float *red, float *green, float *blue)
+{
+  double dred, dgreen, dblue;
+  int k;
+
+  if (!_giza_check_device_ready ("giza_rgb_from_table_array_float"))
+    return;
+
+  for (k = 0; k < n; k++)
+    {
+      _giza_rgb_lookup ((double) pos[k], &dred, &dgreen, &dblue);
+      red[k]   = (float) dred;
+      green[k] = (float) dgreen;
+      blue[k]  = (float) dblue;
+    }
+}
+
+/**
+ * Forgets everything worked out from the colour table, after it changes
+ */
+static void
+_giza_colour_table_changed (void)
+{
+  _giza_colour_table_lut_valid = 0;
+  _giza_colour_table_bucket_valid = 0;
+}
+
+/**
+ * Sets up the slices of the colour table used by _giza_rgb_lookup
+ */
+static void
+_giza_colour_table_buckets (void)
+{
+  const giza_ctab *ctab = &_giza_colour_table;
+  double lo = ctab->controlPoints[0];
+  double range = ctab->controlPoints[ctab->n - 1] - lo;
+  double x;
+  int b, i, ilo, ihi;
+
+  _giza_colour_table_sorted = (range > 0.);
+  for (i = 1; i < ctab->n; i++)
+    if (ctab->controlPoints[i] < ctab->controlPoints[i - 1])
+      _giza_colour_table_sorted = 0;
+
+  if (_giza_colour_table_sorted)
+    {
+      _giza_colour_table_bucket_scale = GIZA_CTAB_NBUCKETS / range;
+      for (b = 0; b < GIZA_CTAB_NBUCKETS; b++)
+        {
+          /* binary search for the first control point above the slice
+           * below this one, which allows for rounding of the slice */
+          x = lo + (b - 1) / _giza_colour_table_bucket_scale;
+          ilo = 1;
+          ihi = ctab->n - 1;
+          while (ilo < ihi)
+            {
+              i = (ilo + ihi) / 2;
+              if (x < ctab->controlPoints[i])
+                ihi = i;
+              else
+                ilo = i + 1;
+            }
+          _giza_colour_table_bucket[b] = ilo;
+        }
+    }
+  _giza_colour_table_bucket_valid = 1;
+}
+
+/**
+ * Does the work of giza_rgb_from_table, with the same results
+ */
+static void
+_giza_rgb_lookup (double pos, double *red, double *green, double *blue)
+{
+  const giza_ctab *ctab = &_giza_colour_table;
+  int i, b;
 
-  /* find between which control points pos lies */
-  int i;
   /* If it is lower than lowest control point get the lowest colour */
-  if (pos < _giza_colour_table.controlPoints[0])
+  if (pos < ctab->controlPoints[0])
     {
-      *red   = _giza_colour_table.red[0];
-      *green = _giza_colour_table.green[0];
-      *blue  = _giza_colour_table.blue[0];
+      *red   = ctab->red[0];
+      *green = ctab->green[0];
+      *blue  = ctab->blue[0];
       return;
     }
   /* If it is higher than the highest control point get the highest colour */
-  if (pos >= _giza_colour_table.controlPoints[_giza_colour_table.n - 1])
+  if (pos >= ctab->controlPoints[ctab->n - 1])
     {
-      *red = _giza_colour_table.red[_giza_colour_table.n - 1];
-      *green = _giza_colour_table.green[_giza_colour_table.n - 1];
-      *blue = _giza_colour_table.blue[_giza_colour_table.n - 1];
+      *red   = ctab->red[ctab->n - 1];
+      *green = ctab->green[ctab->n - 1];
+      *blue  = ctab->blue[ctab->n - 1];
       return;
     }
-  /* Otherwise look in the table */
-  for (i = 1; i < _giza_colour_table.n; i++)
+  /* this should never happen (but DOES if pos is NaN or otherwise ill-defined) */
+  if (!(pos == pos))
     {
-      if (pos < _giza_colour_table.controlPoints[i])
-       {
-         double fraction, d_giza_colour_table;
-         /* find where between the two control points pos lies */
-         d_giza_colour_table = (_giza_colour_table.controlPoints[i] - _giza_colour_table.controlPoints[i - 1]);
-         if (fabs (d_giza_colour_table) > GIZA_TINY)
-           {
-             fraction = (pos - _giza_colour_table.controlPoints[i - 1]) / d_giza_colour_table;
-           }
-         else
-           {
-             fraction = 1.;
-           }
-         /* set the r,g,b using this fraction */
-         *red = _giza_colour_table.red[i - 1] + fraction * (_giza_colour_table.red[i] - _giza_colour_table.red[i - 1]);
-         *green =
-           _giza_colour_table.green[i - 1] + fraction * (_giza_colour_table.green[i] -
-                                       _giza_colour_table.green[i - 1]);
-         *blue =
-           _giza_colour_table.blue[i - 1] + fraction * (_giza_colour_table.blue[i] - _giza_colour_table.blue[i - 1]);
-         return;
-       }
+      *red   = 0.;
+      *green = 0.;
+      *blue  = 0.;
+      return;
     }
 
-   /* this should never happen (but DOES if pos is NaN or otherwise ill-defined) */
-   if (*red < 0.)
-     {
-      *red = 0.;
-      *green = 0.;
-      *blue = 0.;
+  /* Otherwise find between which control points pos lies */
+  if (!_giza_colour_table_bucket_valid)
+    _giza_colour_table_buckets ();
+  i = 1;
+  if (_giza_colour_table_sorted)
+    {
+      b = (int) ((pos - ctab->controlPoints[0]) * _giza_colour_table_bucket_scale);
+      if (b >= GIZA_CTAB_NBUCKETS) b = GIZA_CTAB_NBUCKETS - 1;
+      if (b > 0) i = _giza_colour_table_bucket[b];
+    }
+  while (!(pos < ctab->controlPoints[i]))
+    i++;
+
+  double fraction, d_giza_colour_table;
+  /* find where between the two control points pos lies */
+  d_giza_colour_table = (ctab->controlPoints[i] - ctab->controlPoints[i - 1]);
+  if (fabs (d_giza_colour_table) > GIZA_TINY)
+    {
+      fraction = (pos - ctab->controlPoints[i - 1]) / d_giza_colour_table;
+    }
+  else
+    {
+      fraction = 1.;
     }
+  /* set the r,g,b using this fraction */
+  *red   = ctab->red[i - 1]   + fraction * (ctab->red[i]   - ctab->red[i - 1]);
+  *green = ctab->green[i - 1] + fraction * (ctab->green[i] - ctab->green[i - 1]);
+  *blue  = ctab->blue[i - 1]  + fraction * (ctab->blue[i]  - ctab->blue[i - 1]);
 }
 
 /**
@@ -245,13 +381,98 @@ giza_rgb_from_table_float (float pos, float *red, float *green, float *blue)
 {
   double dred, dgreen, dblue;
 
-  giza_rgb_from_table ((double) pos, &dred, &dgreen, &dblue);
+  if (!_giza_check_device_ready ("giza_rgb_from_table_float"))
+    return;
+
+  _giza_rgb_lookup ((double) pos, &dred, &dgreen, &dblue);
 
   *red   = (float) dred;
   *green = (float) dgreen;
   *blue  = (float) dblue;
 }
 
+/**
+ * Returns the colour table sampled at GIZA_CTAB_LUT_SIZE evenly spaced
+ * positions from 0 to 1, as packed opaque cairo ARGB32 pixels. This is what
+ * images are coloured from in continuous colour mode.
+ */
+const uint32_t *
+_giza_colour_table_argb (void)
+{
+  double r, g, b;
+  int k;
+
+  if (!_giza_colour_table_lut_valid)
+    {
+      for (k = 0; k < GIZA_CTAB_LUT_SIZE; k++)
+        {
+          _giza_rgb_lookup (k/(GIZA_CTAB_LUT_SIZE - 1.), &r, &g, &b);
+          /* same truncation as _giza_colour_index_to_argb */
+          _giza_colour_table_lut[k] = ((uint32_t) 255 << 24)
+                                    | ((uint32_t) (unsigned char) (r * 255.) << 16)
+                                    | ((uint32_t) (unsigned char) (g * 255.) << 8)
+                                    |  (uint32_t) (unsigned char) (b * 255.);
+        }
+      _giza_colour_table_lut_valid = 1;
+    }
+  return _giza_colour_table_lut;
+}
+
+/**
+ * Settings: giza_set_image_colour_mode
+ *
+ * Synopsis: Sets how images drawn with giza_render are coloured
+ *
+ * By default the transfer function maps each data value to one of the
+ * colour indices in the range set by giza_set_colour_index_range, so an
+ * image has at most that many colours. In continuous mode the values are
+ * mapped straight onto the colour table instead, sampled finely enough
+ * to give smooth gradients, at the same cost per pixel. Colours set for
+ * individual indices with giza_set_colour_representation are then not
+ * used, and with giza_render_transparent only values at the very bottom
+ * of the table are transparent.
+ *
+ * Input:
+ *  -mode :- the colour mode
+ *
+ * Allowed modes:
+ *  -0 or GIZA_COLOUR_MODE_INDEXED    :- colour from the colour index range (default)
+ *  -1 or GIZA_COLOUR_MODE_CONTINUOUS :- colour from the colour table
+ *
+ * See Also: giza_get_image_colour_mode, giza_set_colour_table, giza_render
+ */
+void
+giza_set_image_colour_mode (int mode)
+{
+  if (!_giza_check_device_ready ("giza_set_image_colour_mode"))
+    return;
+  if (mode != GIZA_COLOUR_MODE_INDEXED && mode != GIZA_COLOUR_MODE_CONTINUOUS)
+    {
+      _giza_warning ("giza_set_image_colour_mode",
+                     "Invalid image colour mode, not set");
+      return;
+    }
+  Dev[id].colourmode = mode;
+}
+
+/**
+ * Settings: giza_get_image_colour_mode
+ *
+ * Synopsis: Queries how images are coloured
+ *
+ * Output:
+ *  -mode :- the current mode
+ *
+ * See Also: giza_set_image_colour_mode
+ */
+void
+giza_get_image_colour_mode (int *mode)
+{
+  if (!_giza_check_device_ready ("giza_get_image_colour_mode"))
+    return;
+  *mode = Dev[id].colourmode;
+}
+
 /**
  * Sets up memory for the main colour table and establishes a grey scale colour table
  */
@@ -312,6 +533,7 @@ giza_restore_colour_table (void)
   /* Restore the colour table from the saved array */
   int i = _giza_save_ctab_ncalls;
   _giza_colour_table = _giza_saved_colour_tables[i];
+  _giza_colour_table_changed ();
 
 }
 
@@ -335,14 +557,17 @@ void
 _giza_set_range_from_colour_table (int cimin, int cimax)
 {
   double delta = (double) (cimax - cimin);
-  double pos,r,g,b;
-  int i;
+  double pos[GIZA_COLOUR_INDEX_MAX + 1], r[GIZA_COLOUR_INDEX_MAX + 1];
+  double g[GIZA_COLOUR_INDEX_MAX + 1], b[GIZA_COLOUR_INDEX_MAX + 1];
+  int i, n = cimax - cimin + 1;
 
-  for (i = cimin; i <= cimax; i++)
-    {
-      pos = (i - cimin)/delta;
-      giza_rgb_from_table(pos,&r,&g,&b);
-      giza_set_colour_representation(i,r,g,b);
-    }
+  if (n < 1 || n > GIZA_COLOUR_INDEX_MAX + 1)
+    return;
+
+  for (i = 0; i < n; i++)
+    pos[i] = i/delta;
+  giza_rgb_from_table_array (n, pos, r, g, b);
+  for (i = 0; i < n; i++)
+    giza_set_colour_representation(cimin + i, r[i], g[i], b[i]);
 }
 
@@ -0,0 +1,301 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+/*
+ * The parts of giza-contour.c that read the data, written once for data
+ * of type GIZA_CONTOUR_T. giza-contour.c includes this file for each type
+ * it handles, with GIZA_CONTOUR_FN(name) making the name of each function
+ * for that type, so float data are contoured in place rather than copied.
+ * Values are widened to double as they are read, so the contours are the
+ * same as for a copy of the data in double precision.
+ */
+
+/* loads the data at the corners (i,j), (i+1,j), (i+1,j+1), (i,j+1) */
+static void
+GIZA_CONTOUR_FN(_giza_contour_corners) (const GIZA_CONTOUR_T *data, int sizex, int i, int j,
+                                        double *d)
+{
+  d[0] = data[j*sizex+i];
+  d[1] = data[j*sizex+(i + 1)];
+  d[2] = data[(j + 1)*sizex+(i + 1)];
+  d[3] = data[(j + 1)*sizex+i];
+}
+
+/**
+ * Collects the segments of the contour levels over the cells in rows j
+ * from jhi down to jlo, as _giza_contour_trace does. Blocks of cells that
+ * the pyramid shows no level crosses are stepped over, the biggest first,
+ * and only the levels that lie between the smallest and largest corner
+ * of a cell are tried in it, found by binary search.
+ */
+static int
+GIZA_CONTOUR_FN(_giza_contour_trace_rows) (const giza_contour_trace_t *t, int jhi, int jlo,
+                                           giza_contour_segs_t *segs)
+{
+  const GIZA_CONTOUR_T *data = t->data;
+  const double *blank = t->blank, *level = t->level;
+  const int sizex = t->sizex, i1 = t->i1;
+  const giza_contour_tier_t *tr = NULL;
+  const int *p = NULL;
+  double d[4], seg[16], temp1, temp2, dmin, dmax;
+  int i, j, l, n, lo, hi, ii, jj;
+
+  for (j = jhi; j >= jlo; j--)
+    {
+      jj = j - t->j1;
+      for (i = i1; i < t->i2; i++)
+        {
+          /* skip blocks that no level crosses */
+          ii = i - i1;
+          for (l = t->ntier - 1; l >= 0; l--)
+            {
+              tr = &t->tier[l];
+              p = tr->lohi + 2*((size_t) (jj >> tr->shift) * tr->nbx + (ii >> tr->shift));
+              if (p[1] <= p[0])
+                break;
+            }
+          if (l >= 0)
+            {
+              i = i1 + (((ii >> tr->shift) + 1) << tr->shift) - 1;
+              continue;
+            }
+          lo = (t->ntier > 0) ? p[0] : 0;
+          hi = (t->ntier > 0) ? p[1] : t->nlevel;
+
+          GIZA_CONTOUR_FN(_giza_contour_corners) (data, sizex, i, j, d);
+
+          /* skip cells where any corner is blanked */
+          if (blank && (d[0] == *blank || d[1] == *blank || d[2] == *blank || d[3] == *blank))
+            continue;
+
+          /* find the minimum and maximum values at the corners of a 1x1 box */
+          temp1 = MIN (d[0], d[3]);
+          temp2 = MIN (d[1], d[2]);
+          dmin = MIN (temp1, temp2);
+
+          temp1 = MAX (d[0], d[3]);
+          temp2 = MAX (d[1], d[2]);
+          dmax = MAX (temp1, temp2);
+
+          /* the levels in the range of the box (a NaN leaves it open) */
+          if (!isnan (dmin))
+            lo = _giza_contour_lower (level, lo, hi, dmin);
+          if (!isnan (dmax))
+            hi = _giza_contour_upper (level, lo, hi, dmax);
+
+          for (l = lo; l < hi; ++l)
+            {
+              n = _giza_conrec_cell (d, i, j, level[l], seg);
+              if (n == 0)
+                continue;
+
+              if (!_giza_contour_add_segs (&segs[t->index[l]], seg, n))
+                return 0;
+            }
+        }
+    }
+  return 1;
+}
+
+/* finds the levels crossing the smallest blocks in rows start..end-1 of them */
+static void
+GIZA_CONTOUR_FN(_giza_contour_tier_rows) (const giza_contour_trace_t *t, int start, int end)
+{
+  const GIZA_CONTOUR_T *data = t->data;
+  const giza_contour_tier_t *tr = &t->tier[0];
+  const int size = 1 << tr->shift;
+  double bmin, bmax, d;
+  int bi, bj, i, j, iend, jend, nan;
+  int *p;
+
+  for (bj = start; bj < end; bj++)
+    {
+      jend = MIN (t->j1 + (bj + 1)*size, t->j2);
+      for (bi = 0; bi < tr->nbx; bi++)
+        {
+          iend = MIN (t->i1 + (bi + 1)*size, t->i2);
+          bmin = HUGE_VAL;
+          bmax = -HUGE_VAL;
+          nan = 0;
+          for (j = t->j1 + bj*size; j <= jend; j++)
+            for (i = t->i1 + bi*size; i <= iend; i++)
+              {
+                d = data[j*t->sizex+i];
+                if (isnan (d))
+                  nan = 1;
+                if (d < bmin)
+                  bmin = d;
+                if (d > bmax)
+                  bmax = d;
+              }
+          p = tr->lohi + 2*((size_t) bj * tr->nbx + bi);
+          if (nan)
+            {
+              /* the cells decide for themselves */
+              p[0] = 0;
+              p[1] = t->nlevel;
+            }
+          else
+            {
+              p[0] = _giza_contour_lower (t->level, 0, t->nlevel, bmin);
+              p[1] = _giza_contour_upper (t->level, p[0], t->nlevel, bmax);
+            }
+        }
+    }
+}
+
+/* whether the cell at (i,j) lies outside the cells being filled, has a
+ * NaN corner, or covers none of the region from lo to hi */
+static int
+GIZA_CONTOUR_FN(_giza_contour_fill_empty) (const giza_contour_trace_t *t, int i, int j,
+                                           double lo, double hi)
+{
+  double d[4], px[12], py[12];
+  int mask[12];
+
+  if (i < t->i1 || i >= t->i2 || j < t->j1 || j >= t->j2)
+    return 1;
+  GIZA_CONTOUR_FN(_giza_contour_corners) (t->data, t->sizex, i, j, d);
+  if (isnan (d[0]) || isnan (d[1]) || isnan (d[2]) || isnan (d[3]))
+    return 1;
+  return _giza_contour_fill_flat (_giza_contour_fill_cell (d, i, j, lo, hi, px, py, mask), mask);
+}
+
+/**
+ * Collects the boundary edges of the regions between successive levels
+ * over the cells in rows j from jhi down to jlo, as _giza_contour_fill_trace
+ * does. The polygon of each region in each cell is found, and of its edges
+ * only those crossing the cell are kept, along with those on a side of the
+ * cell that the next cell does not share; the rest would meet an edge
+ * going the other way and so lie inside the region.
+ */
+static int
+GIZA_CONTOUR_FN(_giza_contour_fill_rows) (const giza_contour_trace_t *t, int jhi, int jlo,
+                                          giza_contour_segs_t *edges)
+{
+  static const int di[4] = { 0, 1, 0, -1 };
+  static const int dj[4] = { -1, 0, 1, 0 };
+  const double *level = t->level;
+  double d[4], px[12], py[12], seg[48], temp1, temp2, dmin, dmax;
+  int mask[12];
+  int i, j, b, lo, hi, np, k, n, e, side, nseg;
+
+  for (j = jhi; j >= jlo; j--)
+    {
+      for (i = t->i1; i < t->i2; i++)
+        {
+          GIZA_CONTOUR_FN(_giza_contour_corners) (t->data, t->sizex, i, j, d);
+
+          /* cells with a NaN corner are left unfilled */
+          if (isnan (d[0]) || isnan (d[1]) || isnan (d[2]) || isnan (d[3]))
+            continue;
+
+          temp1 = MIN (d[0], d[3]);
+          temp2 = MIN (d[1], d[2]);
+          dmin = MIN (temp1, temp2);
+
+          temp1 = MAX (d[0], d[3]);
+          temp2 = MAX (d[1], d[2]);
+          dmax = MAX (temp1, temp2);
+
+          /* the regions the values of the cell reach into */
+          lo = MAX (_giza_contour_lower (level, 0, t->nlevel, dmin) - 1, 0);
+          hi = MIN (_giza_contour_upper (level, lo, t->nlevel, dmax), t->nlevel - 1);
+
+          for (b = lo; b < hi; b++)
+            {
+              np = _giza_contour_fill_cell (d, i, j, level[b], level[b+1], px, py, mask);
+              if (_giza_contour_fill_flat (np, mask))
+                continue;
+
+              nseg = 0;
+              for (k = 0; k < np; k++)
+                {
+                  n = (k + 1) % np;
+                  if (px[k] == px[n] && py[k] == py[n])
+                    continue;
+
+                  /* an edge along a side of the cell is kept only if the
+                   * next cell has nothing of the region there */
+                  side = mask[k] & mask[n];
+                  if (side)
+                    {
+                      for (e = 0; !(side & (1 << e)); e++)
+                        ;
+                      if (!GIZA_CONTOUR_FN(_giza_contour_fill_empty) (t, i + di[e], j + dj[e],
+                                                                      level[b], level[b+1]))
+                        continue;
+                    }
+                  seg[4*nseg] = px[k];
+                  seg[4*nseg+1] = py[k];
+                  seg[4*nseg+2] = px[n];
+                  seg[4*nseg+3] = py[n];
+                  nseg++;
+                }
+              if (nseg > 0 && !_giza_contour_add_segs (&edges[b], seg, nseg))
+                return 0;
+            }
+        }
+    }
+  return 1;
+}
+
+/**
+ * Moves the points of lines from grid coordinates to the world coordinates
+ * that x and y give at each point of the data, interpolating bilinearly
+ * within the cell between i1..i2, j1..j2 that holds the point. Points on
+ * the side of a cell come out the same from either cell, so the lines are
+ * continuous however the grid is curved.
+ */
+static void
+GIZA_CONTOUR_FN(_giza_contour_map) (const GIZA_CONTOUR_T *x, const GIZA_CONTOUR_T *y,
+                                    int sizex, int i1, int i2, int j1, int j2,
+                                    giza_contour_lines_t *lines)
+{
+  double fi, fj, u, v, c[4], a, b, wx;
+  size_t n;
+  int i, j;
+
+  for (n = 0; n < lines->npts; n++)
+    {
+      /* data point i is at i+0.5 in grid coordinates */
+      fi = lines->xy[2*n] - 0.5;
+      fj = lines->xy[2*n+1] - 0.5;
+      i = (int) floor (fi);
+      j = (int) floor (fj);
+      i = MAX (i1, MIN (i, i2 - 1));
+      j = MAX (j1, MIN (j, j2 - 1));
+      u = fi - i;
+      v = fj - j;
+
+      GIZA_CONTOUR_FN(_giza_contour_corners) (x, sizex, i, j, c);
+      a = c[0] + u*(c[1] - c[0]);
+      b = c[3] + u*(c[2] - c[3]);
+      wx = a + v*(b - a);
+
+      GIZA_CONTOUR_FN(_giza_contour_corners) (y, sizex, i, j, c);
+      a = c[0] + u*(c[1] - c[0]);
+      b = c[3] + u*(c[2] - c[3]);
+      lines->xy[2*n] = wx;
+      lines->xy[2*n+1] = a + v*(b - a);
+    }
+}
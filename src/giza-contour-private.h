@@ -0,0 +1,71 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+#ifndef GIZA_CONTOUR_PRIVATE_H
+#define GIZA_CONTOUR_PRIVATE_H
+
+#include <stddef.h>
+#include <cairo/cairo.h>
+
+/* the least number of grid cells worth tracing in a band of its own */
+#define GIZA_CONTOUR_BAND_CELLS 16384
+
+/* blocks of the pyramid used to skip cells that no contour crosses are
+ * 2^(GIZA_CONTOUR_BLOCK_SHIFT*(l+1)) cells a side in tier l */
+#define GIZA_CONTOUR_BLOCK_SHIFT 3
+#define GIZA_CONTOUR_MAX_TIERS 6
+
+/* the segments of one contour level, in grid coordinates */
+typedef struct
+{
+  double *xy;                 /* x1, y1, x2, y2 for each segment */
+  size_t nseg, maxseg;
+} giza_contour_segs_t;
+
+/* the segments of one contour level joined into polylines: points
+ * start[k]..start[k+1]-1 of xy make polyline k, which is a closed ring if
+ * its first and last points are the same */
+typedef struct
+{
+  double *xy;                 /* x, y for each point */
+  size_t *start;              /* nline+1 entries */
+  size_t npts, nline, maxpts, maxline;
+} giza_contour_lines_t;
+
+int  _giza_contour_trace (int sizex, int type, const void *data, int i1, int i2, int j1, int j2,
+                          int ncont, const double *cont, const double *blank,
+                          giza_contour_segs_t *segs);
+int  _giza_contour_extract (int sizex, int type, const void *data, int i1, int i2, int j1,
+                            int j2, int ncont, const double *cont, const double *blank,
+                            giza_contour_segs_t *work, giza_contour_lines_t *lines);
+int  _giza_contour_fill_trace (int sizex, int type, const void *data, int i1, int i2,
+                               int j1, int j2, int nlevel, const double *level,
+                               giza_contour_segs_t *edges);
+int  _giza_contour_add_segs (giza_contour_segs_t *segs, const double *seg, size_t n);
+int  _giza_contour_stitch (const giza_contour_segs_t *segs, giza_contour_lines_t *lines);
+int  _giza_contour_rings (const giza_contour_segs_t *edges, giza_contour_lines_t *rings);
+int  _giza_contour_line_closed (const giza_contour_lines_t *lines, size_t k);
+void _giza_contour_free_lines (giza_contour_lines_t *lines);
+void _giza_contour_path (const giza_contour_lines_t *lines, const cairo_matrix_t *mat);
+void _giza_contour_stroke (int ncont_in, const double *cont, const giza_contour_lines_t *lines,
+                           const cairo_matrix_t *mat);
+
+#endif
@@ -0,0 +1,392 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+/*
+ * Contour sets: the contours of some data found once, joined into
+ * polylines and kept in world coordinates, so that they can be redrawn
+ * on any device, or read back, without tracing the data again.
+ */
+
+#include "giza-io-private.h"
+#include "giza-private.h"
+#include "giza-transforms-private.h"
+#include "giza-contour-private.h"
+#include <giza.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+  int ncont;                  /* as given to giza_contour_extract */
+  double *cont;
+  giza_contour_lines_t *lines; /* abs(ncont) levels, in world coordinates */
+} giza_contour_set_t;
+
+static giza_contour_set_t **_giza_contour_sets = NULL;
+static int _giza_ncontour_sets = 0;
+
+static int _giza_contour_set_new (const char *caller, int sizex, int type, const void *data,
+                                  int i1, int i2, int j1, int j2, int ncont,
+                                  const double *cont, const double *affine);
+static giza_contour_set_t *_giza_contour_set_get (const char *caller, int set);
+static void _giza_contour_set_free (giza_contour_set_t *cs);
+
+/**
+ * Drawing: giza_contour_extract
+ *
+ * Synopsis: Finds the contours of data as giza_contour would draw them and
+ * keeps them as a contour set, to be drawn with giza_draw_contour_set.
+ *
+ * The contours of each level are joined into polylines and mapped to world
+ * coordinates by affine, so the data need not be kept and redrawing the
+ * set, on this or any other device, does not trace the data again. No
+ * device need be open.
+ *
+ * Input:
+ *  -sizex  :- The dimensions of data in the x-direction
+ *  -sizey  :- The dimensions of data in the y-direction
+ *  -data   :- The data to be contoured
+ *  -i1,i2  :- Inclusive range of data to use in the x dimension
+ *  -j1,j2  :- Inclusive range of data to use in the y dimension
+ *  -ncont  :- The number of contour levels, negative to draw them all in the
+ *             current line style, as for giza_contour
+ *  -cont   :- The contour levels
+ *  -affine :- Affine transformation from pixel indices to world coordinates
+ *
+ * Return value:
+ *  -A positive handle for the contour set, or 0 on failure
+ *
+ * See Also: giza_draw_contour_set, giza_get_contour_set_line,
+ *  giza_free_contour_set, giza_contour
+ */
+int
+giza_contour_extract (int sizex, int sizey, const double* data, int i1,
+             int i2, int j1, int j2, int ncont, const double* cont,
+             const double *affine)
+{
+  return _giza_contour_set_new ("giza_contour_extract", sizex, GIZA_DATA_DOUBLE, data,
+                                i1, i2, j1, j2, ncont, cont, affine);
+}
+
+/**
+ * Drawing: giza_contour_extract_float
+ *
+ * Synopsis: Same functionality as giza_contour_extract but takes floats.
+ *
+ * See Also: giza_contour_extract
+ */
+int
+giza_contour_extract_float (int sizex, int sizey, const float* data, int i1,
+             int i2, int j1, int j2, int ncont, const float* cont,
+             const float *affine)
+{
+  double daffine[6], *dcont;
+  int k, set;
+
+  dcont = malloc ((size_t) abs (ncont) * sizeof (double) + 1);
+  if (!dcont)
+    {
+      _giza_warning ("giza_contour_extract_float", "Allocation failed, contours not extracted.");
+      return 0;
+    }
+  for (k = 0; k < abs (ncont); k++)
+    dcont[k] = (double) cont[k];
+  for (k = 0; k < 6; k++)
+    daffine[k] = (double) affine[k];
+
+  set = _giza_contour_set_new ("giza_contour_extract_float", sizex, GIZA_DATA_FLOAT, data,
+                               i1, i2, j1, j2, ncont, dcont, daffine);
+  free (dcont);
+  return set;
+}
+
+/**
+ * Drawing: giza_draw_contour_set
+ *
+ * Synopsis: Draws the contours of a contour set, as giza_contour drew them
+ * when the set was extracted, in the current line width and colour.
+ *
+ * Input:
+ *  -set :- The contour set handle, from giza_contour_extract
+ *
+ * See Also: giza_contour_extract, giza_contour
+ */
+void
+giza_draw_contour_set (int set)
+{
+  giza_contour_set_t *cs;
+  cairo_matrix_t mat;
+
+  if (!_giza_check_device_ready ("giza_draw_contour_set"))
+    return;
+  cs = _giza_contour_set_get ("giza_draw_contour_set", set);
+  if (!cs)
+    return;
+
+  int oldBuf;
+  giza_get_buffering(&oldBuf);
+  giza_begin_buffer ();
+
+  /* the lines are in world coordinates already */
+  int oldTrans = _giza_get_trans ();
+  _giza_set_trans (GIZA_TRANS_WORLD);
+  cairo_get_matrix (Dev[id].context, &mat);
+  _giza_set_trans (GIZA_TRANS_IDEN);
+
+  _giza_contour_stroke (cs->ncont, cs->cont, cs->lines, &mat);
+
+  _giza_set_trans (oldTrans);
+  if (!oldBuf)
+    giza_end_buffer ();
+  giza_flush_device ();
+}
+
+/**
+ * Drawing: giza_get_contour_set_nline
+ *
+ * Synopsis: Returns the number of polylines in a level of a contour set.
+ *
+ * Input:
+ *  -set :- The contour set handle, from giza_contour_extract
+ *  -k   :- The level, from 0 to abs(ncont)-1
+ *
+ * See Also: giza_get_contour_set_line
+ */
+int
+giza_get_contour_set_nline (int set, int k)
+{
+  giza_contour_set_t *cs = _giza_contour_set_get ("giza_get_contour_set_nline", set);
+
+  if (!cs)
+    return 0;
+  if (k < 0 || k >= abs (cs->ncont))
+    {
+      _giza_warning ("giza_get_contour_set_nline", "Invalid contour level");
+      return 0;
+    }
+  return (int) cs->lines[k].nline;
+}
+
+/**
+ * Drawing: giza_get_contour_set_line
+ *
+ * Synopsis: Copies out one polyline of a contour set, in world coordinates.
+ * A closed line ends with its first point again.
+ *
+ * Input:
+ *  -set    :- The contour set handle, from giza_contour_extract
+ *  -k      :- The level, from 0 to abs(ncont)-1
+ *  -line   :- The polyline, from 0 to giza_get_contour_set_nline(set,k)-1
+ *  -maxpts :- The size of x and y; at most this many points are copied
+ *
+ * Output:
+ *  -x, y :- The points of the line
+ *
+ * Return value:
+ *  -The number of points in the line, which may be more than maxpts, or 0
+ *   if there is no such line
+ *
+ * See Also: giza_get_contour_set_nline, giza_line
+ */
+int
+giza_get_contour_set_line (int set, int k, int line, int maxpts, double *x, double *y)
+{
+  const char *caller = "giza_get_contour_set_line";
+  giza_contour_set_t *cs = _giza_contour_set_get (caller, set);
+  const giza_contour_lines_t *lines;
+  size_t n, start, npts;
+
+  if (!cs)
+    return 0;
+  if (k < 0 || k >= abs (cs->ncont) || line < 0 || (size_t) line >= cs->lines[k].nline)
+    {
+      _giza_warning (caller, "Invalid contour level or line");
+      return 0;
+    }
+  lines = &cs->lines[k];
+  start = lines->start[line];
+  npts = lines->start[line+1] - start;
+  for (n = 0; n < npts && (int) n < maxpts; n++)
+    {
+      x[n] = lines->xy[2*(start + n)];
+      y[n] = lines->xy[2*(start + n)+1];
+    }
+  return (int) npts;
+}
+
+/**
+ * Drawing: giza_get_contour_set_line_float
+ *
+ * Synopsis: Same functionality as giza_get_contour_set_line but takes floats.
+ *
+ * See Also: giza_get_contour_set_line
+ */
+int
+giza_get_contour_set_line_float (int set, int k, int line, int maxpts, float *x, float *y)
+{
+  const char *caller = "giza_get_contour_set_line_float";
+  giza_contour_set_t *cs = _giza_contour_set_get (caller, set);
+  const giza_contour_lines_t *lines;
+  size_t n, start, npts;
+
+  if (!cs)
+    return 0;
+  if (k < 0 || k >= abs (cs->ncont) || line < 0 || (size_t) line >= cs->lines[k].nline)
+    {
+      _giza_warning (caller, "Invalid contour level or line");
+      return 0;
+    }
+  lines = &cs->lines[k];
+  start = lines->start[line];
+  npts = lines->start[line+1] - start;
+  for (n = 0; n < npts && (int) n < maxpts; n++)
+    {
+      x[n] = (float) lines->xy[2*(start + n)];
+      y[n] = (float) lines->xy[2*(start + n)+1];
+    }
+  return (int) npts;
+}
+
+/**
+ * Drawing: giza_free_contour_set
+ *
+ * Synopsis: Frees a contour set. The handle may be reused.
+ *
+ * Input:
+ *  -set :- The contour set handle, from giza_contour_extract
+ *
+ * See Also: giza_contour_extract
+ */
+void
+giza_free_contour_set (int set)
+{
+  giza_contour_set_t *cs = _giza_contour_set_get ("giza_free_contour_set", set);
+
+  if (!cs)
+    return;
+  _giza_contour_set_free (cs);
+  _giza_contour_sets[set - 1] = NULL;
+}
+
+static int
+_giza_contour_set_new (const char *caller, int sizex, int type, const void *data,
+                       int i1, int i2, int j1, int j2, int ncont,
+                       const double *cont, const double *affine)
+{
+  giza_contour_set_t *cs, **tmp;
+  cairo_matrix_t mat;
+  giza_contour_lines_t *l;
+  double *xy;
+  const int nc = abs (ncont);
+  size_t n;
+  int k, set;
+
+  cs = calloc (1, sizeof (giza_contour_set_t));
+  if (cs)
+    {
+      cs->ncont = ncont;
+      cs->cont = malloc ((size_t) nc * sizeof (double) + 1);
+      cs->lines = calloc ((size_t) nc + 1, sizeof (giza_contour_lines_t));
+    }
+  if (!cs || !cs->cont || !cs->lines)
+    {
+      _giza_warning (caller, "Allocation failed, contours not extracted.");
+      if (cs)
+        _giza_contour_set_free (cs);
+      return 0;
+    }
+  if (nc > 0)
+    memcpy (cs->cont, cont, (size_t) nc * sizeof (double));
+
+  if (nc > 0
+      && !_giza_contour_extract (sizex, type, data, i1, i2, j1, j2, nc, cont, NULL, NULL,
+                                 cs->lines))
+    {
+      _giza_warning (caller, "Allocation failed, contours not extracted.");
+      _giza_contour_set_free (cs);
+      return 0;
+    }
+
+  /* into world coordinates, keeping only the memory the lines need */
+  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
+                     affine[4], affine[5]);
+  for (k = 0; k < nc; k++)
+    {
+      l = &cs->lines[k];
+      for (n = 0; n < l->npts; n++)
+        cairo_matrix_transform_point (&mat, &l->xy[2*n], &l->xy[2*n+1]);
+      if (l->npts > 0 && l->npts < l->maxpts)
+        {
+          xy = realloc (l->xy, 2 * l->npts * sizeof (double));
+          if (xy)
+            {
+              l->xy = xy;
+              l->maxpts = l->npts;
+            }
+        }
+    }
+
+  /* reuse the handle of a freed set if there is one */
+  for (set = 0; set < _giza_ncontour_sets; set++)
+    if (!_giza_contour_sets[set])
+      break;
+  if (set == _giza_ncontour_sets)
+    {
+      tmp = realloc (_giza_contour_sets,
+                     (size_t) (_giza_ncontour_sets + 1) * sizeof (giza_contour_set_t *));
+      if (!tmp)
+        {
+          _giza_warning (caller, "Allocation failed, contours not extracted.");
+          _giza_contour_set_free (cs);
+          return 0;
+        }
+      _giza_contour_sets = tmp;
+      _giza_ncontour_sets++;
+    }
+  _giza_contour_sets[set] = cs;
+  return set + 1;
+}
+
+/* the contour set for a handle, or NULL with a warning */
+static giza_contour_set_t *
+_giza_contour_set_get (const char *caller, int set)
+{
+  if (set < 1 || set > _giza_ncontour_sets || !_giza_contour_sets[set - 1])
+    {
+      _giza_warning (caller, "Invalid contour set handle");
+      return NULL;
+    }
+  return _giza_contour_sets[set - 1];
+}
+
+static void
+_giza_contour_set_free (giza_contour_set_t *cs)
+{
+  int k;
+
+  if (cs->lines)
+    for (k = 0; k < abs (cs->ncont); k++)
+      _giza_contour_free_lines (&cs->lines[k]);
+  free (cs->lines);
+  free (cs->cont);
+  free (cs);
+}
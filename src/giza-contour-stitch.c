@@ -0,0 +1,329 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+/*
+ * Joins the two point segments that conrec finds for a contour level into
+ * polylines, and the edges of filled contour regions into rings.
+ * Neighbouring segments share an end point that is worked out from the
+ * same data values with the same arithmetic, so the points can be matched
+ * exactly through a hash table of segment ends.
+ */
+
+#include "giza-contour-private.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GIZA_CONTOUR_NONE ((size_t) -1)
+
+static size_t _giza_contour_hash (const double *p);
+
+/**
+ * Appends n segments, given as x1, y1, x2, y2 each, to segs. Returns 0 if
+ * memory ran out.
+ */
+int
+_giza_contour_add_segs (giza_contour_segs_t *segs, const double *seg, size_t n)
+{
+  double *xy;
+  size_t size;
+
+  if (segs->nseg + n > segs->maxseg)
+    {
+      size = (segs->maxseg > 0) ? 2*segs->maxseg : 256;
+      while (size < segs->nseg + n)
+        size *= 2;
+      xy = realloc (segs->xy, 4 * size * sizeof (double));
+      if (!xy)
+        return 0;
+      segs->xy = xy;
+      segs->maxseg = size;
+    }
+  memcpy (segs->xy + 4*segs->nseg, seg, 4 * n * sizeof (double));
+  segs->nseg += n;
+  return 1;
+}
+
+/* hashes the bits of the point x, y */
+static size_t
+_giza_contour_hash (const double *p)
+{
+  uint64_t a, b;
+  double x = p[0] + 0., y = p[1] + 0.;  /* -0 hashes as 0 */
+
+  memcpy (&a, &x, sizeof (a));
+  memcpy (&b, &y, sizeof (b));
+  a = (a ^ (b * UINT64_C (0x9e3779b97f4a7c15))) * UINT64_C (0xbf58476d1ce4e5b9);
+  return (size_t) (a ^ (a >> 31));
+}
+
+/**
+ * Joins the segments of segs into polylines, replacing what was in lines.
+ * Segments are taken up in the order they were found, each polyline
+ * following the segments that share its end points in both directions
+ * until none is left, so the result does not depend on hashing. Where more
+ * than two segments meet at a point (on a saddle or a flat patch exactly at
+ * the level) the extra ones begin polylines of their own.
+ *
+ * Returns 0 if memory ran out.
+ */
+int
+_giza_contour_stitch (const giza_contour_segs_t *segs, giza_contour_lines_t *lines)
+{
+  const size_t n = segs->nseg;
+  const double *xy = segs->xy;
+  size_t nbucket, mask, e, f, s, k, nback, *head, *next, *back;
+  unsigned char *used;
+  void *p;
+
+  lines->npts = 0;
+  lines->nline = 0;
+  if (n == 0)
+    return 1;
+
+  /* a polyline of m segments has m+1 points, so there are at most 2n */
+  if (lines->maxpts < 2*n)
+    {
+      p = realloc (lines->xy, 4 * n * sizeof (double));
+      if (!p)
+        return 0;
+      lines->xy = p;
+      lines->maxpts = 2*n;
+    }
+  if (lines->maxline < n + 1)
+    {
+      p = realloc (lines->start, (n + 1) * sizeof (size_t));
+      if (!p)
+        return 0;
+      lines->start = p;
+      lines->maxline = n + 1;
+    }
+
+  for (nbucket = 16; nbucket < 2*n; nbucket *= 2)
+    ;
+  mask = nbucket - 1;
+  head = malloc (nbucket * sizeof (size_t));
+  next = malloc (2 * n * sizeof (size_t));
+  back = malloc (n * sizeof (size_t));
+  used = calloc (n, 1);
+  if (!head || !next || !back || !used)
+    {
+      free (head);
+      free (next);
+      free (back);
+      free (used);
+      return 0;
+    }
+
+  /* end e of the segments is end e&1 of segment e>>1, at xy + 2e */
+  for (k = 0; k < nbucket; k++)
+    head[k] = GIZA_CONTOUR_NONE;
+  for (e = 2*n; e-- > 0;)
+    {
+      k = _giza_contour_hash (xy + 2*e) & mask;
+      next[e] = head[k];
+      head[k] = e;
+    }
+
+#define PARTNER(e, f) \
+  for (f = head[_giza_contour_hash (xy + 2*(e)) & mask]; f != GIZA_CONTOUR_NONE; f = next[f]) \
+    if (!used[f >> 1] && xy[2*f] == xy[2*(e)] && xy[2*f+1] == xy[2*(e)+1]) \
+      break;
+
+  for (s = 0; s < n; s++)
+    {
+      if (used[s])
+        continue;
+      used[s] = 1;
+
+      /* follow the line back from the start of the segment... */
+      nback = 0;
+      e = 2*s;
+      for (;;)
+        {
+          PARTNER (e, f);
+          if (f == GIZA_CONTOUR_NONE)
+            break;
+          used[f >> 1] = 1;
+          e = f ^ 1;
+          back[nback++] = e;
+        }
+
+      lines->start[lines->nline++] = lines->npts;
+      while (nback > 0)
+        {
+          e = back[--nback];
+          lines->xy[2*lines->npts] = xy[2*e];
+          lines->xy[2*lines->npts+1] = xy[2*e+1];
+          lines->npts++;
+        }
+      memcpy (lines->xy + 2*lines->npts, xy + 4*s, 4 * sizeof (double));
+      lines->npts += 2;
+
+      /* ...and then forward from its end */
+      e = 2*s + 1;
+      for (;;)
+        {
+          PARTNER (e, f);
+          if (f == GIZA_CONTOUR_NONE)
+            break;
+          used[f >> 1] = 1;
+          e = f ^ 1;
+          lines->xy[2*lines->npts] = xy[2*e];
+          lines->xy[2*lines->npts+1] = xy[2*e+1];
+          lines->npts++;
+        }
+    }
+  lines->start[lines->nline] = lines->npts;
+#undef PARTNER
+
+  free (head);
+  free (next);
+  free (back);
+  free (used);
+  return 1;
+}
+
+/**
+ * Joins the directed edges of the boundary of a region, each running from
+ * x1, y1 to x2, y2, into rings, replacing what was in rings. Each edge is
+ * followed by one that starts where it ends, until the ring gets back to
+ * where it began. Edges are taken up in the order they were found, so the
+ * result does not depend on hashing. Zero length edges are left out.
+ *
+ * Returns 0 if memory ran out.
+ */
+int
+_giza_contour_rings (const giza_contour_segs_t *edges, giza_contour_lines_t *rings)
+{
+  const size_t n = edges->nseg;
+  const double *xy = edges->xy;
+  size_t nbucket, mask, e, f, s, k, *head, *next;
+  unsigned char *used;
+  void *p;
+
+  rings->npts = 0;
+  rings->nline = 0;
+  if (n == 0)
+    return 1;
+
+  if (rings->maxpts < 2*n)
+    {
+      p = realloc (rings->xy, 4 * n * sizeof (double));
+      if (!p)
+        return 0;
+      rings->xy = p;
+      rings->maxpts = 2*n;
+    }
+  if (rings->maxline < n + 1)
+    {
+      p = realloc (rings->start, (n + 1) * sizeof (size_t));
+      if (!p)
+        return 0;
+      rings->start = p;
+      rings->maxline = n + 1;
+    }
+
+  for (nbucket = 16; nbucket < n; nbucket *= 2)
+    ;
+  mask = nbucket - 1;
+  head = malloc (nbucket * sizeof (size_t));
+  next = malloc (n * sizeof (size_t));
+  used = calloc (n, 1);
+  if (!head || !next || !used)
+    {
+      free (head);
+      free (next);
+      free (used);
+      return 0;
+    }
+
+  /* edge e starts at xy + 4e and ends at xy + 4e + 2 */
+  for (k = 0; k < nbucket; k++)
+    head[k] = GIZA_CONTOUR_NONE;
+  for (e = n; e-- > 0;)
+    {
+      if (xy[4*e] == xy[4*e+2] && xy[4*e+1] == xy[4*e+3])
+        {
+          used[e] = 1;
+          continue;
+        }
+      k = _giza_contour_hash (xy + 4*e) & mask;
+      next[e] = head[k];
+      head[k] = e;
+    }
+
+  for (s = 0; s < n; s++)
+    {
+      if (used[s])
+        continue;
+      used[s] = 1;
+
+      rings->start[rings->nline++] = rings->npts;
+      memcpy (rings->xy + 2*rings->npts, xy + 4*s, 4 * sizeof (double));
+      rings->npts += 2;
+
+      e = s;
+      while (xy[4*e+2] != xy[4*s] || xy[4*e+3] != xy[4*s+1])
+        {
+          for (f = head[_giza_contour_hash (xy + 4*e + 2) & mask]; f != GIZA_CONTOUR_NONE; f = next[f])
+            if (!used[f] && xy[4*f] == xy[4*e+2] && xy[4*f+1] == xy[4*e+3])
+              break;
+          if (f == GIZA_CONTOUR_NONE)
+            break;
+          used[f] = 1;
+          e = f;
+          rings->xy[2*rings->npts] = xy[4*e+2];
+          rings->xy[2*rings->npts+1] = xy[4*e+3];
+          rings->npts++;
+        }
+    }
+  rings->start[rings->nline] = rings->npts;
+
+  free (head);
+  free (next);
+  free (used);
+  return 1;
+}
+
+/**
+ * Returns 1 if polyline k of lines is a closed ring
+ */
+int
+_giza_contour_line_closed (const giza_contour_lines_t *lines, size_t k)
+{
+  const double *first = lines->xy + 2*lines->start[k];
+  const double *last = lines->xy + 2*(lines->start[k+1] - 1);
+
+  return lines->start[k+1] - lines->start[k] > 2 && first[0] == last[0] && first[1] == last[1];
+}
+
+/**
+ * Frees the memory held by lines
+ */
+void
+_giza_contour_free_lines (giza_contour_lines_t *lines)
+{
+  free (lines->xy);
+  free (lines->start);
+  memset (lines, 0, sizeof (*lines));
+}
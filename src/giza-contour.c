@@ -30,206 +30,776 @@
 #include "giza-private.h"
 #include "giza-io-private.h"
 #include "giza-transforms-private.h"
+#include "giza-contour-private.h"
+#include "giza-threads-private.h"
 #include <giza.h>
 #include <stdlib.h> /* for abs() */
 #include <math.h>
 #include <string.h>
 
 
-void
-giza_contour (int sizex, int sizey, const double* data, int i1,
-             int i2, int j1, int j2, int ncont_in, const double* cont,
-             const double *affine)
+static int _giza_conrec_cell (const double *corner, int i, int j, double level, double *seg);
+static void _giza_contour_lines (const char *caller, int sizex, int type, const void *data,
+                                 int i1, int i2, int j1, int j2, int ncont_in,
+                                 const double *cont, const double *affine, const double *blank,
+                                 const void *xc, const void *yc);
+
+/**
+ * Finds the pieces of the contour at level crossing the grid cell from
+ * (i,j) to (i+1,j+1), by the method of conrec.c: the cell is divided into
+ * four triangles meeting at its centre, each crossed by at most one
+ * segment. The data at the corners (i,j), (i+1,j), (i+1,j+1) and (i,j+1)
+ * are in corner. Stores x1, y1, x2, y2 for each segment in seg, which
+ * needs room for 16 values, and returns the number of segments.
+ */
+static int
+_giza_conrec_cell (const double *corner, int i, int j, double level, double *seg)
 {
 #define xsect(p1,p2) (h[p2]*xh[p1]-h[p1]*xh[p2])/(h[p2]-h[p1])
 #define ysect(p1,p2) (h[p2]*yh[p1]-h[p1]*yh[p2])/(h[p2]-h[p1])
-
-  if (!_giza_check_device_ready ("giza_contour"))
-    return;
-
-  cairo_matrix_t mat;
-  int sh[5];
-  double h[5];
-  double xh[5], yh[5];
-  int im[4] = { 0, 1, 1, 0 };
-  int jm[4] = { 0, 0, 1, 1 };
-  double temp1, temp2, dmin, dmax, x1 = 0., x2 = 0., y1 = 0., y2 = 0.;
-  int i, j, k, m;
-  int m1, m2, m3, case_value;
-  int castab[3][3][3] = {
+  static const int im[4] = { 0, 1, 1, 0 };
+  static const int jm[4] = { 0, 0, 1, 1 };
+  static const int castab[3][3][3] = {
     {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
     {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
     {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}}
   };
+  int sh[5];
+  double h[5];
+  double xh[5], yh[5];
+  double x1 = 0., x2 = 0., y1 = 0., y2 = 0.;
+  int m, m1, m2, m3, case_value, nseg = 0;
 
-  /* start buffering */
-  int oldBuf;
-  giza_get_buffering(&oldBuf);
-  giza_begin_buffer ();
+  for (m = 4; m >= 0; m--)
+    {
+      /* calculate the relative height of the four corners and centre of the square */
+      /* (i, j)   (i+1, j) */
+      /* (i, j+1) (i+1, j+1) */
+      /* as well as their grid co-ords */
+      if (m > 0)
+        {
+          h[m] = corner[m - 1] - level;
+          xh[m] = i + im[m - 1] + 0.5;
+          yh[m] = j + jm[m - 1] + 0.5;
+        }
+      else
+        {
+          h[0] = 0.25 * (h[1] + h[2] + h[3] + h[4]);
+          xh[0] = 0.5 * (i + i + 1) + 0.5;
+          yh[0] = 0.5 * (j + j + 1) + 0.5;
+        }
 
-  /* Get the affine matrix ready */
-  int oldTrans = _giza_get_trans ();
-  _giza_set_trans (GIZA_TRANS_WORLD);
-  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
-                   affine[4], affine[5]);
-  cairo_transform (Dev[id].context, &mat);
-  cairo_get_matrix (Dev[id].context, &mat);
-  _giza_set_trans (GIZA_TRANS_IDEN);
+      if (h[m] > 0.0)
+        sh[m] = 1;
+      else if (h[m] < 0.0)
+        sh[m] = -1;
+      else
+        sh[m] = 0;
+    }
+
+  for (m = 1; m <= 4; ++m)
+    {
+      m1 = m;
+      m2 = 0;
+      if (m != 4)
+        m3 = m + 1;
+      else
+        m3 = 1;
+
+      if ((case_value = castab[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1]) == 0)
+        continue;
+
+      switch (case_value)
+        {
+        case 1:       /* Line between (i, j) (i + 1, j) */
+          x1 = xh[m1];
+          y1 = yh[m1];
+          x2 = xh[m2];
+          y2 = yh[m2];
+          break;
+        case 2:       /* Line between (i + 1, j) (i + 1, j + 1) */
+          x1 = xh[m2];
+          y1 = yh[m2];
+          x2 = xh[m3];
+          y2 = yh[m3];
+          break;
+        case 3:       /* Line between (i, j) (i + 1, j + 1) */
+          x1 = xh[m3];
+          y1 = yh[m3];
+          x2 = xh[m1];
+          y2 = yh[m1];
+          break;
+        case 4:       /* Line between (i, j) and between (i + 1, j), (i + 1, j + 1) */
+          x1 = xh[m1];
+          y1 = yh[m1];
+          x2 = xsect (m2, m3);
+          y2 = ysect (m2, m3);
+          break;
+        case 5:       /* Line between (i + 1, j) and between (i, j), (i + 1, j + 1) */
+          x1 = xh[m2];
+          y1 = yh[m2];
+          x2 = xsect (m3, m1);
+          y2 = ysect (m3, m1);
+          break;
+        case 6:       /* Line between (i + 1, j + 1) and between (i, j), (i + 1, j + 1)  */
+          x1 = xh[m3];
+          y1 = yh[m3];
+          x2 = xsect (m3, m2);
+          y2 = ysect (m3, m2);
+          break;
+        case 7:       /* Line between sides 1-2 and 2-3  */
+          x1 = xsect (m1, m2);
+          y1 = ysect (m1, m2);
+          x2 = xsect (m2, m3);
+          y2 = ysect (m2, m3);
+          break;
+        case 8:       /* Line between sides 2-3 and 3-1 */
+          x1 = xsect (m2, m3);
+          y1 = ysect (m2, m3);
+          x2 = xsect (m3, m1);
+          y2 = ysect (m3, m1);
+          break;
+        case 9:       /* Line between sides 3-1 and 1-2 */
+          x1 = xsect (m3, m1);
+          y1 = ysect (m3, m1);
+          x2 = xsect (m1, m2);
+          y2 = ysect (m1, m2);
+          break;
+        default:
+          break;
+        }
+      seg[4*nseg] = x1;
+      seg[4*nseg+1] = y1;
+      seg[4*nseg+2] = x2;
+      seg[4*nseg+3] = y2;
+      nseg++;
+    }
+  return nseg;
+#undef xsect
+#undef ysect
+}
+
+/* one tier of the block pyramid: for each block of size x size cells, the
+ * levels lo..hi-1 (in order of value) that might cross it */
+typedef struct
+{
+  int shift;                  /* log2 of size */
+  int nbx, nby;
+  int *lohi;
+} giza_contour_tier_t;
+
+/* a contour level, in the order of sorting */
+typedef struct
+{
+  double value;
+  int k;
+} giza_contour_level_t;
+
+/* the work of _giza_contour_trace, shared out in bands of rows */
+typedef struct
+{
+  const void *data;
+  int type;                   /* GIZA_DATA_DOUBLE or GIZA_DATA_FLOAT */
+  int fill;                   /* finding the edges of filled regions */
+  const double *blank;
+  int sizex, i1, i2, j1, j2, ncont;  /* ncont buffers, one per level or region */
+  int nlevel;
+  const double *level;        /* the levels that are not NaN, sorted */
+  const int *index;           /* where each of those is in the list given */
+  int ntier;
+  giza_contour_tier_t tier[GIZA_CONTOUR_MAX_TIERS];
+  giza_contour_segs_t *segs;  /* ncont for each band, band 0 first */
+  giza_contour_segs_t *out;   /* where band 0 goes */
+  int *ok;                    /* for each band */
+} giza_contour_trace_t;
+
+/* the first of level[lo..hi-1] not below value */
+static int
+_giza_contour_lower (const double *level, int lo, int hi, double value)
+{
+  int mid;
+
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo)/2;
+      if (level[mid] < value)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* the first of level[lo..hi-1] above value */
+static int
+_giza_contour_upper (const double *level, int lo, int hi, double value)
+{
+  int mid;
+
+  while (lo < hi)
+    {
+      mid = lo + (hi - lo)/2;
+      if (level[mid] <= value)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return lo;
+}
+
+/* Helper: interpolate along an edge between two grid values */
+static double _interp_frac(double v1, double v2, double level)
+{
+  if (fabs(v2 - v1) < 1.0e-30) return 0.5;
+  return (level - v1) / (v2 - v1);
+}
+
+/**
+ * Finds the polygon covering the part of the grid cell from (i,j) to
+ * (i+1,j+1) where lo <= data <= hi, by marching squares with linear
+ * interpolation along the edges. The data at the corners (i,j), (i+1,j),
+ * (i+1,j+1) and (i,j+1) are in d. Stores the points, anticlockwise in
+ * px, py (which need room for 12), and for each a mask of the cell edges
+ * it lies on (bottom 1, right 2, top 4, left 8), returning the number of
+ * points.
+ */
+static int
+_giza_contour_fill_cell (const double *d, int i, int j, double lo, double hi,
+                         double *px, double *py, int *mask)
+{
+  /* Corner positions in grid coordinates (0.5 offset for pixel centers) */
+  const double cx[4] = { i + 0.5, i + 1 + 0.5, i + 1 + 0.5, i + 0.5 };
+  const double cy[4] = { j + 0.5, j + 0.5, j + 1 + 0.5, j + 1 + 0.5 };
+  static const int cmask[4] = { 9, 3, 6, 12 };
+  double t[2], tmp;
+  int np = 0, nt, e, a, b, k, l;
+
+  /* Walk around the four edges. For each edge (from corner e to corner e+1):
+   *   - If e is inside [lo,hi], emit it
+   *   - If crossing lo or hi, emit the intersections in order from e
+   */
+  for (e = 0; e < 4; e++)
+    {
+      if (d[e] >= lo && d[e] <= hi)
+        {
+          px[np] = cx[e];
+          py[np] = cy[e];
+          mask[np] = cmask[e];
+          np++;
+        }
+
+      /* crossings are worked out from the left or bottom end of the edge,
+       * so that the next cell finds exactly the same points */
+      a = (e < 2) ? e : (e + 1) % 4;
+      b = (e < 2) ? e + 1 : e;
+      nt = 0;
+      if ((d[a] < lo && d[b] > lo) || (d[a] > lo && d[b] < lo))
+        t[nt++] = _interp_frac(d[a], d[b], lo);
+      if ((d[a] < hi && d[b] > hi) || (d[a] > hi && d[b] < hi))
+        t[nt++] = _interp_frac(d[a], d[b], hi);
+
+      /* in order along the edge, which the top and left are walked back along */
+      if (nt == 2 && t[0] > t[1])
+        {
+          tmp = t[0];
+          t[0] = t[1];
+          t[1] = tmp;
+        }
+      for (k = 0; k < nt; k++)
+        {
+          l = (e < 2) ? k : nt - 1 - k;
+          px[np] = cx[a] + t[l]*(cx[b] - cx[a]);
+          py[np] = cy[a] + t[l]*(cy[b] - cy[a]);
+          mask[np] = 1 << e;
+          np++;
+        }
+    }
+  return np;
+}
+
+/* whether the polygon of a cell covers no area, being all on one edge */
+static int
+_giza_contour_fill_flat (int np, const int *mask)
+{
+  int k, common = 15;
+
+  if (np < 3)
+    return 1;
+  for (k = 0; k < np; k++)
+    common &= mask[k];
+  return common != 0;
+}
+
+#define GIZA_CONTOUR_T double
+#define GIZA_CONTOUR_FN(name) name
+#include "giza-contour-kernel.h"
+#undef GIZA_CONTOUR_T
+#undef GIZA_CONTOUR_FN
+
+#define GIZA_CONTOUR_T float
+#define GIZA_CONTOUR_FN(name) name ## _f
+#include "giza-contour-kernel.h"
+#undef GIZA_CONTOUR_T
+#undef GIZA_CONTOUR_FN
+
+/* traces rows jhi down to jlo of data of either type, for lines or fills */
+static int
+_giza_contour_trace_typed (const giza_contour_trace_t *t, int jhi, int jlo,
+                           giza_contour_segs_t *segs)
+{
+  if (t->fill)
+    {
+      if (t->type == GIZA_DATA_FLOAT)
+        return _giza_contour_fill_rows_f (t, jhi, jlo, segs);
+      return _giza_contour_fill_rows (t, jhi, jlo, segs);
+    }
+  if (t->type == GIZA_DATA_FLOAT)
+    return _giza_contour_trace_rows_f (t, jhi, jlo, segs);
+  return _giza_contour_trace_rows (t, jhi, jlo, segs);
+}
+
+/* traces rows j2-1-start down to j2-end, into the segments of the band */
+static void
+_giza_contour_trace_band (void *arg, int start, int end, int band)
+{
+  const giza_contour_trace_t *t = arg;
+  giza_contour_segs_t *segs = band ? t->segs + (size_t) band * t->ncont : t->out;
+
+  t->ok[band] = _giza_contour_trace_typed (t, t->j2 - 1 - start, t->j2 - end, segs);
+}
+
+/* finds the levels crossing the smallest blocks in rows start..end-1 of them */
+static void
+_giza_contour_tier_band (void *arg, int start, int end, int band)
+{
+  const giza_contour_trace_t *t = arg;
+
+  if (t->type == GIZA_DATA_FLOAT)
+    _giza_contour_tier_rows_f (t, start, end);
+  else
+    _giza_contour_tier_rows (t, start, end);
+}
+
+/**
+ * Traces the rows of t into segs, in parallel bands if it is worth it.
+ * Each band collects into its own buffers, which are then put together in
+ * the order that one pass from j2 down to j1 would give, so the result is
+ * the same whatever the number of threads. Returns 0 if memory ran out.
+ */
+static int
+_giza_contour_run (giza_contour_trace_t *t, giza_contour_segs_t *segs)
+{
+  const int ncont = t->ncont;
+  giza_contour_segs_t *b;
+  int nbands, band, k, ok = 1;
+
+  t->out = segs;
+  t->segs = NULL;
+  t->ok = NULL;
+  nbands = _giza_thread_bands (t->j2 - t->j1,
+                               (GIZA_CONTOUR_BAND_CELLS + (t->i2 - t->i1) - 1)/(t->i2 - t->i1));
+  if (nbands > 1)
+    {
+      t->segs = calloc ((size_t) nbands * ncont, sizeof (giza_contour_segs_t));
+      t->ok = malloc ((size_t) nbands * sizeof (int));
+    }
+  if (!t->segs || !t->ok)
+    {
+      ok = _giza_contour_trace_typed (t, t->j2 - 1, t->j1, segs);
+    }
+  else
+    {
+      _giza_parallel_for (nbands, t->j2 - t->j1, _giza_contour_trace_band, t);
+
+      /* band 0 went straight into segs; the others follow in order */
+      for (band = 0; band < nbands; band++)
+        {
+          ok = ok && t->ok[band];
+          if (band == 0)
+            continue;
+          for (k = 0; k < ncont; k++)
+            {
+              b = &t->segs[(size_t) band * ncont + k];
+              if (ok && b->nseg > 0)
+                ok = _giza_contour_add_segs (&segs[k], b->xy, b->nseg);
+              free (b->xy);
+            }
+        }
+    }
+  free (t->segs);
+  free (t->ok);
+  return ok;
+}
+
+/**
+ * Builds the block pyramid for the cells being traced: the smallest blocks
+ * have GIZA_CONTOUR_BLOCK cells a side and each tier above has blocks
+ * GIZA_CONTOUR_BLOCK times bigger. Blocks record the levels that might
+ * cross them. If memory runs out there are just fewer tiers.
+ */
+static void
+_giza_contour_pyramid (giza_contour_trace_t *t)
+{
+  giza_contour_tier_t *tr, *below;
+  const int *c;
+  int bi, bj, ci, cj, lo, hi, l, nbands, *p;
+
+  t->ntier = 0;
+  for (l = 0; l < GIZA_CONTOUR_MAX_TIERS; l++)
+    {
+      tr = &t->tier[l];
+      tr->shift = GIZA_CONTOUR_BLOCK_SHIFT * (l + 1);
+      tr->nbx = ((t->i2 - t->i1 - 1) >> tr->shift) + 1;
+      tr->nby = ((t->j2 - t->j1 - 1) >> tr->shift) + 1;
+      tr->lohi = malloc (2 * (size_t) tr->nbx * tr->nby * sizeof (int));
+      if (!tr->lohi)
+        return;
+      t->ntier++;
+
+      if (l == 0)
+        {
+          nbands = _giza_thread_bands (tr->nby, (GIZA_CONTOUR_BAND_CELLS >> 2*tr->shift)/tr->nbx + 1);
+          _giza_parallel_for (nbands, tr->nby, _giza_contour_tier_band, t);
+        }
+      else
+        {
+          /* the union of the levels of the blocks below */
+          below = &t->tier[l - 1];
+          for (bj = 0; bj < tr->nby; bj++)
+            for (bi = 0; bi < tr->nbx; bi++)
+              {
+                lo = t->nlevel;
+                hi = 0;
+                for (cj = bj << GIZA_CONTOUR_BLOCK_SHIFT;
+                     cj < MIN ((bj + 1) << GIZA_CONTOUR_BLOCK_SHIFT, below->nby); cj++)
+                  for (ci = bi << GIZA_CONTOUR_BLOCK_SHIFT;
+                       ci < MIN ((bi + 1) << GIZA_CONTOUR_BLOCK_SHIFT, below->nbx); ci++)
+                    {
+                      c = below->lohi + 2*((size_t) cj * below->nbx + ci);
+                      if (c[1] > c[0])
+                        {
+                          lo = MIN (lo, c[0]);
+                          hi = MAX (hi, c[1]);
+                        }
+                    }
+                p = tr->lohi + 2*((size_t) bj * tr->nbx + bi);
+                p[0] = lo;
+                p[1] = MAX (lo, hi);
+              }
+        }
+      if (tr->nbx == 1 && tr->nby == 1)
+        return;
+    }
+}
+
+/* orders levels by value, and by where they were given if equal */
+static int
+_giza_contour_level_cmp (const void *a, const void *b)
+{
+  const giza_contour_level_t *x = a, *y = b;
+
+  if (x->value < y->value)
+    return -1;
+  if (x->value > y->value)
+    return 1;
+  return (x->k > y->k) - (x->k < y->k);
+}
+
+/**
+ * Collects the segments of each of the ncont contour levels over the cells
+ * between i1..i2, j1..j2 of data of the given type (GIZA_DATA_DOUBLE or
+ * GIZA_DATA_FLOAT), appending them to segs[0..ncont-1], skipping cells
+ * with a corner equal to *blank if blank is not NULL. The levels
+ * need not be in order (NaN levels are left out). Rows are traced in
+ * parallel bands and the segments are the same whatever the number of
+ * threads. Returns 0 if memory ran out.
+ */
+int
+_giza_contour_trace (int sizex, int type, const void *data, int i1, int i2, int j1, int j2,
+                     int ncont, const double *cont, const double *blank,
+                     giza_contour_segs_t *segs)
+{
+  giza_contour_trace_t t;
+  giza_contour_level_t *sorted;
+  double *level;
+  int *index;
+  int k, ok;
+
+  if (j2 <= j1 || i2 <= i1 || ncont <= 0)
+    return 1;
+
+  /* sort the levels once */
+  sorted = malloc ((size_t) ncont * sizeof (giza_contour_level_t));
+  level = malloc ((size_t) ncont * sizeof (double));
+  index = malloc ((size_t) ncont * sizeof (int));
+  if (!sorted || !level || !index)
+    {
+      free (sorted);
+      free (level);
+      free (index);
+      return 0;
+    }
+  t.nlevel = 0;
+  for (k = 0; k < ncont; k++)
+    {
+      if (isnan (cont[k]))
+        continue;
+      sorted[t.nlevel].value = cont[k];
+      sorted[t.nlevel].k = k;
+      t.nlevel++;
+    }
+  qsort (sorted, (size_t) t.nlevel, sizeof (giza_contour_level_t), _giza_contour_level_cmp);
+  for (k = 0; k < t.nlevel; k++)
+    {
+      level[k] = sorted[k].value;
+      index[k] = sorted[k].k;
+    }
+  free (sorted);
+
+  t.data = data;
+  t.type = type;
+  t.blank = blank;
+  t.sizex = sizex;
+  t.i1 = i1;
+  t.i2 = i2;
+  t.j1 = j1;
+  t.j2 = j2;
+  t.ncont = ncont;
+  t.level = level;
+  t.index = index;
+  t.fill = 0;
+  _giza_contour_pyramid (&t);
+  ok = _giza_contour_run (&t, segs);
+
+  for (k = 0; k < t.ntier; k++)
+    free (t.tier[k].lohi);
+  free (level);
+  free (index);
+  return ok;
+}
+
+/**
+ * Collects the edges of the regions between each pair of successive levels
+ * (which must increase) over the cells between i1..i2, j1..j2 of data of
+ * the given type, appending those between level[k] and level[k+1] to
+ * edges[k]. The edges run anticlockwise around each region in grid
+ * coordinates, so _giza_contour_rings can join them up. Returns 0 if
+ * memory ran out.
+ */
+int
+_giza_contour_fill_trace (int sizex, int type, const void *data, int i1, int i2,
+                          int j1, int j2, int nlevel, const double *level,
+                          giza_contour_segs_t *edges)
+{
+  giza_contour_trace_t t;
+
+  if (j2 <= j1 || i2 <= i1 || nlevel < 2)
+    return 1;
+
+  t.data = data;
+  t.type = type;
+  t.fill = 1;
+  t.blank = NULL;
+  t.sizex = sizex;
+  t.i1 = i1;
+  t.i2 = i2;
+  t.j1 = j1;
+  t.j2 = j2;
+  t.ncont = nlevel - 1;
+  t.nlevel = nlevel;
+  t.level = level;
+  t.index = NULL;
+  t.ntier = 0;
+  return _giza_contour_run (&t, edges);
+}
+
+/**
+ * Finds the contours at the ncont levels cont over the cells between
+ * i1..i2, j1..j2 of data of the given type and joins each level into
+ * polylines in grid coordinates, those at cont[k] going in lines[k]. This
+ * is what giza_contour, giza_contour_labelled, giza_contour_extract and
+ * cpgconx all draw from. The segments are gathered in work, ncont buffers
+ * that are kept for the next call, or in buffers of its own if work is
+ * NULL. Returns 0 if memory ran out, in which case some lines may be
+ * missing.
+ */
+int
+_giza_contour_extract (int sizex, int type, const void *data, int i1, int i2, int j1, int j2,
+                       int ncont, const double *cont, const double *blank,
+                       giza_contour_segs_t *work, giza_contour_lines_t *lines)
+{
+  giza_contour_segs_t *segs = work;
+  int k, ok;
+
+  if (!work)
+    {
+      segs = calloc ((size_t) ncont, sizeof (giza_contour_segs_t));
+      if (!segs)
+        return 0;
+    }
+  for (k = 0; k < ncont; k++)
+    segs[k].nseg = 0;
+  ok = _giza_contour_trace (sizex, type, data, i1, i2, j1, j2, ncont, cont, blank, segs);
+  for (k = 0; k < ncont; k++)
+    {
+      if (!_giza_contour_stitch (&segs[k], &lines[k]))
+        {
+          lines[k].npts = 0;
+          lines[k].nline = 0;
+          ok = 0;
+        }
+      if (!work)
+        free (segs[k].xy);
+    }
+  if (!work)
+    free (segs);
+  return ok;
+}
+
+/**
+ * Adds the polylines to the current path, in device coordinates
+ */
+void
+_giza_contour_path (const giza_contour_lines_t *lines, const cairo_matrix_t *mat)
+{
+  size_t k, n, end;
+  double x, y;
+
+  for (k = 0; k < lines->nline; k++)
+    {
+      end = lines->start[k+1];
+      if (_giza_contour_line_closed (lines, k))
+        end--;
+      for (n = lines->start[k]; n < end; n++)
+        {
+          x = lines->xy[2*n];
+          y = lines->xy[2*n+1];
+          cairo_matrix_transform_point (mat, &x, &y);
+          if (n == lines->start[k])
+            cairo_move_to (Dev[id].context, x, y);
+          else
+            cairo_line_to (Dev[id].context, x, y);
+        }
+      if (end < lines->start[k+1])
+        cairo_close_path (Dev[id].context);
+    }
+}
+
+/**
+ * Strokes the polylines of each of the ncont levels in lines as one path
+ * per level, mapped to the device by mat. When ncont_in is positive the
+ * levels below zero are dotted and the rest solid, otherwise all are drawn
+ * in the current line style, which is left as it was.
+ */
+void
+_giza_contour_stroke (int ncont_in, const double *cont, const giza_contour_lines_t *lines,
+                      const cairo_matrix_t *mat)
+{
+  int k;
 
   /* set up the line style */
   int ls;
   int       curls, newls;
   const int ncont      = abs(ncont_in);
   const int auto_style = (ncont_in > 0);
+
   giza_get_line_style (&ls);
   curls = ls;
   giza_set_line_style (curls);
 
-  for (j = (j2 - 1); j >= j1; j--)
+  for (k = 0; k < ncont; k++)
     {
-      for (i = i1; i < i2; i++)
-       {
-         /* find the minimum value at the corners of a 1x1 box */
-         temp1 = MIN (data[j*sizex+i], data[(j + 1)*sizex+i]);
-         temp2 = MIN (data[j*sizex+(i + 1)], data[(j + 1)*sizex+(i + 1)]);
-         dmin = MIN (temp1, temp2);
-
-         /* find the max value at the corners of the 1x1 box */
-         temp1 = MAX (data[j*sizex+i], data[(j + 1)*sizex+i]);
-         temp2 = MAX (data[j*sizex+(i + 1)], data[(j + 1)*sizex+(i + 1)]);
-         dmax = MAX (temp1, temp2);
-
-         /* Check it is in the range of a contour */
-         if (dmax < cont[0] || dmin > cont[ncont - 1])
-           continue;
-
-         for (k = 0; k < ncont; ++k)
-           {
-             if (cont[k] < dmin || cont[k] > dmax)
-              continue;
-             for (m = 4; m >= 0; m--)
-              {
-                /* calculate the relative height of the four corners and centre of the square */
-                /* (i, j)   (i+1, j) */
-                /* (i, j+1) (i+1, j+1) */
-                /* as well as their device co-ords */
-                if (m > 0)
-                  {
-                    h[m] = data[(j + jm[m - 1])*sizex+(i + im[m - 1])] - cont[k];
-                    xh[m] = i + im[m - 1] + 0.5;
-                    yh[m] = j + jm[m - 1] + 0.5;
-                  }
-                else
-                  {
-                    h[0] = 0.25 * (h[1] + h[2] + h[3] + h[4]);
-                    xh[0] = 0.5 * (i + i + 1) + 0.5;
-                    yh[0] = 0.5 * (j + j + 1) + 0.5;
-                  }
-
-                if (h[m] > 0.0)
-                  sh[m] = 1;
-                else if (h[m] < 0.0)
-                  sh[m] = -1;
-                else
-                  sh[m] = 0;
-              }
+      if (lines[k].nline == 0)
+        continue;
+
+      /* compute what the line style should be */
+      newls = (auto_style ? (cont[k]<0 ? GIZA_LS_DOT : GIZA_LS_SOLID) : ls);
+      if( newls!=curls ) {
+          curls = newls;
+          giza_set_line_style (curls);
+      }
 
-             for (m = 1; m <= 4; ++m)
-              {
-                m1 = m;
-                m2 = 0;
-                if (m != 4)
-                  m3 = m + 1;
-                else
-                  m3 = 1;
-
-                if ((case_value =
-                     castab[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1]) == 0)
-                  continue;
-
-                switch (case_value)
-                  {
-                  case 1:       /* Line between (i, j) (i + 1, j) */
-                    x1 = xh[m1];
-                    y1 = yh[m1];
-                    x2 = xh[m2];
-                    y2 = yh[m2];
-                    break;
-                  case 2:       /* Line between (i + 1, j) (i + 1, j + 1) */
-                    x1 = xh[m2];
-                    y1 = yh[m2];
-                    x2 = xh[m3];
-                    y2 = yh[m3];
-                    break;
-                  case 3:       /* Line between (i, j) (i + 1, j + 1) */
-                    x1 = xh[m3];
-                    y1 = yh[m3];
-                    x2 = xh[m1];
-                    y2 = yh[m1];
-                    break;
-                  case 4:       /* Line between (i, j) and between (i + 1, j), (i + 1, j + 1) */
-                    x1 = xh[m1];
-                    y1 = yh[m1];
-                    x2 = xsect (m2, m3);
-                    y2 = ysect (m2, m3);
-                    break;
-                  case 5:       /* Line between (i + 1, j) and between (i, j), (i + 1, j + 1) */
-                    x1 = xh[m2];
-                    y1 = yh[m2];
-                    x2 = xsect (m3, m1);
-                    y2 = ysect (m3, m1);
-                    break;
-                  case 6:       /* Line between (i + 1, j + 1) and between (i, j), (i + 1, j + 1)  */
-                    x1 = xh[m3];
-                    y1 = yh[m3];
-                    x2 = xsect (m3, m2);
-                    y2 = ysect (m3, m2);
-                    break;
-                  case 7:       /* Line between sides 1-2 and 2-3  */
-                    x1 = xsect (m1, m2);
-                    y1 = ysect (m1, m2);
-                    x2 = xsect (m2, m3);
-                    y2 = ysect (m2, m3);
-                    break;
-                  case 8:       /* Line between sides 2-3 and 3-1 */
-                    x1 = xsect (m2, m3);
-                    y1 = ysect (m2, m3);
-                    x2 = xsect (m3, m1);
-                    y2 = ysect (m3, m1);
-                    break;
-                  case 9:       /* Line between sides 3-1 and 1-2 */
-                    x1 = xsect (m3, m1);
-                    y1 = ysect (m3, m1);
-                    x2 = xsect (m1, m2);
-                    y2 = ysect (m1, m2);
-                    break;
-                  default:
-                    break;
-                  }
-                  /* compute what the line style should be */
-                  newls = (auto_style ? (cont[k]<0 ? GIZA_LS_DOT : GIZA_LS_SOLID) : ls);
-                  if( newls!=curls ) {
-                      curls = newls;
-                      giza_set_line_style (curls);
-                  }
-                /* draw the line */
-                  cairo_matrix_transform_point (&mat, &x1, &y1);
-                  cairo_matrix_transform_point (&mat, &x2, &y2);
-                  /*printf ("In index: (x1, y1) = (%f, %f)\n", x1, y1); */
-                  /*printf ("In coord: (x1, y1) = (%f, %f)\n", x1, y1); */
-                  cairo_move_to (Dev[id].context, x1, y1);
-                cairo_line_to (Dev[id].context, x2, y2);
-                cairo_stroke (Dev[id].context);
-              }
-           }
-       }
+      /* one path for the level, joined up so that dashes run on along it */
+      _giza_contour_path (&lines[k], mat);
+      cairo_stroke (Dev[id].context);
     }
 
-  /* restore the transformation */
-  _giza_set_trans (oldTrans);
-
   /* make sure line style returned to previous value */
   giza_set_line_style (ls);
+}
+
+/**
+ * Draws the contours for giza_contour, giza_contour_blanked and
+ * giza_contour_curvilinear. The segments of each level are gathered first,
+ * joined into polylines and then stroked together as one path, in the
+ * line style of that level. The polylines are mapped to world coordinates
+ * by affine, or, if xc and yc are given, by the world coordinates of each
+ * data point in them (of the same type as data), in which case affine is
+ * not used.
+ */
+static void
+_giza_contour_lines (const char *caller, int sizex, int type, const void *data,
+                     int i1, int i2, int j1, int j2, int ncont_in,
+                     const double *cont, const double *affine, const double *blank,
+                     const void *xc, const void *yc)
+{
+  if (!_giza_check_device_ready ((char *) caller))
+    return;
+
+  cairo_matrix_t mat;
+  giza_contour_lines_t *lines;
+  const int ncont = abs(ncont_in);
+  int k;
+
+  if (ncont == 0)
+    return;
+  lines = calloc ((size_t) ncont, sizeof (giza_contour_lines_t));
+  if (!lines)
+    {
+      _giza_warning (caller, "memory allocation failed");
+      return;
+    }
+  if (!_giza_contour_extract (sizex, type, data, i1, i2, j1, j2, ncont, cont, blank, NULL,
+                              lines))
+    _giza_warning (caller, "memory allocation failed, contours incomplete");
+
+  /* on a curvilinear grid the lines go straight to world coordinates */
+  if (xc && yc)
+    {
+      for (k = 0; k < ncont; k++)
+        {
+          if (type == GIZA_DATA_FLOAT)
+            _giza_contour_map_f (xc, yc, sizex, i1, i2, j1, j2, &lines[k]);
+          else
+            _giza_contour_map (xc, yc, sizex, i1, i2, j1, j2, &lines[k]);
+        }
+    }
+
+  /* start buffering */
+  int oldBuf;
+  giza_get_buffering(&oldBuf);
+  giza_begin_buffer ();
+
+  /* Get the affine matrix ready */
+  int oldTrans = _giza_get_trans ();
+  _giza_set_trans (GIZA_TRANS_WORLD);
+  if (!(xc && yc))
+    {
+      cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
+                         affine[4], affine[5]);
+      cairo_transform (Dev[id].context, &mat);
+    }
+  cairo_get_matrix (Dev[id].context, &mat);
+  _giza_set_trans (GIZA_TRANS_IDEN);
+
+  _giza_contour_stroke (ncont_in, cont, lines, &mat);
+
+  for (k = 0; k < ncont; k++)
+    _giza_contour_free_lines (&lines[k]);
+  free (lines);
+
+  /* restore the transformation */
+  _giza_set_trans (oldTrans);
 
   /* restore buffering and stroke */
   if (!oldBuf)
@@ -239,18 +809,33 @@ giza_contour (int sizex, int sizey, const double* data, int i1,
 }
 
 void
-giza_contour_float (int sizex, int sizey, const float* data, int i1,
-             int i2, int j1, int j2, int ncont, const float* cont, const float *affine)
+giza_contour (int sizex, int sizey, const double* data, int i1,
+             int i2, int j1, int j2, int ncont_in, const double* cont,
+             const double *affine)
 {
-  double ddata[sizey*sizex];
-  double dcont[abs(ncont)];
+  _giza_contour_lines ("giza_contour", sizex, GIZA_DATA_DOUBLE, data, i1, i2, j1, j2,
+                       ncont_in, cont, affine, NULL, NULL, NULL);
+}
+
+/**
+ * Draws the contours of float data for giza_contour_float,
+ * giza_contour_blanked_float and giza_contour_curvilinear_float. The data
+ * (and xc, yc) are read in place; only the levels and the affine
+ * transformation, if any, are widened to double.
+ */
+static void
+_giza_contour_lines_float (const char *caller, int sizex, const float *data,
+                           int i1, int i2, int j1, int j2, int ncont,
+                           const float *cont, const float *affine, const double *blank,
+                           const float *xc, const float *yc)
+{
+  double *dcont = malloc(sizeof(double) * (abs(ncont) + 1));
   double daffine[6];
-  int i, j;
+  int i;
 
-  for (j=j1; j<=j2; j++) {
-      for (i=i1; i<=i2; i++) {
-          ddata[j*sizex+i] = (double) data[j*sizex+i];
-      }
+  if (!dcont) {
+    _giza_warning(caller, "memory allocation failed");
+    return;
   }
 
   for (i=0; i<abs(ncont); i++) {
@@ -258,11 +843,20 @@ giza_contour_float (int sizex, int sizey, const float* data, int i1,
   }
 
   for (i=0; i<6; i++) {
-     daffine[i] = (double) affine[i];
+     daffine[i] = affine ? (double) affine[i] : 0.;
   }
 
-  giza_contour (sizex, sizey, ddata, i1, i2, j1, j2, ncont, dcont, daffine);
+  _giza_contour_lines (caller, sizex, GIZA_DATA_FLOAT, data, i1, i2, j1, j2, ncont,
+                       dcont, daffine, blank, xc, yc);
+  free(dcont);
+}
 
+void
+giza_contour_float (int sizex, int sizey, const float* data, int i1,
+             int i2, int j1, int j2, int ncont, const float* cont, const float *affine)
+{
+  _giza_contour_lines_float ("giza_contour_float", sizex, data, i1, i2, j1, j2, ncont,
+                             cont, affine, NULL, NULL, NULL);
 }
 
 /*
@@ -275,26 +869,112 @@ giza_contour_blanked (int sizex, int sizey, const double* data, int i1,
              int i2, int j1, int j2, int ncont_in, const double* cont,
              const double *affine, double blank)
 {
-#define xsect_b(p1,p2) (hb[p2]*xhb[p1]-hb[p1]*xhb[p2])/(hb[p2]-hb[p1])
-#define ysect_b(p1,p2) (hb[p2]*yhb[p1]-hb[p1]*yhb[p2])/(hb[p2]-hb[p1])
+  _giza_contour_lines ("giza_contour_blanked", sizex, GIZA_DATA_DOUBLE, data, i1, i2, j1, j2,
+                       ncont_in, cont, affine, &blank, NULL, NULL);
+}
+
+void
+giza_contour_blanked_float (int sizex, int sizey, const float* data, int i1,
+             int i2, int j1, int j2, int ncont, const float* cont,
+             const float *affine, float blank)
+{
+  double dblank = (double) blank;
+
+  _giza_contour_lines_float ("giza_contour_blanked_float", sizex, data, i1, i2, j1, j2, ncont,
+                             cont, affine, &dblank, NULL, NULL);
+}
+
+/**
+ * Drawing: giza_contour_curvilinear
+ *
+ * Synopsis: Draws contours of data on a curvilinear grid, where the world
+ * coordinates of each data point are given rather than found by an affine
+ * transformation.
+ *
+ * The contours are found as by giza_contour, joined into polylines and
+ * mapped into world coordinates by bilinear interpolation of x and y
+ * within each cell, then drawn one path per level.
+ *
+ * Input:
+ *  -sizex :- The dimensions of data, x and y in the x-direction
+ *  -sizey :- The dimensions of data, x and y in the y-direction
+ *  -data  :- The data to be contoured
+ *  -x     :- The world x coordinate of each data point
+ *  -y     :- The world y coordinate of each data point
+ *  -i1,i2 :- Inclusive range of data to use in the x dimension
+ *  -j1,j2 :- Inclusive range of data to use in the y dimension
+ *  -ncont :- The number of contour levels, negative to draw them all in the
+ *            current line style, as for giza_contour
+ *  -cont  :- The contour levels
+ *
+ * See Also: giza_contour, giza_contour_curvilinear_float
+ */
+void
+giza_contour_curvilinear (int sizex, int sizey, const double* data, const double* x,
+             const double* y, int i1, int i2, int j1, int j2, int ncont,
+             const double* cont)
+{
+  _giza_contour_lines ("giza_contour_curvilinear", sizex, GIZA_DATA_DOUBLE, data,
+                       i1, i2, j1, j2, ncont, cont, NULL, NULL, x, y);
+}
+
+/**
+ * Drawing: giza_contour_curvilinear_float
+ *
+ * Synopsis: Same functionality as giza_contour_curvilinear but takes floats.
+ *
+ * See Also: giza_contour_curvilinear
+ */
+void
+giza_contour_curvilinear_float (int sizex, int sizey, const float* data, const float* x,
+             const float* y, int i1, int i2, int j1, int j2, int ncont,
+             const float* cont)
+{
+  _giza_contour_lines_float ("giza_contour_curvilinear_float", sizex, data, i1, i2, j1, j2,
+                             ncont, cont, NULL, NULL, x, y);
+}
 
-  if (!_giza_check_device_ready ("giza_contour_blanked"))
+/**
+ * Fills the regions between successive levels for giza_contour_fill and
+ * giza_contour_fill_levels, reading data of either type in place. The
+ * edges of every region are found in one pass over the data and joined
+ * into rings, so each region is one path filled once, with no seams
+ * between cells. With colour set, region k of n takes its colour from
+ * the colour index range, otherwise all are in the current colour.
+ */
+static void
+_giza_contour_fill (const char *caller, int sizex, int type, const void *data, int i1,
+                    int i2, int j1, int j2, int nlevel, const double *level,
+                    const double *affine, int colour)
+{
+  if (!_giza_check_device_ready ((char *) caller))
     return;
 
   cairo_matrix_t mat;
-  int sh[5];
-  double hb[5];
-  double xhb[5], yhb[5];
-  int im[4] = { 0, 1, 1, 0 };
-  int jm[4] = { 0, 0, 1, 1 };
-  double temp1, temp2, dmin, dmax, x1 = 0., x2 = 0., y1 = 0., y2 = 0.;
-  int i, j, k, m;
-  int m1, m2, m3, case_value;
-  int castab[3][3][3] = {
-    {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
-    {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
-    {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}}
-  };
+  giza_contour_segs_t *edges;
+  giza_contour_lines_t rings = { NULL, NULL, 0, 0, 0, 0 };
+  int k, nband, ci, oldci, cimin, cimax;
+
+  for (k = 1; k < nlevel; k++)
+    {
+      if (!(level[k] >= level[k-1]))
+        {
+          _giza_warning (caller, "contour levels must increase, no fill drawn");
+          return;
+        }
+    }
+  if (nlevel < 2)
+    return;
+  nband = nlevel - 1;
+
+  edges = calloc ((size_t) nband, sizeof (giza_contour_segs_t));
+  if (!edges)
+    {
+      _giza_warning (caller, "memory allocation failed");
+      return;
+    }
+  if (!_giza_contour_fill_trace (sizex, type, data, i1, i2, j1, j2, nlevel, level, edges))
+    _giza_warning (caller, "memory allocation failed, fill incomplete");
 
   int oldBuf;
   giza_get_buffering(&oldBuf);
@@ -308,357 +988,395 @@ giza_contour_blanked (int sizex, int sizey, const double* data, int i1,
   cairo_get_matrix (Dev[id].context, &mat);
   _giza_set_trans (GIZA_TRANS_IDEN);
 
-  int ls;
-  int       curls, newls;
-  const int ncont      = abs(ncont_in);
-  const int auto_style = (ncont_in > 0);
-  giza_get_line_style (&ls);
-  curls = ls;
-  giza_set_line_style (curls);
+  giza_get_colour_index (&oldci);
+  giza_get_colour_index_range (&cimin, &cimax);
 
-  for (j = (j2 - 1); j >= j1; j--)
+  for (k = 0; k < nband; k++)
     {
-      for (i = i1; i < i2; i++)
-       {
-         /* skip cells where any corner is blanked */
-         double d00 = data[j*sizex+i];
-         double d10 = data[j*sizex+(i+1)];
-         double d01 = data[(j+1)*sizex+i];
-         double d11 = data[(j+1)*sizex+(i+1)];
-         if (d00 == blank || d10 == blank || d01 == blank || d11 == blank)
-           continue;
-
-         temp1 = MIN (d00, d01);
-         temp2 = MIN (d10, d11);
-         dmin = MIN (temp1, temp2);
-
-         temp1 = MAX (d00, d01);
-         temp2 = MAX (d10, d11);
-         dmax = MAX (temp1, temp2);
-
-         if (dmax < cont[0] || dmin > cont[ncont - 1])
-           continue;
-
-         for (k = 0; k < ncont; ++k)
-           {
-             if (cont[k] < dmin || cont[k] > dmax)
-              continue;
-             for (m = 4; m >= 0; m--)
-              {
-                if (m > 0)
-                  {
-                    hb[m] = data[(j + jm[m - 1])*sizex+(i + im[m - 1])] - cont[k];
-                    xhb[m] = i + im[m - 1] + 0.5;
-                    yhb[m] = j + jm[m - 1] + 0.5;
-                  }
-                else
-                  {
-                    hb[0] = 0.25 * (hb[1] + hb[2] + hb[3] + hb[4]);
-                    xhb[0] = 0.5 * (i + i + 1) + 0.5;
-                    yhb[0] = 0.5 * (j + j + 1) + 0.5;
-                  }
-
-                if (hb[m] > 0.0)
-                  sh[m] = 1;
-                else if (hb[m] < 0.0)
-                  sh[m] = -1;
-                else
-                  sh[m] = 0;
-              }
+      if (edges[k].nseg == 0)
+        continue;
 
-             for (m = 1; m <= 4; ++m)
-              {
-                m1 = m;
-                m2 = 0;
-                if (m != 4)
-                  m3 = m + 1;
-                else
-                  m3 = 1;
-
-                if ((case_value =
-                     castab[sh[m1] + 1][sh[m2] + 1][sh[m3] + 1]) == 0)
-                  continue;
-
-                switch (case_value)
-                  {
-                  case 1: x1=xhb[m1]; y1=yhb[m1]; x2=xhb[m2]; y2=yhb[m2]; break;
-                  case 2: x1=xhb[m2]; y1=yhb[m2]; x2=xhb[m3]; y2=yhb[m3]; break;
-                  case 3: x1=xhb[m3]; y1=yhb[m3]; x2=xhb[m1]; y2=yhb[m1]; break;
-                  case 4: x1=xhb[m1]; y1=yhb[m1]; x2=xsect_b(m2,m3); y2=ysect_b(m2,m3); break;
-                  case 5: x1=xhb[m2]; y1=yhb[m2]; x2=xsect_b(m3,m1); y2=ysect_b(m3,m1); break;
-                  case 6: x1=xhb[m3]; y1=yhb[m3]; x2=xsect_b(m3,m2); y2=ysect_b(m3,m2); break;
-                  case 7: x1=xsect_b(m1,m2); y1=ysect_b(m1,m2); x2=xsect_b(m2,m3); y2=ysect_b(m2,m3); break;
-                  case 8: x1=xsect_b(m2,m3); y1=ysect_b(m2,m3); x2=xsect_b(m3,m1); y2=ysect_b(m3,m1); break;
-                  case 9: x1=xsect_b(m3,m1); y1=ysect_b(m3,m1); x2=xsect_b(m1,m2); y2=ysect_b(m1,m2); break;
-                  default: break;
-                  }
-                  newls = (auto_style ? (cont[k]<0 ? GIZA_LS_DOT : GIZA_LS_SOLID) : ls);
-                  if( newls!=curls ) {
-                      curls = newls;
-                      giza_set_line_style (curls);
-                  }
-                  cairo_matrix_transform_point (&mat, &x1, &y1);
-                  cairo_matrix_transform_point (&mat, &x2, &y2);
-                  cairo_move_to (Dev[id].context, x1, y1);
-                  cairo_line_to (Dev[id].context, x2, y2);
-                  cairo_stroke (Dev[id].context);
-              }
-           }
-       }
+      if (!_giza_contour_rings (&edges[k], &rings))
+        {
+          _giza_warning (caller, "memory allocation failed, fill incomplete");
+          free (edges[k].xy);
+          continue;
+        }
+      if (colour)
+        {
+          ci = cimin + (int) ((cimax - cimin + 1) * (k + 0.5) / nband);
+          giza_set_colour_index (MIN (ci, cimax));
+        }
+      _giza_contour_path (&rings, &mat);
+      cairo_fill (Dev[id].context);
+      free (edges[k].xy);
     }
+  free (edges);
+  _giza_contour_free_lines (&rings);
+
+  if (colour)
+    giza_set_colour_index (oldci);
 
   _giza_set_trans (oldTrans);
-  giza_set_line_style (ls);
   if (!oldBuf) giza_end_buffer ();
   giza_flush_device ();
-
-#undef xsect_b
-#undef ysect_b
 }
 
 void
-giza_contour_blanked_float (int sizex, int sizey, const float* data, int i1,
-             int i2, int j1, int j2, int ncont, const float* cont,
-             const float *affine, float blank)
+giza_contour_fill (int sizex, int sizey, const double* data, int i1,
+             int i2, int j1, int j2, double c1, double c2,
+             const double *affine)
 {
-  double *ddata = malloc(sizeof(double) * sizex * sizey);
-  double *dcont = malloc(sizeof(double) * abs(ncont));
-  double daffine[6];
-  int i, j;
+  double level[2];
 
-  if (!ddata || !dcont) {
-    _giza_warning("giza_contour_blanked_float", "memory allocation failed");
-    free(ddata);
-    free(dcont);
-    return;
-  }
-
-  for (j=j1; j<=j2; j++) {
-      for (i=i1; i<=i2; i++) {
-          ddata[j*sizex+i] = (double) data[j*sizex+i];
-      }
-  }
+  level[0] = c1;
+  level[1] = c2;
+  _giza_contour_fill ("giza_contour_fill", sizex, GIZA_DATA_DOUBLE, data, i1, i2, j1, j2,
+                      2, level, affine, 0);
+}
 
-  for (i=0; i<abs(ncont); i++) {
-      dcont[i] = (double) cont[i];
-  }
+void
+giza_contour_fill_float (int sizex, int sizey, const float* data, int i1,
+             int i2, int j1, int j2, float c1, float c2, const float *affine)
+{
+  double daffine[6], level[2];
+  int i;
 
   for (i=0; i<6; i++) {
      daffine[i] = (double) affine[i];
   }
+  level[0] = (double) c1;
+  level[1] = (double) c2;
 
-  giza_contour_blanked (sizex, sizey, ddata, i1, i2, j1, j2, ncont, dcont, daffine,
-                        (double) blank);
-  free(ddata);
-  free(dcont);
+  _giza_contour_fill ("giza_contour_fill_float", sizex, GIZA_DATA_FLOAT, data, i1, i2, j1, j2,
+                      2, level, daffine, 0);
 }
 
-/*
- * giza_contour_fill -- fill between two contour levels
+/**
+ * Drawing: giza_contour_fill_levels
  *
- * Uses marching squares to fill the region where c1 <= data <= c2
- * for each grid cell. Linear interpolation along edges.
+ * Synopsis: Fills the regions between successive contour levels, each in
+ * its own colour from the colour index range, in one pass over the data.
+ * Region k of the nlevel-1 regions, from level[k] to level[k+1], takes
+ * the colour index cimin + (cimax-cimin+1)*(k+0.5)/(nlevel-1).
+ *
+ * Input:
+ *  -sizex  :- The dimensions of data in the x-direction
+ *  -sizey  :- The dimensions of data in the y-direction
+ *  -data   :- The data to be contoured
+ *  -i1,i2  :- Inclusive range of data to use in the x dimension
+ *  -j1,j2  :- Inclusive range of data to use in the y dimension
+ *  -nlevel :- The number of levels
+ *  -level  :- The levels, which must increase
+ *  -affine :- Affine transformation from pixel indices to world coordinates
+ *
+ * See Also: giza_contour_fill, giza_set_colour_index_range
  */
-
-/* Helper: interpolate along an edge between two grid values */
-static double _interp_frac(double v1, double v2, double level)
+void
+giza_contour_fill_levels (int sizex, int sizey, const double* data, int i1,
+             int i2, int j1, int j2, int nlevel, const double* level,
+             const double *affine)
 {
-  if (fabs(v2 - v1) < 1.0e-30) return 0.5;
-  return (level - v1) / (v2 - v1);
+  _giza_contour_fill ("giza_contour_fill_levels", sizex, GIZA_DATA_DOUBLE, data, i1, i2,
+                      j1, j2, nlevel, level, affine, 1);
 }
 
+/**
+ * Drawing: giza_contour_fill_levels_float
+ *
+ * Synopsis: Same as giza_contour_fill_levels but takes floats
+ *
+ * See Also: giza_contour_fill_levels
+ */
 void
-giza_contour_fill (int sizex, int sizey, const double* data, int i1,
-             int i2, int j1, int j2, double c1, double c2,
-             const double *affine)
+giza_contour_fill_levels_float (int sizex, int sizey, const float* data, int i1,
+             int i2, int j1, int j2, int nlevel, const float* level,
+             const float *affine)
 {
-  if (!_giza_check_device_ready ("giza_contour_fill"))
+  double daffine[6], *dlevel;
+  int i;
+
+  if (nlevel < 2)
     return;
+  dlevel = malloc ((size_t) nlevel * sizeof (double));
+  if (!dlevel)
+    {
+      _giza_warning ("giza_contour_fill_levels_float", "memory allocation failed");
+      return;
+    }
+  for (i=0; i<6; i++) {
+     daffine[i] = (double) affine[i];
+  }
+  for (i=0; i<nlevel; i++) {
+     dlevel[i] = (double) level[i];
+  }
 
-  cairo_matrix_t mat;
+  _giza_contour_fill ("giza_contour_fill_levels_float", sizex, GIZA_DATA_FLOAT, data, i1, i2,
+                      j1, j2, nlevel, dlevel, daffine, 1);
+  free (dlevel);
+}
 
-  int oldBuf;
-  giza_get_buffering(&oldBuf);
-  giza_begin_buffer ();
+/* where the labels of one call go, in world coordinates, hashed by
+ * position so that those near a new label are quick to find */
+typedef struct
+{
+  double *xya;                /* x, y and angle (degrees) of each label */
+  size_t *next;               /* the label after each in its bucket */
+  size_t n, max;
+  size_t *head;               /* the first label in each bucket */
+  size_t nbucket;
+  double cell;                /* no two labels are closer than this */
+  double *gap;                /* the stretches of a line the labels blank out */
+  size_t maxgap;
+} giza_contour_labels_t;
+
+#define GIZA_CONTOUR_NO_LABEL ((size_t) -1)
+
+/* buffers kept between calls of giza_contour_labelled, which is usually
+ * called for many levels in turn, so they only ever grow to the largest */
+static giza_contour_segs_t _giza_contour_label_segs = { NULL, 0, 0 };
+static giza_contour_lines_t _giza_contour_label_lines = { NULL, NULL, 0, 0, 0, 0 };
+static giza_contour_labels_t _giza_contour_labels = { NULL, NULL, 0, 0, NULL, 0, 0., NULL, 0 };
+
+/* the bucket of the hash cell cx, cy */
+static size_t
+_giza_contour_label_bucket (const giza_contour_labels_t *labels, long cx, long cy)
+{
+  return ((size_t) cx * 73856093u ^ (size_t) cy * 19349663u) & (labels->nbucket - 1);
+}
 
-  int oldTrans = _giza_get_trans ();
-  _giza_set_trans (GIZA_TRANS_WORLD);
-  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
-                   affine[4], affine[5]);
-  cairo_transform (Dev[id].context, &mat);
-  cairo_get_matrix (Dev[id].context, &mat);
-  _giza_set_trans (GIZA_TRANS_IDEN);
+/* empties the labels, which are to be kept cell apart */
+static void
+_giza_contour_label_reset (giza_contour_labels_t *labels, double cell)
+{
+  size_t b;
 
-  int i, j;
-  for (j = j1; j < j2; j++)
-    {
-      for (i = i1; i < i2; i++)
+  labels->n = 0;
+  labels->cell = cell;
+  for (b = 0; b < labels->nbucket; b++)
+    labels->head[b] = GIZA_CONTOUR_NO_LABEL;
+}
+
+/* whether no label is yet within cell of x, y */
+static int
+_giza_contour_label_clear (const giza_contour_labels_t *labels, double x, double y)
+{
+  long cx, cy, bx, by;
+  size_t k;
+  double dx, dy;
+
+  if (labels->n == 0)
+    return 1;
+  cx = (long) floor (x / labels->cell);
+  cy = (long) floor (y / labels->cell);
+  for (by = cy - 1; by <= cy + 1; by++)
+    for (bx = cx - 1; bx <= cx + 1; bx++)
+      for (k = labels->head[_giza_contour_label_bucket (labels, bx, by)];
+           k != GIZA_CONTOUR_NO_LABEL; k = labels->next[k])
         {
-          /* Grid cell corners: (i,j), (i+1,j), (i+1,j+1), (i,j+1) */
-          double d[4];
-          d[0] = data[j*sizex+i];         /* bottom-left  */
-          d[1] = data[j*sizex+(i+1)];     /* bottom-right */
-          d[2] = data[(j+1)*sizex+(i+1)]; /* top-right    */
-          d[3] = data[(j+1)*sizex+i];     /* top-left     */
-
-          /* Corner positions in grid coordinates (0.5 offset for pixel centers) */
-          double cx[4], cy[4];
-          cx[0] = i + 0.5;     cy[0] = j + 0.5;
-          cx[1] = i + 1 + 0.5; cy[1] = j + 0.5;
-          cx[2] = i + 1 + 0.5; cy[2] = j + 1 + 0.5;
-          cx[3] = i + 0.5;     cy[3] = j + 1 + 0.5;
-
-          /* Build a polygon representing the region c1 <= data <= c2 in this cell.
-           * Walk around the four edges. For each edge (from corner A to corner B):
-           *   - If A is inside [c1,c2], emit A
-           *   - If crossing c1 or c2 boundary, emit intersection point
-           */
-          double px[16], py[16];
-          int np = 0;
-
-          int e;
-          for (e = 0; e < 4; e++)
-            {
-              int e2 = (e + 1) % 4;
-              double va = d[e], vb = d[e2];
-              int a_in = (va >= c1 && va <= c2);
-              int b_in = (vb >= c1 && vb <= c2);
+          dx = labels->xya[3*k] - x;
+          dy = labels->xya[3*k+1] - y;
+          if (dx*dx + dy*dy < labels->cell * labels->cell)
+            return 0;
+        }
+  return 1;
+}
 
-              if (a_in && np < 16) {
-                px[np] = cx[e]; py[np] = cy[e]; np++;
-              }
+/* adds a label, growing the table as needed; returns 0 if memory ran out */
+static int
+_giza_contour_label_add (giza_contour_labels_t *labels, double x, double y, double angle)
+{
+  size_t size, b, k, *p;
+  double *xya;
 
-              /* Check crossings of c1 and c2 along this edge */
-              /* We need to emit intersections in order from A to B */
-              double t_c1 = -1.0, t_c2 = -1.0;
-
-              if ((va < c1 && vb > c1) || (va > c1 && vb < c1))
-                t_c1 = _interp_frac(va, vb, c1);
-              if ((va < c2 && vb > c2) || (va > c2 && vb < c2))
-                t_c2 = _interp_frac(va, vb, c2);
-
-              /* Emit in order of parameter t */
-              double t1, t2;
-              if (t_c1 >= 0.0 && t_c2 >= 0.0) {
-                if (t_c1 < t_c2) { t1=t_c1; t2=t_c2; }
-                else              { t1=t_c2; t2=t_c1; }
-                if (np < 16) {
-                  px[np] = cx[e] + t1*(cx[e2]-cx[e]);
-                  py[np] = cy[e] + t1*(cy[e2]-cy[e]);
-                  np++;
-                }
-                if (np < 16) {
-                  px[np] = cx[e] + t2*(cx[e2]-cx[e]);
-                  py[np] = cy[e] + t2*(cy[e2]-cy[e]);
-                  np++;
-                }
-              } else if (t_c1 >= 0.0 && np < 16) {
-                px[np] = cx[e] + t_c1*(cx[e2]-cx[e]);
-                py[np] = cy[e] + t_c1*(cy[e2]-cy[e]);
-                np++;
-              } else if (t_c2 >= 0.0 && np < 16) {
-                px[np] = cx[e] + t_c2*(cx[e2]-cx[e]);
-                py[np] = cy[e] + t_c2*(cy[e2]-cy[e]);
-                np++;
-              }
-            }
+  if (labels->n + 1 > labels->max)
+    {
+      size = (labels->max > 0) ? 2*labels->max : 16;
+      xya = realloc (labels->xya, 3 * size * sizeof (double));
+      if (!xya)
+        return 0;
+      labels->xya = xya;
+      p = realloc (labels->next, size * sizeof (size_t));
+      if (!p)
+        return 0;
+      labels->next = p;
+      labels->max = size;
+    }
 
-          if (np >= 3)
-            {
-              /* Transform polygon to device coords and fill */
-              int p;
-              double tx, ty;
-              tx = px[0]; ty = py[0];
-              cairo_matrix_transform_point(&mat, &tx, &ty);
-              cairo_move_to(Dev[id].context, tx, ty);
-              for (p = 1; p < np; p++) {
-                tx = px[p]; ty = py[p];
-                cairo_matrix_transform_point(&mat, &tx, &ty);
-                cairo_line_to(Dev[id].context, tx, ty);
-              }
-              cairo_close_path(Dev[id].context);
-            }
+  /* keep the buckets at least twice the labels */
+  if (2*(labels->n + 1) > labels->nbucket)
+    {
+      size = (labels->nbucket > 0) ? 2*labels->nbucket : 64;
+      p = realloc (labels->head, size * sizeof (size_t));
+      if (!p)
+        return 0;
+      labels->head = p;
+      labels->nbucket = size;
+      k = labels->n;
+      _giza_contour_label_reset (labels, labels->cell);
+      for (labels->n = 0; labels->n < k; labels->n++)
+        {
+          b = _giza_contour_label_bucket (labels,
+                                          (long) floor (labels->xya[3*labels->n] / labels->cell),
+                                          (long) floor (labels->xya[3*labels->n+1] / labels->cell));
+          labels->next[labels->n] = labels->head[b];
+          labels->head[b] = labels->n;
         }
     }
 
-  cairo_fill(Dev[id].context);
-
-  _giza_set_trans (oldTrans);
-  if (!oldBuf) giza_end_buffer ();
-  giza_flush_device ();
+  k = labels->n++;
+  labels->xya[3*k] = x;
+  labels->xya[3*k+1] = y;
+  labels->xya[3*k+2] = angle;
+  b = _giza_contour_label_bucket (labels, (long) floor (x / labels->cell),
+                                  (long) floor (y / labels->cell));
+  labels->next[k] = labels->head[b];
+  labels->head[b] = k;
+  return 1;
 }
 
-void
-giza_contour_fill_float (int sizex, int sizey, const float* data, int i1,
-             int i2, int j1, int j2, float c1, float c2, const float *affine)
+/**
+ * Adds the polyline of npts points in xy to the current path with gaps for
+ * labels, which are placed by arc length: the first at first and the rest
+ * every spacing after it, the polyline being measured in grid cells. A
+ * label that would come too near one already placed, on this line or
+ * another, is moved on along the line by its own width until it is clear.
+ * Each gap spans halfw, in world coordinates, either side of its label.
+ * Adds the labels to labels, returning 0 if memory ran out.
+ */
+static int
+_giza_contour_label_line (const double *xy, size_t npts, const cairo_matrix_t *mat,
+                          const double *affine, double halfw, double first, double spacing,
+                          giza_contour_labels_t *labels)
 {
-  double *ddata = malloc(sizeof(double) * sizex * sizey);
-  double daffine[6];
-  int i, j;
-
-  if (!ddata) {
-    _giza_warning("giza_contour_fill_float", "memory allocation failed");
-    return;
-  }
-
-  for (j=j1; j<=j2; j++) {
-      for (i=i1; i<=i2; i++) {
-          ddata[j*sizex+i] = (double) data[j*sizex+i];
-      }
-  }
-
-  for (i=0; i<6; i++) {
-     daffine[i] = (double) affine[i];
-  }
+  double sa, sb, t, e, len, wlen, dx, dy, hw, x, y, wx, wy, next, *gap;
+  size_t q, g, size, ngap = 0;
+  int pen = 0;
+
+  /* find the labels and the stretch of line each one blanks out, as arc
+   * lengths measured in the cells of the segment that holds the label */
+  next = first;
+  sa = 0.;
+  for (q = 0; q + 1 < npts; q++)
+    {
+      dx = xy[2*q+2] - xy[2*q];
+      dy = xy[2*q+3] - xy[2*q+1];
+      len = sqrt (dx*dx + dy*dy);
+      wlen = hypot (affine[0]*dx + affine[2]*dy, affine[1]*dx + affine[3]*dy);
+      sb = sa + len;
+      hw = (wlen > 0.) ? halfw * len / wlen : 0.;
+      while (len > 0. && next <= sb)
+        {
+          /* where the label would go, from grid to world coordinates */
+          t = (next - sa) / len;
+          x = xy[2*q] + t*dx;
+          y = xy[2*q+1] + t*dy;
+          wx = affine[4] + affine[0]*x + affine[2]*y;
+          wy = affine[5] + affine[1]*x + affine[3]*y;
+          if (!_giza_contour_label_clear (labels, wx, wy))
+            {
+              next += (hw > 0.) ? hw : spacing;
+              continue;
+            }
+          if (ngap + 1 > labels->maxgap)
+            {
+              size = (labels->maxgap > 0) ? 2*labels->maxgap : 16;
+              gap = realloc (labels->gap, 2 * size * sizeof (double));
+              if (!gap)
+                return 0;
+              labels->gap = gap;
+              labels->maxgap = size;
+            }
+          if (!_giza_contour_label_add (labels, wx, wy, atan2 (dy, dx) * 180.0 / M_PI))
+            return 0;
+          labels->gap[2*ngap] = next - hw;
+          labels->gap[2*ngap+1] = next + hw;
+          ngap++;
+          next += spacing;
+        }
+      sa = sb;
+    }
+  gap = labels->gap;
 
-  giza_contour_fill (sizex, sizey, ddata, i1, i2, j1, j2,
-                     (double) c1, (double) c2, daffine);
-  free(ddata);
+  /* draw what is left outside the gaps */
+  sa = 0.;
+  g = 0;
+  for (q = 0; q + 1 < npts; q++)
+    {
+      dx = xy[2*q+2] - xy[2*q];
+      dy = xy[2*q+3] - xy[2*q+1];
+      len = sqrt (dx*dx + dy*dy);
+      sb = sa + len;
+      t = sa;
+      for (;;)
+        {
+          while (g < ngap && gap[2*g+1] <= t)
+            g++;
+          if (g < ngap && gap[2*g] <= t)
+            {
+              pen = 0;
+              t = gap[2*g+1];
+              if (t >= sb)
+                break;
+              continue;
+            }
+          e = (g < ngap && gap[2*g] < sb) ? gap[2*g] : sb;
+          if (!pen)
+            {
+              x = xy[2*q] + ((len > 0.) ? (t - sa)/len : 0.) * dx;
+              y = xy[2*q+1] + ((len > 0.) ? (t - sa)/len : 0.) * dy;
+              cairo_matrix_transform_point (mat, &x, &y);
+              cairo_move_to (Dev[id].context, x, y);
+              pen = 1;
+            }
+          x = xy[2*q] + ((len > 0.) ? (e - sa)/len : 0.) * dx;
+          y = xy[2*q+1] + ((len > 0.) ? (e - sa)/len : 0.) * dy;
+          cairo_matrix_transform_point (mat, &x, &y);
+          cairo_line_to (Dev[id].context, x, y);
+          if (e >= sb)
+            break;
+          t = e;
+        }
+      sa = sb;
+    }
+  return 1;
 }
 
 /*
  * giza_contour_labelled -- contour with labels
  *
  * Traces a single contour level and places text labels along the contour.
- * intval: spacing in grid cells between labels
+ * intval: spacing in grid cells between labels, by length along the contour
  * minint: minimum grid cells between labels
  * label: text string to draw
  */
 
-/* Segment storage for contour tracing */
-typedef struct {
-  double x1, y1, x2, y2;
-} _giza_seg;
-
-void
-giza_contour_labelled (int sizex, int sizey, const double* data, int i1,
+/**
+ * Draws a labelled contour for giza_contour_labelled and
+ * giza_contour_labelled_float, reading data of either type in place
+ */
+static void
+_giza_contour_labelled (const char *caller, int sizex, int type, const void *data, int i1,
              int i2, int j1, int j2, double c,
              const double *affine, const char *label,
              int intval, int minint)
 {
-#define xsect_l(p1,p2) (hl[p2]*xhl[p1]-hl[p1]*xhl[p2])/(hl[p2]-hl[p1])
-#define ysect_l(p1,p2) (hl[p2]*yhl[p1]-hl[p1]*yhl[p2])/(hl[p2]-hl[p1])
-
-  if (!_giza_check_device_ready ("giza_contour_labelled"))
+  if (!_giza_check_device_ready ((char *) caller))
     return;
 
   if (intval <= 0) intval = 20;
   if (minint <= 0) minint = 10;
 
   cairo_matrix_t mat;
-  int sh[5];
-  double hl[5];
-  double xhl[5], yhl[5];
-  int im[4] = { 0, 1, 1, 0 };
-  int jm[4] = { 0, 0, 1, 1 };
-  double temp1, temp2, dmin, dmax, x1 = 0., x2 = 0., y1 = 0., y2 = 0.;
-  int i, j, m;
-  int m1, m2, m3, case_value;
-  int castab[3][3][3] = {
-    {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
-    {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
-    {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}}
-  };
+  giza_contour_lines_t *lines = &_giza_contour_label_lines;
+  giza_contour_labels_t *labels = &_giza_contour_labels;
+  double xch, ych, halfw;
+  size_t k;
+
+  /* Collect all contour segments for this level and join them up */
+  if (!_giza_contour_extract (sizex, type, data, i1, i2, j1, j2, 1, &c, NULL,
+                              &_giza_contour_label_segs, lines))
+    _giza_warning (caller, "memory allocation failed, contour incomplete");
 
   int oldBuf;
   giza_get_buffering(&oldBuf);
@@ -666,196 +1384,52 @@ giza_contour_labelled (int sizex, int sizey, const double* data, int i1,
 
   int oldTrans = _giza_get_trans ();
   _giza_set_trans (GIZA_TRANS_WORLD);
+
+  /* half the width of a label in world coordinates (approximate) */
+  giza_get_character_size(GIZA_UNITS_WORLD, &xch, &ych);
+  halfw = (label && label[0]) ? 0.5 * strlen(label) * xch * 0.6 : 0.;
+  _giza_contour_label_reset (labels, 2.*halfw);
+
   cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
                    affine[4], affine[5]);
   cairo_transform (Dev[id].context, &mat);
   cairo_get_matrix (Dev[id].context, &mat);
   _giza_set_trans (GIZA_TRANS_IDEN);
 
-  /* Collect all contour segments for this level */
-  int nseg = 0;
-  int maxseg = (i2 - i1) * (j2 - j1) * 4;
-  if (maxseg < 64) maxseg = 64;
-  _giza_seg *segs = (_giza_seg *) malloc(maxseg * sizeof(_giza_seg));
-  if (!segs) {
-    _giza_set_trans(oldTrans);
-    if (!oldBuf) giza_end_buffer();
-    return;
-  }
-
-  for (j = (j2 - 1); j >= j1; j--)
+  /* Draw the lines with gaps for the labels, which go every intval
+   * cells along each line (but no closer than minint), starting half an
+   * interval from its start */
+  for (k = 0; k < lines->nline; k++)
     {
-      for (i = i1; i < i2; i++)
-       {
-         temp1 = MIN (data[j*sizex+i], data[(j + 1)*sizex+i]);
-         temp2 = MIN (data[j*sizex+(i + 1)], data[(j + 1)*sizex+(i + 1)]);
-         dmin = MIN (temp1, temp2);
-
-         temp1 = MAX (data[j*sizex+i], data[(j + 1)*sizex+i]);
-         temp2 = MAX (data[j*sizex+(i + 1)], data[(j + 1)*sizex+(i + 1)]);
-         dmax = MAX (temp1, temp2);
-
-         if (dmax < c || dmin > c)
-           continue;
-
-         for (m = 4; m >= 0; m--)
-           {
-             if (m > 0)
-               {
-                 hl[m] = data[(j + jm[m - 1])*sizex+(i + im[m - 1])] - c;
-                 xhl[m] = i + im[m - 1] + 0.5;
-                 yhl[m] = j + jm[m - 1] + 0.5;
-               }
-             else
-               {
-                 hl[0] = 0.25 * (hl[1] + hl[2] + hl[3] + hl[4]);
-                 xhl[0] = 0.5 * (i + i + 1) + 0.5;
-                 yhl[0] = 0.5 * (j + j + 1) + 0.5;
-               }
-             if (hl[m] > 0.0) sh[m] = 1;
-             else if (hl[m] < 0.0) sh[m] = -1;
-             else sh[m] = 0;
-           }
-
-         for (m = 1; m <= 4; ++m)
-           {
-             m1 = m; m2 = 0;
-             m3 = (m != 4) ? m + 1 : 1;
-
-             if ((case_value = castab[sh[m1]+1][sh[m2]+1][sh[m3]+1]) == 0)
-               continue;
-
-             switch (case_value)
-               {
-               case 1: x1=xhl[m1]; y1=yhl[m1]; x2=xhl[m2]; y2=yhl[m2]; break;
-               case 2: x1=xhl[m2]; y1=yhl[m2]; x2=xhl[m3]; y2=yhl[m3]; break;
-               case 3: x1=xhl[m3]; y1=yhl[m3]; x2=xhl[m1]; y2=yhl[m1]; break;
-               case 4: x1=xhl[m1]; y1=yhl[m1]; x2=xsect_l(m2,m3); y2=ysect_l(m2,m3); break;
-               case 5: x1=xhl[m2]; y1=yhl[m2]; x2=xsect_l(m3,m1); y2=ysect_l(m3,m1); break;
-               case 6: x1=xhl[m3]; y1=yhl[m3]; x2=xsect_l(m3,m2); y2=ysect_l(m3,m2); break;
-               case 7: x1=xsect_l(m1,m2); y1=ysect_l(m1,m2); x2=xsect_l(m2,m3); y2=ysect_l(m2,m3); break;
-               case 8: x1=xsect_l(m2,m3); y1=ysect_l(m2,m3); x2=xsect_l(m3,m1); y2=ysect_l(m3,m1); break;
-               case 9: x1=xsect_l(m3,m1); y1=ysect_l(m3,m1); x2=xsect_l(m1,m2); y2=ysect_l(m1,m2); break;
-               default: break;
-               }
-
-             if (nseg < maxseg) {
-               segs[nseg].x1 = x1; segs[nseg].y1 = y1;
-               segs[nseg].x2 = x2; segs[nseg].y2 = y2;
-               nseg++;
-             }
-           }
-       }
-    }
-
-  /* Draw segments and place labels.
-   * Walk segments, accumulating distance. Every intval cells, place a label.
-   * Minimum gap between labels is minint cells. */
-  double dist_since_label = 0.0;
-  double total_dist = 0.0;
-
-  /* First compute total contour length for initial offset */
-  for (i = 0; i < nseg; i++) {
-    double dx = segs[i].x2 - segs[i].x1;
-    double dy = segs[i].y2 - segs[i].y1;
-    total_dist += sqrt(dx*dx + dy*dy);
-  }
-
-  /* Start labeling after half the interval so labels are nicely distributed */
-  double next_label = intval * 0.5;
-  double accum = 0.0;
-
-  for (i = 0; i < nseg; i++) {
-    double sx1 = segs[i].x1, sy1 = segs[i].y1;
-    double sx2 = segs[i].x2, sy2 = segs[i].y2;
-    double dx = sx2 - sx1, dy = sy2 - sy1;
-    double seglen = sqrt(dx*dx + dy*dy);
-
-    int drew_label = 0;
-
-    /* Check if label should be placed along this segment */
-    if (label && label[0] && seglen > 0.0 && accum + seglen >= next_label) {
-      double t = (next_label - accum) / seglen;
-      double lx = sx1 + t*dx;
-      double ly = sy1 + t*dy;
-      double angle_rad = atan2(dy, dx);
-      double angle_deg = angle_rad * 180.0 / M_PI;
-
-      /* Transform label position */
-      double tlx = lx, tly = ly;
-      cairo_matrix_transform_point(&mat, &tlx, &tly);
-
-      /* Get character height for gap sizing */
-      double xch, ych;
-      giza_get_character_size(GIZA_UNITS_WORLD, &xch, &ych);
-
-      /* Compute label width in grid units (approximate) */
-      int llen = strlen(label);
-      double label_half_w = 0.5 * llen * xch * 0.6; /* approximate */
-
-      /* Draw the segment in two parts with a gap for the label */
-      /* First part: from segment start to gap start */
-      double gap_t1 = t - label_half_w / (seglen > 0 ? seglen : 1.0);
-      double gap_t2 = t + label_half_w / (seglen > 0 ? seglen : 1.0);
-      if (gap_t1 < 0.0) gap_t1 = 0.0;
-      if (gap_t2 > 1.0) gap_t2 = 1.0;
-
-      if (gap_t1 > 0.01) {
-        double tx1 = sx1, ty1 = sy1;
-        double tx2 = sx1 + gap_t1*dx, ty2 = sy1 + gap_t1*dy;
-        cairo_matrix_transform_point(&mat, &tx1, &ty1);
-        cairo_matrix_transform_point(&mat, &tx2, &ty2);
-        cairo_move_to(Dev[id].context, tx1, ty1);
-        cairo_line_to(Dev[id].context, tx2, ty2);
-        cairo_stroke(Dev[id].context);
-      }
-      if (gap_t2 < 0.99) {
-        double tx1 = sx1 + gap_t2*dx, ty1 = sy1 + gap_t2*dy;
-        double tx2 = sx2, ty2 = sy2;
-        cairo_matrix_transform_point(&mat, &tx1, &ty1);
-        cairo_matrix_transform_point(&mat, &tx2, &ty2);
-        cairo_move_to(Dev[id].context, tx1, ty1);
-        cairo_line_to(Dev[id].context, tx2, ty2);
-        cairo_stroke(Dev[id].context);
-      }
-
-      /* Draw the label.
-       * The affine maps grid -> world: world_x = affine[4] + affine[0]*lx + affine[2]*ly
-       * lx, ly are grid coords; giza_ptext expects world coords. */
-      _giza_set_trans(GIZA_TRANS_WORLD);
-      double wx = affine[4] + affine[0]*lx + affine[2]*ly;
-      double wy = affine[5] + affine[1]*lx + affine[3]*ly;
-      giza_ptext(wx, wy, angle_deg, 0.5, label);
-      _giza_set_trans(GIZA_TRANS_IDEN);
-
-      next_label += (double)intval;
-      if (next_label - (accum + seglen) < (double)minint)
-        next_label = accum + seglen + (double)minint;
-      drew_label = 1;
-    }
-
-    if (!drew_label) {
-      /* Draw the full segment */
-      double tx1 = sx1, ty1 = sy1;
-      double tx2 = sx2, ty2 = sy2;
-      cairo_matrix_transform_point(&mat, &tx1, &ty1);
-      cairo_matrix_transform_point(&mat, &tx2, &ty2);
-      cairo_move_to(Dev[id].context, tx1, ty1);
-      cairo_line_to(Dev[id].context, tx2, ty2);
-      cairo_stroke(Dev[id].context);
+      if (!_giza_contour_label_line (lines->xy + 2*lines->start[k],
+                                     lines->start[k+1] - lines->start[k], &mat, affine,
+                                     halfw, (halfw > 0.) ? 0.5*intval : HUGE_VAL,
+                                     (double) MAX (intval, minint), labels))
+        {
+          _giza_warning (caller, "memory allocation failed, labels incomplete");
+          break;
+        }
     }
+  cairo_stroke (Dev[id].context);
 
-    accum += seglen;
-  }
-
-  free(segs);
+  /* Draw the labels, which are in world coordinates already */
+  _giza_set_trans(GIZA_TRANS_WORLD);
+  for (k = 0; k < labels->n; k++)
+    giza_ptext(labels->xya[3*k], labels->xya[3*k+1], labels->xya[3*k+2], 0.5, label);
 
   _giza_set_trans (oldTrans);
   if (!oldBuf) giza_end_buffer ();
   giza_flush_device ();
+}
 
-#undef xsect_l
-#undef ysect_l
+void
+giza_contour_labelled (int sizex, int sizey, const double* data, int i1,
+             int i2, int j1, int j2, double c,
+             const double *affine, const char *label,
+             int intval, int minint)
+{
+  _giza_contour_labelled ("giza_contour_labelled", sizex, GIZA_DATA_DOUBLE, data,
+                          i1, i2, j1, j2, c, affine, label, intval, minint);
 }
 
 void
@@ -864,26 +1438,13 @@ giza_contour_labelled_float (int sizex, int sizey, const float* data, int i1,
              const float *affine, const char *label,
              int intval, int minint)
 {
-  double *ddata = malloc(sizeof(double) * sizex * sizey);
   double daffine[6];
-  int i, j;
-
-  if (!ddata) {
-    _giza_warning("giza_contour_labelled_float", "memory allocation failed");
-    return;
-  }
-
-  for (j=j1; j<=j2; j++) {
-      for (i=i1; i<=i2; i++) {
-          ddata[j*sizex+i] = (double) data[j*sizex+i];
-      }
-  }
+  int i;
 
   for (i=0; i<6; i++) {
      daffine[i] = (double) affine[i];
   }
 
-  giza_contour_labelled (sizex, sizey, ddata, i1, i2, j1, j2,
-                         (double) c, daffine, label, intval, minint);
-  free(ddata);
+  _giza_contour_labelled ("giza_contour_labelled_float", sizex, GIZA_DATA_FLOAT, data,
+                          i1, i2, j1, j2, (double) c, daffine, label, intval, minint);
 }
@@ -32,6 +32,7 @@
 #include "giza.h"
 #include "giza-private.h"
 #include "giza-io-private.h" /* for _giza_error() */
+#include "giza-contour-private.h"
 #include "giza-driver-xw-private.h"
 #include "giza-driver-eps-private.h"
 #include "giza-driver-osxcocoa-private.h"
@@ -261,6 +262,10 @@ void cpgcont(const float *a, int idim, int jdim, int i1, int i2, \
  * Like cpgcont but uses a user-supplied callback instead of a
  * tr matrix. The callback receives grid-index coordinates (1-based)
  * and is responsible for transforming to world coords and drawing.
+ * Each contour is passed as a whole line, one level after another.
+ * This is kept for compatibility: when the grid is curvilinear and
+ * its world coordinates are known, giza_contour_curvilinear_float
+ * draws the contours directly without a call per point.
  *
  * plot(visble, x, y, z):
  *   visble=0: move to (x,y)
@@ -274,23 +279,11 @@ void cpgconx(const float *a, int idim, int jdim, int i1, int i2,
 {
   if (!plot) return;
 
-#define xsect_cx(p1,p2) (hcx[p2]*xhcx[p1]-hcx[p1]*xhcx[p2])/(hcx[p2]-hcx[p1])
-#define ysect_cx(p1,p2) (hcx[p2]*yhcx[p1]-hcx[p1]*yhcx[p2])/(hcx[p2]-hcx[p1])
-
-  int sh[5];
-  float hcx[5];
-  float xhcx[5], yhcx[5];
-  int im[4] = { 0, 1, 1, 0 };
-  int jm[4] = { 0, 0, 1, 1 };
-  float temp1, temp2, dmin, dmax;
-  float x1 = 0.f, x2 = 0.f, y1 = 0.f, y2 = 0.f;
-  int i, j, k, m;
-  int m1, m2, m3, case_value;
-  int castab[3][3][3] = {
-    {{0, 0, 8}, {0, 2, 5}, {7, 6, 9}},
-    {{0, 3, 4}, {1, 3, 1}, {4, 3, 0}},
-    {{9, 6, 7}, {5, 2, 0}, {8, 0, 0}}
-  };
+  giza_contour_lines_t *lines;
+  double *dc;
+  float x, y, z;
+  size_t l, n;
+  int k, vis;
   int nca = abs(nc);
 
   /* Iterate over grid cells using 0-based internal indices,
@@ -298,81 +291,41 @@ void cpgconx(const float *a, int idim, int jdim, int i1, int i2,
   int ci1 = i1 - 1, ci2 = i2 - 1;
   int cj1 = j1 - 1, cj2 = j2 - 1;
 
-  for (j = cj2 - 1; j >= cj1; j--)
-    {
-      for (i = ci1; i < ci2; i++)
-       {
-         temp1 = MIN(a[j*idim+i], a[(j+1)*idim+i]);
-         temp2 = MIN(a[j*idim+(i+1)], a[(j+1)*idim+(i+1)]);
-         dmin = MIN(temp1, temp2);
-
-         temp1 = MAX(a[j*idim+i], a[(j+1)*idim+i]);
-         temp2 = MAX(a[j*idim+(i+1)], a[(j+1)*idim+(i+1)]);
-         dmax = MAX(temp1, temp2);
-
-         if (dmax < c[0] || dmin > c[nca - 1])
-           continue;
-
-         for (k = 0; k < nca; ++k)
-           {
-             if (c[k] < dmin || c[k] > dmax)
-               continue;
-             for (m = 4; m >= 0; m--)
-               {
-                 if (m > 0)
-                   {
-                     hcx[m] = a[(j + jm[m-1])*idim + (i + im[m-1])] - c[k];
-                     /* Grid indices: 1-based for pgplot callback */
-                     xhcx[m] = (float)(i + im[m-1] + 1);
-                     yhcx[m] = (float)(j + jm[m-1] + 1);
-                   }
-                 else
-                   {
-                     hcx[0] = 0.25f * (hcx[1] + hcx[2] + hcx[3] + hcx[4]);
-                     xhcx[0] = 0.5f * (float)(i + i + 1 + 1);
-                     yhcx[0] = 0.5f * (float)(j + j + 1 + 1);
-                   }
-                 if (hcx[m] > 0.0f) sh[m] = 1;
-                 else if (hcx[m] < 0.0f) sh[m] = -1;
-                 else sh[m] = 0;
-               }
-
-             for (m = 1; m <= 4; ++m)
-               {
-                 m1 = m; m2 = 0;
-                 m3 = (m != 4) ? m + 1 : 1;
-
-                 if ((case_value =
-                      castab[sh[m1]+1][sh[m2]+1][sh[m3]+1]) == 0)
-                   continue;
-
-                 switch (case_value)
-                   {
-                   case 1: x1=xhcx[m1]; y1=yhcx[m1]; x2=xhcx[m2]; y2=yhcx[m2]; break;
-                   case 2: x1=xhcx[m2]; y1=yhcx[m2]; x2=xhcx[m3]; y2=yhcx[m3]; break;
-                   case 3: x1=xhcx[m3]; y1=yhcx[m3]; x2=xhcx[m1]; y2=yhcx[m1]; break;
-                   case 4: x1=xhcx[m1]; y1=yhcx[m1]; x2=xsect_cx(m2,m3); y2=ysect_cx(m2,m3); break;
-                   case 5: x1=xhcx[m2]; y1=yhcx[m2]; x2=xsect_cx(m3,m1); y2=ysect_cx(m3,m1); break;
-                   case 6: x1=xhcx[m3]; y1=yhcx[m3]; x2=xsect_cx(m3,m2); y2=ysect_cx(m3,m2); break;
-                   case 7: x1=xsect_cx(m1,m2); y1=ysect_cx(m1,m2); x2=xsect_cx(m2,m3); y2=ysect_cx(m2,m3); break;
-                   case 8: x1=xsect_cx(m2,m3); y1=ysect_cx(m2,m3); x2=xsect_cx(m3,m1); y2=ysect_cx(m3,m1); break;
-                   case 9: x1=xsect_cx(m3,m1); y1=ysect_cx(m3,m1); x2=xsect_cx(m1,m2); y2=ysect_cx(m1,m2); break;
-                   default: break;
-                   }
-                 /* Call user callback: move to start, draw to end */
-                 {
-                   int vis0 = 0, vis1 = 1;
-                   float z = c[k];
-                   plot(&vis0, &x1, &y1, &z);
-                   plot(&vis1, &x2, &y2, &z);
-                 }
-               }
-           }
-       }
-    }
+  if (nca == 0 || ci2 <= ci1 || cj2 <= cj1) return;
+
+  dc = malloc(sizeof(double) * nca);
+  lines = calloc(nca, sizeof(giza_contour_lines_t));
+  if (!dc || !lines) {
+     _giza_warning("cpgconx", "memory allocation failed");
+     free(dc);
+     free(lines);
+     return;
+  }
+  for (k = 0; k < nca; k++) {
+      dc[k] = (double) c[k];
+  }
+
+  /* find the contours as polylines with the same kernel as giza_contour,
+   * then hand each one to the callback, level by level */
+  if (!_giza_contour_extract(idim, GIZA_DATA_FLOAT, a, ci1, ci2, cj1, cj2, nca, dc, NULL, NULL, lines))
+     _giza_warning("cpgconx", "memory allocation failed, contours incomplete");
+
+  for (k = 0; k < nca; k++) {
+      z = c[k];
+      for (l = 0; l < lines[k].nline; l++) {
+          for (n = lines[k].start[l]; n < lines[k].start[l+1]; n++) {
+              /* grid indices are 1-based for the pgplot callback */
+              vis = (n > lines[k].start[l]);
+              x = (float) (lines[k].xy[2*n] + 0.5);
+              y = (float) (lines[k].xy[2*n+1] + 0.5);
+              plot(&vis, &x, &y, &z);
+          }
+      }
+      _giza_contour_free_lines(&lines[k]);
+  }
 
-#undef xsect_cx
-#undef ysect_cx
+  free(lines);
+  free(dc);
 }
 
 /***************************************************************
@@ -0,0 +1,297 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+#include "giza-io-private.h"
+#include "giza-private.h"
+#include "giza-transforms-private.h"
+#include "giza-render-private.h"
+#include "giza-threads-private.h"
+#include <giza.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+/* packed pixels being converted to cairo's format */
+typedef struct
+{
+  const unsigned char *data;
+  int nchannels;
+  int sizex, i1, j1, width, stride;
+  unsigned char *pixdata;
+} giza_rgb_band_t;
+
+static int _giza_check_pixel_range (const char *caller, int sizex, int sizey,
+                                    int i1, int *i2, int j1, int *j2);
+static void _giza_rgb_band (void *arg, int start, int end, int band);
+static void _giza_draw_rgb (const char *caller, int nchannels, int sizex, int sizey,
+                            const unsigned char *data, int i1, int i2, int j1, int j2,
+                            double xmin, double xmax, double ymin, double ymax,
+                            int extend, int filter);
+static void _giza_paint_argb32 (unsigned char *pixdata, int width, int height, int stride,
+                                double xmin, double xmax, double ymin, double ymax,
+                                int extend, int filter);
+
+/**
+ * Drawing: giza_draw_rgb
+ *
+ * Synopsis: Draws an image of pre-coloured pixels, given as red, green and blue bytes
+ *
+ * The pixels are drawn as they are, without using the colour table, filling
+ * the given box in world coordinates; the extend and filter options and
+ * clipping are as for giza_render.
+ *
+ * Input:
+ *  -sizex  :- The dimensions of the image in the x-direction
+ *  -sizey  :- The dimensions of the image in the y-direction
+ *  -rgb    :- The pixels, three bytes (red, green, blue) each, one row
+ *             after another starting from the bottom
+ *  -i1     :- The inclusive range of pixels to draw in the x dimension.
+ *  -i2     :- The inclusive range of pixels to draw in the x dimension.
+ *  -j1     :- The inclusive range of pixels to draw in the y direction
+ *  -j2     :- The inclusive range of pixels to draw in the y direction
+ *  -xmin   :- world coordinate corresponding to left of pixel array
+ *  -xmax   :- world coordinate corresponding to right of pixel array
+ *  -ymin   :- world coordinate corresponding to bottom of pixel array
+ *  -ymax   :- world coordinate corresponding to top of pixel array
+ *  -extend :- Option for how to deal with image at edges (see giza_render)
+ *  -filter :- Option for how to interpolate between pixels (see giza_render)
+ *
+ * See Also: giza_draw_rgba, giza_draw_argb32, giza_draw_pixels
+ */
+void
+giza_draw_rgb (int sizex, int sizey, const unsigned char *rgb, int i1, int i2,
+               int j1, int j2, double xmin, double xmax, double ymin, double ymax,
+               int extend, int filter)
+{
+  _giza_draw_rgb ("giza_draw_rgb", 3, sizex, sizey, rgb, i1, i2, j1, j2,
+                  xmin, xmax, ymin, ymax, extend, filter);
+}
+
+/**
+ * Drawing: giza_draw_rgba
+ *
+ * Synopsis: Same as giza_draw_rgb, but each pixel also has an alpha (opacity) byte
+ *
+ * Input:
+ *  -rgba :- The pixels, four bytes (red, green, blue, alpha) each; the
+ *           colours are not premultiplied by alpha
+ *
+ * See Also: giza_draw_rgb, giza_draw_argb32
+ */
+void
+giza_draw_rgba (int sizex, int sizey, const unsigned char *rgba, int i1, int i2,
+                int j1, int j2, double xmin, double xmax, double ymin, double ymax,
+                int extend, int filter)
+{
+  _giza_draw_rgb ("giza_draw_rgba", 4, sizex, sizey, rgba, i1, i2, j1, j2,
+                  xmin, xmax, ymin, ymax, extend, filter);
+}
+
+/**
+ * Drawing: giza_draw_argb32
+ *
+ * Synopsis: Same as giza_draw_rgba, but takes pixels in cairo's own format,
+ *           which are drawn without being copied
+ *
+ * Input:
+ *  -stride :- Bytes from the start of one row to the next
+ *  -argb   :- The pixels, each a 32-bit integer in native byte order holding
+ *             alpha, red, green and blue from the most significant byte down,
+ *             with the colours premultiplied by alpha (CAIRO_FORMAT_ARGB32)
+ *
+ * See Also: giza_draw_rgba
+ */
+void
+giza_draw_argb32 (int sizex, int sizey, int stride, const unsigned char *argb, int i1, int i2,
+                  int j1, int j2, double xmin, double xmax, double ymin, double ymax,
+                  int extend, int filter)
+{
+  if (!_giza_check_device_ready ("giza_draw_argb32"))
+    return;
+  if (stride < 4*sizex)
+    {
+      _giza_warning ("giza_draw_argb32", "Invalid stride, skipping render.");
+      return;
+    }
+  if (!_giza_check_pixel_range ("giza_draw_argb32", sizex, sizey, i1, &i2, j1, &j2))
+    return;
+
+  int width = i2 - i1 + 1, height = j2 - j1 + 1;
+  const unsigned char *first = argb + (size_t) j1 * stride + 4 * (size_t) i1;
+
+  /* cairo wants whole 32-bit pixels on each row, otherwise repack them */
+  if (stride % 4 != 0 || (uintptr_t) first % 4 != 0)
+    {
+      int cstride = 4*width, j;
+      unsigned char *pixdata = malloc ((size_t) cstride * (size_t) height);
+
+      if (!pixdata)
+        {
+          _giza_warning ("giza_draw_argb32", "Allocation failed, skipping render.");
+          return;
+        }
+      for (j = 0; j < height; j++)
+        memcpy (pixdata + (size_t) j * cstride, first + (size_t) j * stride, (size_t) cstride);
+      _giza_paint_argb32 (pixdata, width, height, cstride, xmin, xmax, ymin, ymax,
+                          extend, filter);
+      free (pixdata);
+      return;
+    }
+
+  /* cairo only reads from a source surface */
+  _giza_paint_argb32 ((unsigned char *) first, width, height, stride,
+                      xmin, xmax, ymin, ymax, extend, filter);
+}
+
+/* checks the range of pixels to draw, clamping it to the array */
+static int
+_giza_check_pixel_range (const char *caller, int sizex, int sizey,
+                         int i1, int *i2, int j1, int *j2)
+{
+  if (sizex < 1 || sizey < 1)
+    {
+      _giza_warning (caller, "Invalid array size, skipping render.");
+      return 0;
+    }
+  if (i1 < 0 || *i2 < i1 || j1 < 0 || *j2 < j1)
+    {
+      _giza_warning (caller, "Invalid index range, skipping render.");
+      return 0;
+    }
+  /* Clamp indices to array bounds to avoid OOB reads */
+  if (*i2 >= sizex) *i2 = sizex - 1;
+  if (*j2 >= sizey) *j2 = sizey - 1;
+  if (i1 >= sizex || j1 >= sizey)
+    {
+      _giza_warning (caller, "Index range outside array bounds, skipping render.");
+      return 0;
+    }
+  return 1;
+}
+
+static void
+_giza_draw_rgb (const char *caller, int nchannels, int sizex, int sizey,
+                const unsigned char *data, int i1, int i2, int j1, int j2,
+                double xmin, double xmax, double ymin, double ymax,
+                int extend, int filter)
+{
+  giza_rgb_band_t b;
+  int height, nbands;
+
+  if (!_giza_check_device_ready ((char *) caller))
+    return;
+  if (!_giza_check_pixel_range (caller, sizex, sizey, i1, &i2, j1, &j2))
+    return;
+
+  b.data = data;
+  b.nchannels = nchannels;
+  b.sizex = sizex;
+  b.i1 = i1;
+  b.j1 = j1;
+  b.width = i2 - i1 + 1;
+  height = j2 - j1 + 1;
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 6, 0)
+  b.stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, b.width);
+#else
+  b.stride = 4*b.width;
+#endif
+  b.pixdata = malloc ((size_t) b.stride * (size_t) height);
+  if (!b.pixdata)
+    {
+      _giza_warning (caller, "Allocation failed, skipping render.");
+      return;
+    }
+
+  nbands = _giza_thread_bands (height, (GIZA_RENDER_BAND_PIXELS + b.width - 1)/b.width);
+  _giza_parallel_for (nbands, height, _giza_rgb_band, &b);
+
+  _giza_paint_argb32 (b.pixdata, b.width, height, b.stride, xmin, xmax, ymin, ymax,
+                      extend, filter);
+  free (b.pixdata);
+}
+
+/* packs rows start..end-1 of RGB or RGBA bytes as premultiplied ARGB32 */
+static void
+_giza_rgb_band (void *arg, int start, int end, int band)
+{
+  const giza_rgb_band_t *b = (const giza_rgb_band_t *) arg;
+  const unsigned char *in;
+  uint32_t *row, a;
+  int i, j;
+
+  for (j = start; j < end; j++)
+    {
+      in = b->data + ((size_t) (b->j1 + j) * b->sizex + b->i1) * b->nchannels;
+      row = (uint32_t *) (b->pixdata + (size_t) j * b->stride);
+      if (b->nchannels == 3)
+        {
+          for (i = 0; i < b->width; i++, in += 3)
+            row[i] = ((uint32_t) 255 << 24) | ((uint32_t) in[0] << 16)
+                   | ((uint32_t) in[1] << 8) | (uint32_t) in[2];
+        }
+      else
+        {
+          for (i = 0; i < b->width; i++, in += 4)
+            {
+              a = in[3];
+              row[i] = (a << 24) | (((in[0]*a + 127)/255) << 16)
+                     | (((in[1]*a + 127)/255) << 8) | ((in[2]*a + 127)/255);
+            }
+        }
+    }
+}
+
+/* paints ARGB32 pixels into a box in world coordinates, as giza_render would */
+static void
+_giza_paint_argb32 (unsigned char *pixdata, int width, int height, int stride,
+                    double xmin, double xmax, double ymin, double ymax,
+                    int extend, int filter)
+{
+  cairo_extend_t cairoextendtype;
+  cairo_filter_t cairofiltertype;
+  cairo_surface_t *pixmap;
+  cairo_matrix_t mat;
+
+  _giza_get_extend (extend, &cairoextendtype);
+  _giza_get_filter (filter, &cairofiltertype);
+
+  int oldTrans = _giza_get_trans ();
+  _giza_set_trans (GIZA_TRANS_WORLD);
+
+  cairo_save (Dev[id].context);
+  _giza_clip_to_window ();
+  cairo_matrix_init (&mat, (xmax - xmin)/width, 0., 0., (ymax - ymin)/height, xmin, ymin);
+  cairo_transform (Dev[id].context, &mat);
+
+  pixmap = cairo_image_surface_create_for_data (pixdata, CAIRO_FORMAT_ARGB32,
+                                                width, height, stride);
+  cairo_set_source_surface (Dev[id].context, pixmap, 0, 0);
+  cairo_pattern_set_extend (cairo_get_source (Dev[id].context), cairoextendtype);
+  cairo_pattern_set_filter (cairo_get_source (Dev[id].context), cairofiltertype);
+  cairo_paint (Dev[id].context);
+
+  cairo_restore (Dev[id].context);
+  _giza_set_trans (oldTrans);
+  cairo_surface_destroy (pixmap);
+
+  giza_flush_device ();
+}
@@ -0,0 +1,542 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+/*
+ * Persistent images: the data section, the colour indices it maps to and
+ * the coloured pixmap are kept between draws, so redrawing an unchanged
+ * image only costs the paint. The colour indices are recomputed when the
+ * data, the image transfer function or the colour index range change, and
+ * the pixmap is recoloured when the colours of those indices change.
+ */
+
+#include "giza-io-private.h"
+#include "giza-private.h"
+#include "giza-transforms-private.h"
+#include "giza-itf.h"
+#include "giza-render-private.h"
+#include "giza-colour-private.h"
+#include "giza-threads-private.h"
+#include <giza.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef struct
+{
+  int width, height;
+  int isfloat;
+  int transparent;
+  void *data;                 /* copy of the data section, width*height */
+  double valMin, valMax;
+
+  int mapped;                 /* idx is up to date for itf, cimin, cimax */
+  int itf, cimin, cimax;
+  const double *itflut;       /* table for itf while mapping, or NULL */
+  int *idx;
+
+  int coloured;               /* pixdata is up to date for lut */
+  uint32_t lut[GIZA_CTAB_LUT_SIZE];
+  int stride;
+  unsigned char *pixdata;
+  cairo_surface_t *surface;
+} giza_image_t;
+
+static giza_image_t **_giza_images = NULL;
+static int _giza_nimages = 0;
+
+static int _giza_image_new (const char *caller, int isfloat, int sizex, int sizey,
+                            const void *data, int i1, int i2, int j1, int j2,
+                            double valMin, double valMax, int transparent);
+static void _giza_image_update (const char *caller, int image, int isfloat,
+                                int sizex, int sizey, const void *data,
+                                int i1, int i2, int j1, int j2,
+                                double valMin, double valMax);
+static int _giza_image_set (const char *caller, giza_image_t *img, int isfloat,
+                            int sizex, int sizey, const void *data,
+                            int i1, int i2, int j1, int j2);
+static giza_image_t *_giza_image_get (const char *caller, int image);
+static void _giza_image_free (giza_image_t *img);
+static void _giza_image_colour (giza_image_t *img);
+static void _giza_image_draw (giza_image_t *img, int extend, int filter,
+                              const cairo_matrix_t *mat);
+static void _giza_image_map_band (void *arg, int start, int end, int band);
+static void _giza_image_colour_band (void *arg, int start, int end, int band);
+
+/**
+ * Drawing: giza_image_create
+ *
+ * Synopsis: Creates a persistent image, to be drawn with giza_image_draw.
+ *
+ * The section of data is copied, so the array need not be kept. Drawing the
+ * image again only maps the data to colour indices again if the data,
+ * the image transfer function or the colour index range have changed,
+ * and only recolours the pixels if the colour table has changed,
+ * which makes redraws and palette changes cheap.
+ *
+ * Input:
+ *  -sizex       :- The dimensions of data in the x-direction
+ *  -sizey       :- The dimensions of data in the y-direction
+ *  -data        :- The data to be rendered
+ *  -i1          :- The first index in the x-direction
+ *  -i2          :- The last index in the x-direction
+ *  -j1          :- The first index in the y-direction
+ *  -j2          :- The last index in the y-direction
+ *  -valMin      :- The value mapped to the first colour index
+ *  -valMax      :- The value mapped to the last colour index
+ *  -transparent :- If 1, pixels mapped to the first colour index are transparent,
+ *                  as in giza_render_transparent
+ *
+ * Return value:
+ *  -A positive handle for the image, or 0 on failure
+ *
+ * See Also: giza_image_update, giza_image_draw, giza_image_destroy, giza_render
+ */
+int
+giza_image_create (int sizex, int sizey, const double *data, int i1, int i2,
+                   int j1, int j2, double valMin, double valMax, int transparent)
+{
+  return _giza_image_new ("giza_image_create", 0, sizex, sizey, data,
+                          i1, i2, j1, j2, valMin, valMax, transparent);
+}
+
+/**
+ * Drawing: giza_image_create_float
+ *
+ * Synopsis: Same functionality as giza_image_create but takes floats.
+ *
+ * See Also: giza_image_create
+ */
+int
+giza_image_create_float (int sizex, int sizey, const float *data, int i1, int i2,
+                         int j1, int j2, float valMin, float valMax, int transparent)
+{
+  return _giza_image_new ("giza_image_create_float", 1, sizex, sizey, data,
+                          i1, i2, j1, j2, valMin, valMax, transparent);
+}
+
+/**
+ * Drawing: giza_image_update
+ *
+ * Synopsis: Replaces the data of a persistent image.
+ *
+ * Input:
+ *  -image       :- The image handle, from giza_image_create
+ *  -sizex, ...  :- As for giza_image_create; the section may change size
+ *
+ * See Also: giza_image_create, giza_image_draw
+ */
+void
+giza_image_update (int image, int sizex, int sizey, const double *data, int i1, int i2,
+                   int j1, int j2, double valMin, double valMax)
+{
+  _giza_image_update ("giza_image_update", image, 0, sizex, sizey, data,
+                      i1, i2, j1, j2, valMin, valMax);
+}
+
+/**
+ * Drawing: giza_image_update_float
+ *
+ * Synopsis: Same functionality as giza_image_update but takes floats.
+ *
+ * See Also: giza_image_update
+ */
+void
+giza_image_update_float (int image, int sizex, int sizey, const float *data, int i1, int i2,
+                         int j1, int j2, float valMin, float valMax)
+{
+  _giza_image_update ("giza_image_update_float", image, 1, sizex, sizey, data,
+                      i1, i2, j1, j2, valMin, valMax);
+}
+
+/**
+ * Drawing: giza_image_draw
+ *
+ * Synopsis: Draws a persistent image to the device.
+ *
+ * The image is drawn as by giza_render with the current image transfer
+ * function, colour index range and colour table, except that it is never
+ * resampled to the device resolution (see giza_set_image_resample).
+ *
+ * Input:
+ *  -image  :- The image handle, from giza_image_create
+ *  -extend :- Extend mode, as for giza_render
+ *  -filter :- Interpolation filter, as for giza_render
+ *  -affine :- The affine transformation matrix that will be applied to the data.
+ *
+ * See Also: giza_image_create, giza_render
+ */
+void
+giza_image_draw (int image, int extend, int filter, const double *affine)
+{
+  giza_image_t *img;
+  cairo_matrix_t mat;
+
+  if (!_giza_check_device_ready ("giza_image_draw"))
+    return;
+  img = _giza_image_get ("giza_image_draw", image);
+  if (!img)
+    return;
+
+  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
+                     affine[4], affine[5]);
+  _giza_image_draw (img, extend, filter, &mat);
+}
+
+/**
+ * Drawing: giza_image_draw_float
+ *
+ * Synopsis: Same functionality as giza_image_draw but takes a float affine matrix.
+ *
+ * See Also: giza_image_draw
+ */
+void
+giza_image_draw_float (int image, int extend, int filter, const float *affine)
+{
+  giza_image_t *img;
+  cairo_matrix_t mat;
+
+  if (!_giza_check_device_ready ("giza_image_draw_float"))
+    return;
+  img = _giza_image_get ("giza_image_draw_float", image);
+  if (!img)
+    return;
+
+  cairo_matrix_init (&mat, (double) affine[0], (double) affine[1], (double) affine[2],
+                     (double) affine[3], (double) affine[4], (double) affine[5]);
+  _giza_image_draw (img, extend, filter, &mat);
+}
+
+/**
+ * Drawing: giza_image_destroy
+ *
+ * Synopsis: Frees a persistent image. The handle may be reused.
+ *
+ * Input:
+ *  -image :- The image handle, from giza_image_create
+ *
+ * See Also: giza_image_create
+ */
+void
+giza_image_destroy (int image)
+{
+  giza_image_t *img = _giza_image_get ("giza_image_destroy", image);
+
+  if (!img)
+    return;
+  _giza_image_free (img);
+  _giza_images[image - 1] = NULL;
+}
+
+static int
+_giza_image_new (const char *caller, int isfloat, int sizex, int sizey,
+                 const void *data, int i1, int i2, int j1, int j2,
+                 double valMin, double valMax, int transparent)
+{
+  giza_image_t *img, **tmp;
+  int image;
+
+  img = calloc (1, sizeof (giza_image_t));
+  if (!img)
+    {
+      _giza_warning (caller, "Allocation failed, image not created.");
+      return 0;
+    }
+  if (!_giza_image_set (caller, img, isfloat, sizex, sizey, data, i1, i2, j1, j2))
+    {
+      free (img);
+      return 0;
+    }
+  img->valMin = valMin;
+  img->valMax = valMax;
+  img->transparent = (transparent==1);
+
+  /* reuse the handle of a destroyed image if there is one */
+  for (image = 0; image < _giza_nimages; image++)
+    if (!_giza_images[image])
+      break;
+  if (image == _giza_nimages)
+    {
+      tmp = realloc (_giza_images, (size_t) (_giza_nimages + 1) * sizeof (giza_image_t *));
+      if (!tmp)
+        {
+          _giza_warning (caller, "Allocation failed, image not created.");
+          _giza_image_free (img);
+          return 0;
+        }
+      _giza_images = tmp;
+      _giza_nimages++;
+    }
+  _giza_images[image] = img;
+  return image + 1;
+}
+
+static void
+_giza_image_update (const char *caller, int image, int isfloat,
+                    int sizex, int sizey, const void *data,
+                    int i1, int i2, int j1, int j2,
+                    double valMin, double valMax)
+{
+  giza_image_t *img = _giza_image_get (caller, image);
+
+  if (!img)
+    return;
+  if (!_giza_image_set (caller, img, isfloat, sizex, sizey, data, i1, i2, j1, j2))
+    return;
+  img->valMin = valMin;
+  img->valMax = valMax;
+  img->mapped = 0;
+}
+
+/**
+ * Copies the section i1..i2, j1..j2 of data into the image, reallocating
+ * the buffers if its size has changed. Returns 0, leaving the image as it
+ * was, if the section is invalid or memory could not be allocated.
+ */
+static int
+_giza_image_set (const char *caller, giza_image_t *img, int isfloat,
+                 int sizex, int sizey, const void *data,
+                 int i1, int i2, int j1, int j2)
+{
+  size_t elsize = isfloat ? sizeof (float) : sizeof (double);
+  int j, width, height;
+  void *copy;
+
+  if (sizex < 1 || sizey < 1)
+    {
+      _giza_warning (caller, "Invalid array size, image not set.");
+      return 0;
+    }
+  if (i1 < 0 || i2 < i1 || j1 < 0 || j2 < j1)
+    {
+      _giza_warning (caller, "Invalid index range, image not set.");
+      return 0;
+    }
+  /* Clamp indices to array bounds to avoid OOB reads */
+  if (i2 >= sizex) i2 = sizex - 1;
+  if (j2 >= sizey) j2 = sizey - 1;
+  if (i1 >= sizex || j1 >= sizey)
+    {
+      _giza_warning (caller, "Index range outside array bounds, image not set.");
+      return 0;
+    }
+  width = i2 - i1 + 1;
+  height = j2 - j1 + 1;
+
+  if (width != img->width || height != img->height || isfloat != img->isfloat)
+    {
+      int *idx;
+      unsigned char *pixdata;
+      int stride;
+
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 6, 0)
+      stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width);
+#else
+      stride = 4*width;
+#endif
+      copy = malloc ((size_t) width * (size_t) height * elsize);
+      idx = malloc ((size_t) width * (size_t) height * sizeof (int));
+      pixdata = malloc ((size_t) stride * (size_t) height);
+      if (!copy || !idx || !pixdata)
+        {
+          _giza_warning (caller, "Allocation failed, image not set.");
+          free (copy);
+          free (idx);
+          free (pixdata);
+          return 0;
+        }
+
+      if (img->surface)
+        cairo_surface_destroy (img->surface);
+      free (img->data);
+      free (img->idx);
+      free (img->pixdata);
+      img->surface = cairo_image_surface_create_for_data (pixdata, CAIRO_FORMAT_ARGB32,
+                                                          width, height, stride);
+      img->data = copy;
+      img->idx = idx;
+      img->pixdata = pixdata;
+      img->stride = stride;
+      img->width = width;
+      img->height = height;
+      img->isfloat = isfloat;
+      img->mapped = 0;
+      img->coloured = 0;
+    }
+
+  for (j = 0; j < height; j++)
+    memcpy ((char *) img->data + (size_t) j * width * elsize,
+            (const char *) data + ((size_t) (j1 + j) * sizex + i1) * elsize,
+            (size_t) width * elsize);
+  return 1;
+}
+
+/* the image for a handle, or NULL with a warning */
+static giza_image_t *
+_giza_image_get (const char *caller, int image)
+{
+  if (image < 1 || image > _giza_nimages || !_giza_images[image - 1])
+    {
+      _giza_warning (caller, "Invalid image handle");
+      return NULL;
+    }
+  return _giza_images[image - 1];
+}
+
+static void
+_giza_image_free (giza_image_t *img)
+{
+  if (img->surface)
+    cairo_surface_destroy (img->surface);
+  free (img->data);
+  free (img->idx);
+  free (img->pixdata);
+  free (img);
+}
+
+/**
+ * Brings the colour indices and the pixmap of the image up to date with the
+ * current image transfer function, colour mode, colour index range and
+ * colour table, doing only the work needed. Large images are done in
+ * parallel bands.
+ */
+static void
+_giza_image_colour (giza_image_t *img)
+{
+  uint32_t lut[GIZA_CTAB_LUT_SIZE];
+  double itflut[GIZA_ITF_LUT_SIZE];
+  giza_render_band_t b;
+  int cimin, cimax, nbands;
+
+  _giza_render_colours (&cimin, &cimax, lut);
+  nbands = _giza_thread_bands (img->height,
+                               (GIZA_RENDER_BAND_PIXELS + img->width - 1)/img->width);
+
+  if (!img->mapped || img->itf != Dev[id].itf || img->cimin != cimin || img->cimax != cimax)
+    {
+      img->itf = Dev[id].itf;
+      img->cimin = cimin;
+      img->cimax = cimax;
+
+      /* histogram equalisation is over the whole image */
+      b.data = img->data;
+      b.type = img->isfloat ? GIZA_DATA_FLOAT : GIZA_DATA_DOUBLE;
+      b.sizex = img->width;
+      b.i1 = 0;
+      b.j1 = 0;
+      b.width = img->width;
+      b.itf = img->itf;
+      b.valMin = img->valMin;
+      b.valMax = img->valMax;
+      b.blank = NULL;
+      img->itflut = _giza_render_itf_table (&b, img->height, itflut);
+      _giza_parallel_for (nbands, img->height, _giza_image_map_band, img);
+      img->itflut = NULL;
+      img->mapped = 1;
+      img->coloured = 0;
+    }
+
+  if (img->coloured && memcmp (lut + cimin, img->lut + cimin,
+                               (size_t) (cimax - cimin + 1) * sizeof (uint32_t)) == 0)
+    return;
+
+  memcpy (img->lut + cimin, lut + cimin, (size_t) (cimax - cimin + 1) * sizeof (uint32_t));
+  cairo_surface_flush (img->surface);
+  _giza_parallel_for (nbands, img->height, _giza_image_colour_band, img);
+  cairo_surface_mark_dirty (img->surface);
+  img->coloured = 1;
+}
+
+/* maps rows start..end-1 of the data to colour indices */
+static void
+_giza_image_map_band (void *arg, int start, int end, int band)
+{
+  giza_image_t *img = (giza_image_t *) arg;
+  size_t offset;
+  int j;
+
+  for (j = start; j < end; j++)
+    {
+      offset = (size_t) j * img->width;
+      if (img->isfloat)
+        _giza_itf_idx_row_f (img->itf, img->itflut, (const float *) img->data + offset, img->width,
+                             (float) img->valMin, (float) img->valMax,
+                             img->cimin, img->cimax, img->idx + offset);
+      else
+        _giza_itf_idx_row (img->itf, img->itflut, (const double *) img->data + offset, img->width,
+                           img->valMin, img->valMax, img->cimin, img->cimax, img->idx + offset);
+    }
+}
+
+/* colours rows start..end-1 of the pixmap from the colour indices */
+static void
+_giza_image_colour_band (void *arg, int start, int end, int band)
+{
+  giza_image_t *img = (giza_image_t *) arg;
+  const uint32_t *lut = img->lut;
+  const int *idx;
+  uint32_t *row;
+  int i, j;
+
+  for (j = start; j < end; j++)
+    {
+      idx = img->idx + (size_t) j * img->width;
+      row = (uint32_t *) (img->pixdata + (size_t) j * img->stride);
+      if (img->transparent) {
+        for (i = 0; i < img->width; i++)
+          row[i] = (idx[i]==img->cimin) ? (lut[idx[i]] & 0x00ffffff) : lut[idx[i]];
+      } else {
+        for (i = 0; i < img->width; i++)
+          row[i] = lut[idx[i]];
+      }
+    }
+}
+
+static void
+_giza_image_draw (giza_image_t *img, int extend, int filter, const cairo_matrix_t *mat)
+{
+  cairo_extend_t cairoextendtype;
+  cairo_filter_t cairofiltertype;
+  int oldTrans;
+
+  _giza_image_colour (img);
+
+  _giza_get_extend (extend, &cairoextendtype);
+  _giza_get_filter (filter, &cairofiltertype);
+
+  oldTrans = _giza_get_trans ();
+  _giza_set_trans (GIZA_TRANS_WORLD);
+
+  cairo_save (Dev[id].context);
+  _giza_clip_to_window ();
+  cairo_transform (Dev[id].context, mat);
+
+  /* paint the pixmap to the primary surface */
+  cairo_set_source_surface (Dev[id].context, img->surface, 0, 0);
+  cairo_pattern_set_extend (cairo_get_source (Dev[id].context), cairoextendtype);
+  cairo_pattern_set_filter (cairo_get_source (Dev[id].context), cairofiltertype);
+  cairo_paint (Dev[id].context);
+
+  cairo_restore (Dev[id].context);
+  _giza_set_trans (oldTrans);
+
+  giza_flush_device ();
+}
@@ -27,39 +27,73 @@
 #include "giza-private.h"
 #include <giza.h>
 #include <math.h>
+#include <stddef.h>
 
 
 double _giza_itf_linear(const double pixelvalue, const double vmin, const double vmax);
 double _giza_itf_log(const double pixelvalue, const double vmin, const double vmax);
 double _giza_itf_sqrt(const double pixelvalue, const double vmin, const double vmax);
+double _giza_itf_asinh(const double pixelvalue, const double vmin, const double vmax);
 
 float  _giza_itf_linear_f(const float pixelvalue, const float vmin, const float vmax);
 float  _giza_itf_log_f(const float pixelvalue, const float vmin, const float vmax);
 float  _giza_itf_sqrt_f(const float pixelvalue, const float vmin, const float vmax);
+float  _giza_itf_asinh_f(const float pixelvalue, const float vmin, const float vmax);
 
 int    _giza_itf_idx_linear(const double pixelvalue, const double vmin, const double vmax, const int cimin, const int cimax);
 int    _giza_itf_idx_log(const double pixelvalue, const double vmin, const double vmax, const int cimin, const int cimax);
 int    _giza_itf_idx_sqrt(const double pixelvalue, const double vmin, const double vmax, const int cimin, const int cimax);
+int    _giza_itf_idx_asinh(const double pixelvalue, const double vmin, const double vmax, const int cimin, const int cimax);
 
 int     _giza_itf_idx_linear_f(const float pixelvalue, const float vmin, const float vmax, const int cimin, const int cimax);
 int     _giza_itf_idx_log_f(const float pixelvalue, const float vmin, const float vmax, const int cimin, const int cimax);
 int     _giza_itf_idx_sqrt_f(const float pixelvalue, const float vmin, const float vmax, const int cimin, const int cimax);
+int     _giza_itf_idx_asinh_f(const float pixelvalue, const float vmin, const float vmax, const int cimin, const int cimax);
 
-/* We keep an array of three image transfer functions, use set_image_transfer_function to set
+/* We keep an array of the image transfer functions of single values, use set_image_transfer_function to set
        0: linear
        1: log
-       2: sqrt 
+       2: sqrt
+       3: asinh
 */
-giza_itf_type       giza_itf[3]       = {_giza_itf_linear,       _giza_itf_log,       _giza_itf_sqrt};
-giza_itf_type_f     giza_itf_f[3]     = {_giza_itf_linear_f,     _giza_itf_log_f,     _giza_itf_sqrt_f};
-giza_itf_idx_type   giza_itf_idx[3]   = {_giza_itf_idx_linear,   _giza_itf_idx_log,   _giza_itf_idx_sqrt};
-giza_itf_idx_type_f giza_itf_idx_f[3] = {_giza_itf_idx_linear_f, _giza_itf_idx_log_f, _giza_itf_idx_sqrt_f};
+giza_itf_type       giza_itf[4]       = {_giza_itf_linear,       _giza_itf_log,       _giza_itf_sqrt,       _giza_itf_asinh};
+giza_itf_type_f     giza_itf_f[4]     = {_giza_itf_linear_f,     _giza_itf_log_f,     _giza_itf_sqrt_f,     _giza_itf_asinh_f};
+giza_itf_idx_type   giza_itf_idx[4]   = {_giza_itf_idx_linear,   _giza_itf_idx_log,   _giza_itf_idx_sqrt,   _giza_itf_idx_asinh};
+giza_itf_idx_type_f giza_itf_idx_f[4] = {_giza_itf_idx_linear_f, _giza_itf_idx_log_f, _giza_itf_idx_sqrt_f, _giza_itf_idx_asinh_f};
 
+/* and the functions registered by the user, numbered from GIZA_ITF_HISTEQ + 1 */
+typedef struct
+{
+  double (*func) (double fraction, void *user);
+  void *user;
+} giza_itf_registered_t;
 
+static giza_itf_registered_t _giza_itf_registered[GIZA_ITF_MAX_REGISTERED];
+static int _giza_itf_nregistered = 0;
+
+/**
+ * Settings: giza_set_image_transfer_function
+ *
+ * Synopsis: Sets how data values are mapped to positions on the colour ramp
+ *
+ * Input:
+ *  -itf :- The image transfer function
+ *
+ * Allowed values:
+ *  -0 or GIZA_ITF_LINEAR :- linear
+ *  -1 or GIZA_ITF_LOG    :- logarithmic
+ *  -2 or GIZA_ITF_SQRT   :- square root
+ *  -3 or GIZA_ITF_ASINH  :- inverse hyperbolic sine, linear near valMin and logarithmic above
+ *  -4 or GIZA_ITF_HISTEQ :- histogram equalisation, giving each colour an equal share of the
+ *                           pixels in the image being drawn
+ *  -any number returned by giza_register_image_transfer_function
+ *
+ * See Also: giza_get_image_transfer_function, giza_register_image_transfer_function
+ */
 void giza_set_image_transfer_function(int itf) {
   if (!_giza_check_device_ready ("giza_set_image_transfer_function"))
     return;
-  if (itf < 0 || itf > 2)
+  if (!_giza_itf_valid (itf))
     {
       _giza_warning ("giza_set_image_transfer_function",
                   "Invalid image transfer function, not set");
@@ -74,6 +108,153 @@ void giza_get_image_transfer_function(int* itfp) {
   *itfp = Dev[id].itf;
 }
 
+/**
+ * Settings: giza_register_image_transfer_function
+ *
+ * Synopsis: Adds an image transfer function given by a user function
+ *
+ * Input:
+ *  -func :- Maps the position of a value between valMin and valMax, as a
+ *           fraction from 0 to 1, to a position on the colour ramp, also from
+ *           0 to 1. Its second argument is user.
+ *  -user :- Passed to func, e.g. parameters of the stretch
+ *
+ * Return:
+ *  The number to give giza_set_image_transfer_function to use the function,
+ *  or -1 if it could not be registered.
+ *
+ * The function is sampled at 4096 points each time an image is drawn, not
+ * called for every pixel.
+ *
+ * See Also: giza_set_image_transfer_function
+ */
+int
+giza_register_image_transfer_function (double (*func) (double fraction, void *user), void *user)
+{
+  if (!func)
+    {
+      _giza_warning ("giza_register_image_transfer_function", "No function given");
+      return -1;
+    }
+  if (_giza_itf_nregistered >= GIZA_ITF_MAX_REGISTERED)
+    {
+      _giza_warning ("giza_register_image_transfer_function",
+                     "Too many image transfer functions registered");
+      return -1;
+    }
+  _giza_itf_registered[_giza_itf_nregistered].func = func;
+  _giza_itf_registered[_giza_itf_nregistered].user = user;
+  _giza_itf_nregistered++;
+  return GIZA_ITF_HISTEQ + _giza_itf_nregistered;
+}
+
+/**
+ * Whether itf is a built-in or registered image transfer function
+ */
+int
+_giza_itf_valid (int itf)
+{
+  return itf >= 0 && itf <= GIZA_ITF_HISTEQ + _giza_itf_nregistered;
+}
+
+/**
+ * Whether itf is applied through a table made by _giza_itf_lut
+ */
+int
+_giza_itf_uses_lut (int itf)
+{
+  return itf >= GIZA_ITF_HISTEQ && _giza_itf_valid (itf);
+}
+
+/* which of GIZA_ITF_LUT_SIZE bins across lo..hi a value is in, clamped as by the
+   MIN/MAX macros, which put NaN in the first */
+static int
+_giza_itf_lut_bin (double v, double lo, double hi)
+{
+  const double x = (MIN(hi, MAX(lo, v)) - lo)/(hi - lo) * GIZA_ITF_LUT_SIZE;
+  return (x < GIZA_ITF_LUT_SIZE) ? (int) x : GIZA_ITF_LUT_SIZE - 1;
+}
+
+/**
+ * Fills lut with the position on the colour ramp, from 0 to 1, of values in
+ * each of GIZA_ITF_LUT_SIZE equal bins between valMin and valMax. For
+ * histogram equalisation this is the fraction of the values below the
+ * middle of the bin, so hist must hold the number of values in each bin as
+ * counted by _giza_itf_hist_row. Returns 0 if itf does not use a table, or
+ * if it needs hist and none is given.
+ */
+int
+_giza_itf_lut (int itf, const size_t *hist, double *lut)
+{
+  giza_itf_registered_t *r;
+  double total, below, f;
+  int k, first, last;
+
+  if (!_giza_itf_uses_lut (itf))
+    return 0;
+
+  if (itf == GIZA_ITF_HISTEQ)
+    {
+      if (!hist)
+        return 0;
+      total = 0.;
+      first = -1;
+      last = -1;
+      for (k = 0; k < GIZA_ITF_LUT_SIZE; k++)
+        {
+          total += (double) hist[k];
+          if (hist[k] > 0)
+            {
+              if (first < 0) first = k;
+              last = k;
+            }
+        }
+      /* stretched so that the lowest and highest values reach the ends of the ramp */
+      if (first == last)
+        {
+          for (k = 0; k < GIZA_ITF_LUT_SIZE; k++)
+            lut[k] = (double) k/(GIZA_ITF_LUT_SIZE - 1);
+          return 1;
+        }
+      total -= 0.5*(double) (hist[first] + hist[last]);
+      below = -0.5*(double) hist[first];
+      for (k = 0; k < GIZA_ITF_LUT_SIZE; k++)
+        {
+          f = (below + 0.5*(double) hist[k])/total;
+          lut[k] = MIN(1., MAX(0., f));
+          below += (double) hist[k];
+        }
+      return 1;
+    }
+
+  r = &_giza_itf_registered[itf - GIZA_ITF_HISTEQ - 1];
+  for (k = 0; k < GIZA_ITF_LUT_SIZE; k++)
+    {
+      f = r->func ((k + 0.5)/GIZA_ITF_LUT_SIZE, r->user);
+      lut[k] = (f >= 0.) ? MIN(1., f) : 0.;
+    }
+  return 1;
+}
+
+/**
+ * Counts n values into hist, by the bins between vmin and vmax that
+ * _giza_itf_lut and the row functions use, leaving out NaNs and the values
+ * flagged in skip if it is not NULL
+ */
+void
+_giza_itf_hist_row (const double *val, int n, double vmin, double vmax,
+                    const unsigned char *skip, size_t *hist)
+{
+  const double lo = (vmax > vmin) ? vmin : vmax;
+  const double hi = (vmax > vmin) ? vmax : vmin;
+  int k;
+
+  if (!(vmax > vmin || vmin > vmax) || isinf (vmin) || isinf (vmax))
+    return;
+  for (k = 0; k < n; k++)
+    if (!isnan (val[k]) && !(skip && skip[k]))
+      hist[_giza_itf_lut_bin (val[k], lo, hi)]++;
+}
 
 /*
  * Lifted from PGPLOT grimg2.f on how to handle the image transfer function:
@@ -166,3 +347,522 @@ int  _giza_itf_idx_sqrt_f(const float pixelvalue, const float vmin, const float
     const float fractional_pos = _giza_itf_sqrt_f(pixelvalue, vmin, vmax);
     return MIN(cimin, cimax) + (int)roundf(((cimax > cimin) ? (cimax-cimin) : (cimin-cimax)) * fractional_pos);
 }
+
+/* and asinh, which is linear for values near vmin and logarithmic above */
+const double asinhfac   = 10.0;
+const float  asinhfac_f = 10.0f;
+
+/* returns position of pixelvalue as fraction of the distance between vmin, vmax */
+double _giza_itf_asinh(const double pixelvalue, const double vmin, const double vmax) {
+    return asinh(asinhfac*_giza_itf_linear(pixelvalue, vmin, vmax))/asinh(asinhfac);
+}
+
+/* maps pixelvalue's fractional position between vmin, vmax to corresponding index between cimin, cimax */
+int  _giza_itf_idx_asinh(const double pixelvalue, const double vmin, const double vmax, const int cimin, const int cimax) {
+    const double fractional_pos = _giza_itf_asinh(pixelvalue, vmin, vmax);
+    return MIN(cimin, cimax) + (int)round(((cimax > cimin) ? (cimax-cimin) : (cimin-cimax)) * fractional_pos);
+}
+
+/* id. for floats */
+float _giza_itf_asinh_f(const float pixelvalue, const float vmin, const float vmax) {
+    return asinhf(asinhfac_f*_giza_itf_linear_f(pixelvalue, vmin, vmax))/asinhf(asinhfac_f);
+}
+
+int  _giza_itf_idx_asinh_f(const float pixelvalue, const float vmin, const float vmax, const int cimin, const int cimax) {
+    const float fractional_pos = _giza_itf_asinh_f(pixelvalue, vmin, vmax);
+    return MIN(cimin, cimax) + (int)roundf(((cimax > cimin) ? (cimax-cimin) : (cimin-cimax)) * fractional_pos);
+}
+
+/*
+ * Row versions of the transfer functions, used by the image rendering code.
+ *
+ * These map n values to colour indices in one call, hoisting the range
+ * set-up out of the loop. They return exactly the same indices as the
+ * scalar _giza_itf_idx_* routines above: the clamp uses min/max with the
+ * same NaN handling as the MIN/MAX macros, division and sqrt are correctly
+ * rounded in both paths, the log is evaluated per element with libm, and
+ * round() is computed as trunc(x) + (x - trunc(x) >= 0.5), which is exact
+ * for the non-negative values involved. Where the scalar routines would
+ * produce NaN (vmin == vmax, or an infinite bound) every value is mapped
+ * to the lowest colour index instead.
+ *
+ * SSE2 and AVX2 versions are selected at runtime when available.
+ */
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define GIZA_HAVE_SSE2 1
+#include <emmintrin.h>
+#if defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#define GIZA_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+#endif
+
+static int _giza_itf_simd = -1;
+
+static int
+_giza_itf_simd_supported (void)
+{
+#ifdef GIZA_HAVE_AVX2
+  __builtin_cpu_init ();
+  if (__builtin_cpu_supports ("avx2"))
+    return GIZA_ITF_SIMD_AVX2;
+#endif
+#ifdef GIZA_HAVE_SSE2
+  return GIZA_ITF_SIMD_SSE2;
+#else
+  return GIZA_ITF_SIMD_NONE;
+#endif
+}
+
+/**
+ * Selects the instruction set used by the row kernels. A negative value,
+ * or one that is not supported by the processor, selects the best
+ * available. Returns the level actually in use.
+ */
+int
+_giza_itf_set_simd_level (int level)
+{
+  int maxlevel = _giza_itf_simd_supported ();
+
+  if (level < 0 || level > maxlevel)
+    level = maxlevel;
+  _giza_itf_simd = level;
+  return level;
+}
+
+#ifdef GIZA_HAVE_SSE2
+static int
+_giza_itf_idx_row_sse2 (int itf, const double *val, int n, double lo, double hi,
+                        double range, int base, double sfacl, double asinhl, int *idx)
+{
+  const __m128d vlo = _mm_set1_pd (lo), vhi = _mm_set1_pd (hi);
+  const __m128d vden = _mm_set1_pd (hi - lo), vrange = _mm_set1_pd (range);
+  const __m128d half = _mm_set1_pd (0.5), one = _mm_set1_pd (1.0);
+  const __m128i vbase = _mm_set1_epi32 (base);
+  __m128d f, t;
+  double tmp[2];
+  int k;
+
+  for (k = 0; k + 2 <= n; k += 2)
+    {
+      f = _mm_min_pd (vhi, _mm_max_pd (_mm_loadu_pd (val + k), vlo));
+      f = _mm_div_pd (_mm_sub_pd (f, vlo), vden);
+      if (itf == 1)
+        {
+          _mm_storeu_pd (tmp, f);
+          tmp[0] = log (1.0+sfac*tmp[0])/sfacl;
+          tmp[1] = log (1.0+sfac*tmp[1])/sfacl;
+          f = _mm_loadu_pd (tmp);
+        }
+      else if (itf == 2)
+        f = _mm_sqrt_pd (f);
+      else if (itf == 3)
+        {
+          _mm_storeu_pd (tmp, f);
+          tmp[0] = asinh (asinhfac*tmp[0])/asinhl;
+          tmp[1] = asinh (asinhfac*tmp[1])/asinhl;
+          f = _mm_loadu_pd (tmp);
+        }
+      f = _mm_mul_pd (f, vrange);
+      t = _mm_cvtepi32_pd (_mm_cvttpd_epi32 (f));
+      t = _mm_add_pd (t, _mm_and_pd (_mm_cmpge_pd (_mm_sub_pd (f, t), half), one));
+      _mm_storel_epi64 ((__m128i *) (idx + k), _mm_add_epi32 (_mm_cvttpd_epi32 (t), vbase));
+    }
+  return k;
+}
+
+static int
+_giza_itf_idx_row_sse2_f (int itf, const float *val, int n, float lo, float hi,
+                          float range, int base, float sfacl_f, float asinhl_f, int *idx)
+{
+  const __m128 vlo = _mm_set1_ps (lo), vhi = _mm_set1_ps (hi);
+  const __m128 vden = _mm_set1_ps (hi - lo), vrange = _mm_set1_ps (range);
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128i vbase = _mm_set1_epi32 (base);
+  __m128 f, m;
+  __m128i ti;
+  float tmp[4];
+  int k, l;
+
+  for (k = 0; k + 4 <= n; k += 4)
+    {
+      f = _mm_min_ps (vhi, _mm_max_ps (_mm_loadu_ps (val + k), vlo));
+      f = _mm_div_ps (_mm_sub_ps (f, vlo), vden);
+      if (itf == 1)
+        {
+          _mm_storeu_ps (tmp, f);
+          for (l = 0; l < 4; l++)
+            tmp[l] = log (1.0f+sfac_f*tmp[l])/sfacl_f;
+          f = _mm_loadu_ps (tmp);
+        }
+      else if (itf == 2)
+        f = _mm_sqrt_ps (f);
+      else if (itf == 3)
+        {
+          _mm_storeu_ps (tmp, f);
+          for (l = 0; l < 4; l++)
+            tmp[l] = asinhf (asinhfac_f*tmp[l])/asinhl_f;
+          f = _mm_loadu_ps (tmp);
+        }
+      f = _mm_mul_ps (f, vrange);
+      ti = _mm_cvttps_epi32 (f);
+      m = _mm_cmpge_ps (_mm_sub_ps (f, _mm_cvtepi32_ps (ti)), half);
+      ti = _mm_sub_epi32 (ti, _mm_castps_si128 (m));
+      _mm_storeu_si128 ((__m128i *) (idx + k), _mm_add_epi32 (ti, vbase));
+    }
+  return k;
+}
+#endif
+
+#ifdef GIZA_HAVE_AVX2
+__attribute__ ((target ("avx2"))) static int
+_giza_itf_idx_row_avx2 (int itf, const double *val, int n, double lo, double hi,
+                        double range, int base, double sfacl, double asinhl, int *idx)
+{
+  const __m256d vlo = _mm256_set1_pd (lo), vhi = _mm256_set1_pd (hi);
+  const __m256d vden = _mm256_set1_pd (hi - lo), vrange = _mm256_set1_pd (range);
+  const __m256d half = _mm256_set1_pd (0.5), one = _mm256_set1_pd (1.0);
+  const __m128i vbase = _mm_set1_epi32 (base);
+  __m256d f, t;
+  double tmp[4];
+  int k, l;
+
+  for (k = 0; k + 4 <= n; k += 4)
+    {
+      f = _mm256_min_pd (vhi, _mm256_max_pd (_mm256_loadu_pd (val + k), vlo));
+      f = _mm256_div_pd (_mm256_sub_pd (f, vlo), vden);
+      if (itf == 1)
+        {
+          _mm256_storeu_pd (tmp, f);
+          for (l = 0; l < 4; l++)
+            tmp[l] = log (1.0+sfac*tmp[l])/sfacl;
+          f = _mm256_loadu_pd (tmp);
+        }
+      else if (itf == 2)
+        f = _mm256_sqrt_pd (f);
+      else if (itf == 3)
+        {
+          _mm256_storeu_pd (tmp, f);
+          for (l = 0; l < 4; l++)
+            tmp[l] = asinh (asinhfac*tmp[l])/asinhl;
+          f = _mm256_loadu_pd (tmp);
+        }
+      f = _mm256_mul_pd (f, vrange);
+      t = _mm256_round_pd (f, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+      t = _mm256_add_pd (t, _mm256_and_pd (_mm256_cmp_pd (_mm256_sub_pd (f, t), half, _CMP_GE_OQ), one));
+      _mm_storeu_si128 ((__m128i *) (idx + k), _mm_add_epi32 (_mm256_cvttpd_epi32 (t), vbase));
+    }
+  return k;
+}
+
+__attribute__ ((target ("avx2"))) static int
+_giza_itf_idx_row_avx2_f (int itf, const float *val, int n, float lo, float hi,
+                          float range, int base, float sfacl_f, float asinhl_f, int *idx)
+{
+  const __m256 vlo = _mm256_set1_ps (lo), vhi = _mm256_set1_ps (hi);
+  const __m256 vden = _mm256_set1_ps (hi - lo), vrange = _mm256_set1_ps (range);
+  const __m256 half = _mm256_set1_ps (0.5f);
+  const __m256i vbase = _mm256_set1_epi32 (base);
+  __m256 f, m;
+  __m256i ti;
+  float tmp[8];
+  int k, l;
+
+  for (k = 0; k + 8 <= n; k += 8)
+    {
+      f = _mm256_min_ps (vhi, _mm256_max_ps (_mm256_loadu_ps (val + k), vlo));
+      f = _mm256_div_ps (_mm256_sub_ps (f, vlo), vden);
+      if (itf == 1)
+        {
+          _mm256_storeu_ps (tmp, f);
+          for (l = 0; l < 8; l++)
+            tmp[l] = log (1.0f+sfac_f*tmp[l])/sfacl_f;
+          f = _mm256_loadu_ps (tmp);
+        }
+      else if (itf == 2)
+        f = _mm256_sqrt_ps (f);
+      else if (itf == 3)
+        {
+          _mm256_storeu_ps (tmp, f);
+          for (l = 0; l < 8; l++)
+            tmp[l] = asinhf (asinhfac_f*tmp[l])/asinhl_f;
+          f = _mm256_loadu_ps (tmp);
+        }
+      f = _mm256_mul_ps (f, vrange);
+      ti = _mm256_cvttps_epi32 (f);
+      m = _mm256_cmp_ps (_mm256_sub_ps (f, _mm256_cvtepi32_ps (ti)), half, _CMP_GE_OQ);
+      ti = _mm256_sub_epi32 (ti, _mm256_castps_si256 (m));
+      _mm256_storeu_si256 ((__m256i *) (idx + k), _mm256_add_epi32 (ti, vbase));
+    }
+  return k;
+}
+#endif
+
+/**
+ * Maps n double values to colour indices between cimin and cimax using
+ * image transfer function itf (0: linear, 1: log, 2: sqrt, 3: asinh), or
+ * for those that use one, the table lut made by _giza_itf_lut. Without a
+ * table they are linear.
+ */
+void
+_giza_itf_idx_row (int itf, const double *lut, const double *val, int n,
+                   double vmin, double vmax, int cimin, int cimax, int *idx)
+{
+  const double lo = (vmax > vmin) ? vmin : vmax;
+  const double hi = (vmax > vmin) ? vmax : vmin;
+  const double range = (cimin < cimax) ? (cimax - cimin) : (cimin - cimax);
+  const double sfacl = log (1.0+sfac);
+  const double asinhl = asinh (asinhfac);
+  const int base = MIN(cimin, cimax);
+  double f;
+  int k = 0;
+
+  if (!(vmax > vmin || vmin > vmax) || isinf (vmin) || isinf (vmax))
+    {
+      for (k = 0; k < n; k++)
+        idx[k] = base;
+      return;
+    }
+
+  /* one lookup per value */
+  if (itf >= GIZA_ITF_HISTEQ)
+    {
+      if (lut)
+        {
+          for (k = 0; k < n; k++)
+            idx[k] = base + (int) round (range * lut[_giza_itf_lut_bin (val[k], lo, hi)]);
+          return;
+        }
+      itf = GIZA_ITF_LINEAR;
+    }
+
+  if (_giza_itf_simd < 0)
+    _giza_itf_set_simd_level (-1);
+
+#ifdef GIZA_HAVE_AVX2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_AVX2)
+    k = _giza_itf_idx_row_avx2 (itf, val, n, lo, hi, range, base, sfacl, asinhl, idx);
+  else
+#endif
+#ifdef GIZA_HAVE_SSE2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_SSE2)
+    k = _giza_itf_idx_row_sse2 (itf, val, n, lo, hi, range, base, sfacl, asinhl, idx);
+#endif
+
+  /* remainder, or everything if no vector unit is available */
+  for (; k < n; k++)
+    {
+      f = (MIN(hi, MAX(lo, val[k])) - lo)/(hi - lo);
+      if (itf == 1)
+        f = log (1.0+sfac*f)/sfacl;
+      else if (itf == 2)
+        f = sqrt (f);
+      else if (itf == 3)
+        f = asinh (asinhfac*f)/asinhl;
+      idx[k] = base + (int) round (range * f);
+    }
+}
+
+/**
+ * Same as _giza_itf_idx_row, but for float values. Tables are looked up
+ * with the values in double precision, as they were counted.
+ */
+void
+_giza_itf_idx_row_f (int itf, const double *lut, const float *val, int n,
+                     float vmin, float vmax, int cimin, int cimax, int *idx)
+{
+  const float lo = (vmax > vmin) ? vmin : vmax;
+  const float hi = (vmax > vmin) ? vmax : vmin;
+  const float range = (cimin < cimax) ? (cimax - cimin) : (cimin - cimax);
+  const float sfacl_f = logf (1.0f+sfac);
+  const float asinhl_f = asinhf (asinhfac_f);
+  const int base = MIN(cimin, cimax);
+  float f;
+  int k = 0;
+
+  if (!(vmax > vmin || vmin > vmax) || isinf (vmin) || isinf (vmax))
+    {
+      for (k = 0; k < n; k++)
+        idx[k] = base;
+      return;
+    }
+
+  if (itf >= GIZA_ITF_HISTEQ)
+    {
+      if (lut)
+        {
+          for (k = 0; k < n; k++)
+            idx[k] = base + (int) round ((double) range * lut[_giza_itf_lut_bin (val[k], lo, hi)]);
+          return;
+        }
+      itf = GIZA_ITF_LINEAR;
+    }
+
+  if (_giza_itf_simd < 0)
+    _giza_itf_set_simd_level (-1);
+
+#ifdef GIZA_HAVE_AVX2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_AVX2)
+    k = _giza_itf_idx_row_avx2_f (itf, val, n, lo, hi, range, base, sfacl_f, asinhl_f, idx);
+  else
+#endif
+#ifdef GIZA_HAVE_SSE2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_SSE2)
+    k = _giza_itf_idx_row_sse2_f (itf, val, n, lo, hi, range, base, sfacl_f, asinhl_f, idx);
+#endif
+
+  for (; k < n; k++)
+    {
+      f = (MIN(hi, MAX(lo, val[k])) - lo)/(hi - lo);
+      if (itf == 1)
+        f = log (1.0f+sfac_f*f)/sfacl_f;
+      else if (itf == 2)
+        f = sqrtf (f);
+      else if (itf == 3)
+        f = asinhf (asinhfac_f*f)/asinhl_f;
+      idx[k] = base + (int) roundf (range * f);
+    }
+}
+
+#ifdef GIZA_HAVE_SSE2
+static int
+_giza_itf_blank_row_sse2 (const double *val, int n, double blank, unsigned char *blanked,
+                          int *nblank)
+{
+  const __m128d vblank = _mm_set1_pd (blank);
+  __m128d v;
+  int k, bits;
+
+  for (k = 0; k + 2 <= n; k += 2)
+    {
+      v = _mm_loadu_pd (val + k);
+      bits = _mm_movemask_pd (_mm_or_pd (_mm_cmpunord_pd (v, v), _mm_cmpeq_pd (v, vblank)));
+      blanked[k] = bits & 1;
+      blanked[k+1] = (bits >> 1) & 1;
+      *nblank += __builtin_popcount (bits);
+    }
+  return k;
+}
+
+static int
+_giza_itf_blank_row_sse2_f (const float *val, int n, float blank, unsigned char *blanked,
+                            int *nblank)
+{
+  const __m128 vblank = _mm_set1_ps (blank);
+  __m128 v;
+  int k, l, bits;
+
+  for (k = 0; k + 4 <= n; k += 4)
+    {
+      v = _mm_loadu_ps (val + k);
+      bits = _mm_movemask_ps (_mm_or_ps (_mm_cmpunord_ps (v, v), _mm_cmpeq_ps (v, vblank)));
+      for (l = 0; l < 4; l++)
+        blanked[k+l] = (bits >> l) & 1;
+      *nblank += __builtin_popcount (bits);
+    }
+  return k;
+}
+#endif
+
+#ifdef GIZA_HAVE_AVX2
+__attribute__ ((target ("avx2"))) static int
+_giza_itf_blank_row_avx2 (const double *val, int n, double blank, unsigned char *blanked,
+                          int *nblank)
+{
+  const __m256d vblank = _mm256_set1_pd (blank);
+  __m256d v;
+  int k, l, bits;
+
+  for (k = 0; k + 4 <= n; k += 4)
+    {
+      v = _mm256_loadu_pd (val + k);
+      bits = _mm256_movemask_pd (_mm256_or_pd (_mm256_cmp_pd (v, v, _CMP_UNORD_Q),
+                                               _mm256_cmp_pd (v, vblank, _CMP_EQ_OQ)));
+      for (l = 0; l < 4; l++)
+        blanked[k+l] = (bits >> l) & 1;
+      *nblank += __builtin_popcount (bits);
+    }
+  return k;
+}
+
+__attribute__ ((target ("avx2"))) static int
+_giza_itf_blank_row_avx2_f (const float *val, int n, float blank, unsigned char *blanked,
+                            int *nblank)
+{
+  const __m256 vblank = _mm256_set1_ps (blank);
+  __m256 v;
+  int k, l, bits;
+
+  for (k = 0; k + 8 <= n; k += 8)
+    {
+      v = _mm256_loadu_ps (val + k);
+      bits = _mm256_movemask_ps (_mm256_or_ps (_mm256_cmp_ps (v, v, _CMP_UNORD_Q),
+                                               _mm256_cmp_ps (v, vblank, _CMP_EQ_OQ)));
+      for (l = 0; l < 8; l++)
+        blanked[k+l] = (bits >> l) & 1;
+      *nblank += __builtin_popcount (bits);
+    }
+  return k;
+}
+#endif
+
+/**
+ * Sets blanked[k] to 1 where val[k] is NaN or equal to blank (so never,
+ * other than for NaNs, if blank is itself NaN) and to 0 elsewhere.
+ * Returns the number of values blanked, so that rows without any can be
+ * passed over quickly.
+ */
+int
+_giza_itf_blank_row (const double *val, int n, double blank, unsigned char *blanked)
+{
+  int k = 0, nblank = 0;
+
+  if (_giza_itf_simd < 0)
+    _giza_itf_set_simd_level (-1);
+
+#ifdef GIZA_HAVE_AVX2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_AVX2)
+    k = _giza_itf_blank_row_avx2 (val, n, blank, blanked, &nblank);
+  else
+#endif
+#ifdef GIZA_HAVE_SSE2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_SSE2)
+    k = _giza_itf_blank_row_sse2 (val, n, blank, blanked, &nblank);
+#endif
+
+  for (; k < n; k++)
+    {
+      blanked[k] = (isnan (val[k]) || val[k] == blank);
+      nblank += blanked[k];
+    }
+  return nblank;
+}
+
+/**
+ * Same as _giza_itf_blank_row, but for float values
+ */
+int
+_giza_itf_blank_row_f (const float *val, int n, float blank, unsigned char *blanked)
+{
+  int k = 0, nblank = 0;
+
+  if (_giza_itf_simd < 0)
+    _giza_itf_set_simd_level (-1);
+
+#ifdef GIZA_HAVE_AVX2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_AVX2)
+    k = _giza_itf_blank_row_avx2_f (val, n, blank, blanked, &nblank);
+  else
+#endif
+#ifdef GIZA_HAVE_SSE2
+  if (_giza_itf_simd >= GIZA_ITF_SIMD_SSE2)
+    k = _giza_itf_blank_row_sse2_f (val, n, blank, blanked, &nblank);
+#endif
+
+  for (; k < n; k++)
+    {
+      blanked[k] = (isnan (val[k]) || val[k] == blank);
+      nblank += blanked[k];
+    }
+  return nblank;
+}
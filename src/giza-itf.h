@@ -25,6 +25,8 @@
 #ifndef GIZA_ITF_H
 #define GIZA_ITF_H
 
+#include <stddef.h>
+
 /* support image transfer functions */
 
 /*
@@ -50,14 +52,45 @@ typedef float  (*giza_itf_type_f)(const float pixelvalue, const float vmin, cons
 typedef int    (*giza_itf_idx_type)(const double pixelvalue, const double vmin, const double vmax, const int cimin, const int cimax);
 typedef int    (*giza_itf_idx_type_f)(const float pixelvalue, const float vmin, const float vmax, const int cimin, const int cimax);
 
-/* We keep an array of three image transfer functions, use set_image_transfer_function to set
+/* We keep an array of the image transfer functions that map single values,
+   use set_image_transfer_function to set
 	0: linear
 	1: log
-	2: sqrt 
+	2: sqrt
+	3: asinh
+   Histogram equalisation (4) depends on the data, and functions registered
+   with giza_register_image_transfer_function (5 onwards) on the user, so
+   both are applied through a table made with _giza_itf_lut instead.
 */
-extern giza_itf_type       giza_itf[3];
-extern giza_itf_type_f     giza_itf_f[3];
-extern giza_itf_idx_type   giza_itf_idx[3];
-extern giza_itf_idx_type_f giza_itf_idx_f[3];
+extern giza_itf_type       giza_itf[4];
+extern giza_itf_type_f     giza_itf_f[4];
+extern giza_itf_idx_type   giza_itf_idx[4];
+extern giza_itf_idx_type_f giza_itf_idx_f[4];
+
+/* registered functions, and the points at which tables sample them */
+#define GIZA_ITF_MAX_REGISTERED 32
+#define GIZA_ITF_LUT_SIZE 4096
+
+int  _giza_itf_valid (int itf);
+int  _giza_itf_uses_lut (int itf);
+int  _giza_itf_lut (int itf, const size_t *hist, double *lut);
+void _giza_itf_hist_row (const double *val, int n, double vmin, double vmax,
+                         const unsigned char *skip, size_t *hist);
+
+/* row versions used for rendering images, same results as giza_itf_idx;
+   lut is the table for transfer functions that need one, or NULL */
+#define GIZA_ITF_SIMD_NONE 0
+#define GIZA_ITF_SIMD_SSE2 1
+#define GIZA_ITF_SIMD_AVX2 2
+
+void _giza_itf_idx_row (int itf, const double *lut, const double *val, int n,
+                        double vmin, double vmax, int cimin, int cimax, int *idx);
+void _giza_itf_idx_row_f (int itf, const double *lut, const float *val, int n,
+                          float vmin, float vmax, int cimin, int cimax, int *idx);
+int  _giza_itf_set_simd_level (int level);
+
+/* flags values that are NaN or equal to blank, returning how many */
+int  _giza_itf_blank_row (const double *val, int n, double blank, unsigned char *blanked);
+int  _giza_itf_blank_row_f (const float *val, int n, float blank, unsigned char *blanked);
 
 #endif
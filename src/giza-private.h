@@ -133,6 +133,8 @@ typedef struct
   int number_format;
   giza_callback_t motion_callback;
   int itf; /* image transfer function */
+  int resample; /* image resampling mode */
+  int colourmode; /* how images are coloured from the colour table */
 } giza_device_t;
 
 extern giza_device_t Dev[GIZA_MAX_DEVICES];
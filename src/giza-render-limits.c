@@ -0,0 +1,413 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+#include "giza-io-private.h"
+#include "giza-private.h"
+#include "giza-render-private.h"
+#include "giza-threads-private.h"
+#include <giza.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* bins in the histogram used to find which values to select from */
+#define GIZA_LIMITS_NBINS 4096
+
+/* what the passes over the data do */
+#define GIZA_LIMITS_RANGE 0
+#define GIZA_LIMITS_HISTOGRAM 1
+#define GIZA_LIMITS_GATHER 2
+
+typedef struct
+{
+  int type;
+  const void *data;
+  const unsigned char *mask;
+  double blank;
+  int sizex, i1, j1, width;
+  int pass;
+  double *row;                /* scratch, width per band */
+  double *bmin, *bmax;        /* range of the values in each band */
+  size_t *count;              /* number of values in each band */
+  double lo, scale;           /* bin of value v is (v - lo)*scale */
+  size_t *hist;               /* GIZA_LIMITS_NBINS per band */
+  int bin[2];                 /* bins holding the two percentiles */
+  size_t *offset[2];          /* where each band gathers to in sel */
+  double *sel[2];             /* the values in bin[0] and bin[1] */
+} giza_limits_t;
+
+static int _giza_render_limits (const char *caller, int type, int sizex, int sizey,
+                                const void *data, const unsigned char *mask, double blank,
+                                int i1, int i2, int j1, int j2, double pmin, double pmax,
+                                double *valMin, double *valMax);
+static void _giza_limits_band (void *arg, int start, int end, int band);
+static double _giza_select (double *val, size_t n, size_t k);
+
+/**
+ * Settings: giza_get_render_limits
+ *
+ * Synopsis: Finds data limits for giza_render from percentiles of the data
+ *
+ * Works out the values below which the given percentages of the data lie,
+ * for use as valMin and valMax in giza_render, without sorting the data:
+ * a histogram of the data, made in parallel, picks out the few values
+ * from which the percentiles are then selected, so the cost grows in
+ * proportion to the number of values.
+ *
+ * Values that are NaN, infinite, equal to blank or cleared in the mask
+ * are left out, as in giza_render_blanked.
+ *
+ * Input:
+ *  -sizex  :- The dimensions of data in the x-direction
+ *  -sizey  :- The dimensions of data in the y-direction
+ *  -data   :- The data
+ *  -mask   :- Packed validity bits as for giza_render_blanked, or NULL
+ *  -blank  :- Data equal to this are left out. Pass NaN to leave out only NaNs.
+ *  -i1     :- The inclusive range of data to use in the x dimension.
+ *  -i2     :- The inclusive range of data to use in the x dimension.
+ *  -j1     :- The inclusive range of data to use in the y direction
+ *  -j2     :- The inclusive range of data to use in the y direction
+ *  -pmin   :- The percentage of the data below valMin, e.g. 0.5
+ *  -pmax   :- The percentage of the data below valMax, e.g. 99.5
+ *
+ * Output:
+ *  -valMin :- The data value at percentile pmin
+ *  -valMax :- The data value at percentile pmax
+ *
+ * The value at percentile p is the one that would be at position
+ * p/100*(n-1), rounded to the nearest integer, if the n values were sorted.
+ *
+ * Return:
+ *  -0 :- No error.
+ *  -1 :- An error occurred, or there are no values to use.
+ *
+ * See Also: giza_render, giza_render_blanked
+ */
+int
+giza_get_render_limits (int sizex, int sizey, const double *data, const unsigned char *mask,
+                        double blank, int i1, int i2, int j1, int j2, double pmin, double pmax,
+                        double *valMin, double *valMax)
+{
+  return _giza_render_limits ("giza_get_render_limits", GIZA_DATA_DOUBLE, sizex, sizey,
+                              data, mask, blank, i1, i2, j1, j2, pmin, pmax, valMin, valMax);
+}
+
+/**
+ * Settings: giza_get_render_limits_float
+ *
+ * Synopsis: Same functionality as giza_get_render_limits but takes floats
+ *
+ * See Also: giza_get_render_limits
+ */
+int
+giza_get_render_limits_float (int sizex, int sizey, const float *data, const unsigned char *mask,
+                              float blank, int i1, int i2, int j1, int j2, float pmin, float pmax,
+                              float *valMin, float *valMax)
+{
+  double dmin, dmax;
+  int err;
+
+  err = _giza_render_limits ("giza_get_render_limits_float", GIZA_DATA_FLOAT, sizex, sizey,
+                             data, mask, (double) blank, i1, i2, j1, j2, pmin, pmax,
+                             &dmin, &dmax);
+  if (!err)
+    {
+      *valMin = (float) dmin;
+      *valMax = (float) dmax;
+    }
+  return err;
+}
+
+/**
+ * Settings: giza_get_render_limits_typed
+ *
+ * Synopsis: Same functionality as giza_get_render_limits for data of any type
+ *
+ * Input:
+ *  -type :- The type of the data: GIZA_DATA_DOUBLE, GIZA_DATA_FLOAT, GIZA_DATA_U8,
+ *           GIZA_DATA_U16, GIZA_DATA_I16 or GIZA_DATA_I32
+ *
+ * See Also: giza_get_render_limits, giza_render_u8
+ */
+int
+giza_get_render_limits_typed (int sizex, int sizey, int type, const void *data,
+                              const unsigned char *mask, double blank, int i1, int i2,
+                              int j1, int j2, double pmin, double pmax,
+                              double *valMin, double *valMax)
+{
+  if (_giza_data_size (type) == 0)
+    {
+      _giza_warning ("giza_get_render_limits_typed", "Invalid data type");
+      return 1;
+    }
+  if (type == GIZA_DATA_FLOAT)
+    blank = (float) blank;
+  return _giza_render_limits ("giza_get_render_limits_typed", type, sizex, sizey,
+                              data, mask, blank, i1, i2, j1, j2, pmin, pmax, valMin, valMax);
+}
+
+static int
+_giza_render_limits (const char *caller, int type, int sizex, int sizey,
+                     const void *data, const unsigned char *mask, double blank,
+                     int i1, int i2, int j1, int j2, double pmin, double pmax,
+                     double *valMin, double *valMax)
+{
+  giza_limits_t l;
+  size_t n, rank[2], below, *total;
+  double lo, hi;
+  int b, t, bin, height, nbands, ok;
+
+  if (sizex < 1 || sizey < 1)
+    {
+      _giza_warning (caller, "Invalid array size");
+      return 1;
+    }
+  if (i1 < 0 || i2 < i1 || j1 < 0 || j2 < j1)
+    {
+      _giza_warning (caller, "Invalid index range");
+      return 1;
+    }
+  if (i2 >= sizex) i2 = sizex - 1;
+  if (j2 >= sizey) j2 = sizey - 1;
+  if (i1 >= sizex || j1 >= sizey)
+    {
+      _giza_warning (caller, "Index range outside array bounds");
+      return 1;
+    }
+  if (!(pmin >= 0. && pmin <= 100. && pmax >= 0. && pmax <= 100.))
+    {
+      _giza_warning (caller, "Percentiles must be between 0 and 100");
+      return 1;
+    }
+
+  l.type = type;
+  l.data = data;
+  l.mask = mask;
+  l.blank = blank;
+  l.sizex = sizex;
+  l.i1 = i1;
+  l.j1 = j1;
+  l.width = i2 - i1 + 1;
+  height = j2 - j1 + 1;
+  nbands = _giza_thread_bands (height, (GIZA_RENDER_BAND_PIXELS + l.width - 1)/l.width);
+
+  l.row = malloc ((size_t) nbands * (size_t) l.width * sizeof (double));
+  l.bmin = malloc ((size_t) nbands * sizeof (double));
+  l.bmax = malloc ((size_t) nbands * sizeof (double));
+  l.count = malloc ((size_t) nbands * sizeof (size_t));
+  l.hist = calloc ((size_t) nbands * GIZA_LIMITS_NBINS, sizeof (size_t));
+  l.offset[0] = malloc ((size_t) nbands * sizeof (size_t));
+  l.offset[1] = malloc ((size_t) nbands * sizeof (size_t));
+  l.sel[0] = NULL;
+  l.sel[1] = NULL;
+  total = malloc (GIZA_LIMITS_NBINS * sizeof (size_t));
+  ok = (l.row && l.bmin && l.bmax && l.count && l.hist && l.offset[0] && l.offset[1] && total);
+  if (!ok)
+    _giza_warning (caller, "Allocation failed");
+
+  /* the range and number of the values that count */
+  if (ok)
+    {
+      l.pass = GIZA_LIMITS_RANGE;
+      _giza_parallel_for (nbands, height, _giza_limits_band, &l);
+      n = 0;
+      lo = hi = 0.;
+      for (b = 0; b < nbands; b++)
+        {
+          if (l.count[b] == 0)
+            continue;
+          if (n == 0 || l.bmin[b] < lo) lo = l.bmin[b];
+          if (n == 0 || l.bmax[b] > hi) hi = l.bmax[b];
+          n += l.count[b];
+        }
+      if (n == 0)
+        {
+          _giza_warning (caller, "No valid data to find limits from");
+          ok = 0;
+        }
+    }
+
+  if (ok && lo == hi)
+    {
+      *valMin = lo;
+      *valMax = hi;
+    }
+  else if (ok)
+    {
+      rank[0] = (size_t) floor (pmin/100. * (double) (n - 1) + 0.5);
+      rank[1] = (size_t) floor (pmax/100. * (double) (n - 1) + 0.5);
+
+      /* which bins of a histogram the wanted values fall in */
+      l.lo = lo;
+      l.scale = GIZA_LIMITS_NBINS / (hi - lo);
+      l.pass = GIZA_LIMITS_HISTOGRAM;
+      _giza_parallel_for (nbands, height, _giza_limits_band, &l);
+      for (bin = 0; bin < GIZA_LIMITS_NBINS; bin++)
+        {
+          total[bin] = 0;
+          for (b = 0; b < nbands; b++)
+            total[bin] += l.hist[(size_t) b * GIZA_LIMITS_NBINS + bin];
+        }
+      for (t = 0; t < 2; t++)
+        {
+          below = 0;
+          for (bin = 0; below + total[bin] <= rank[t]; bin++)
+            below += total[bin];
+          l.bin[t] = bin;
+          rank[t] -= below;
+          l.offset[t][0] = 0;
+          for (b = 1; b < nbands; b++)
+            l.offset[t][b] = l.offset[t][b-1] + l.hist[(size_t) (b-1) * GIZA_LIMITS_NBINS + bin];
+          l.sel[t] = malloc (total[bin] * sizeof (double));
+        }
+      if (!l.sel[0] || !l.sel[1])
+        {
+          _giza_warning (caller, "Allocation failed");
+          ok = 0;
+        }
+
+      /* and select them from the values in those bins */
+      if (ok)
+        {
+          l.pass = GIZA_LIMITS_GATHER;
+          _giza_parallel_for (nbands, height, _giza_limits_band, &l);
+          *valMin = _giza_select (l.sel[0], total[l.bin[0]], rank[0]);
+          *valMax = _giza_select (l.sel[1], total[l.bin[1]], rank[1]);
+        }
+    }
+
+  free (l.row);
+  free (l.bmin);
+  free (l.bmax);
+  free (l.count);
+  free (l.hist);
+  free (l.offset[0]);
+  free (l.offset[1]);
+  free (l.sel[0]);
+  free (l.sel[1]);
+  free (total);
+  return !ok;
+}
+
+/**
+ * One pass over rows start..end-1 for _giza_render_limits: finds the range
+ * of the values, counts them into the histogram, or gathers those in the
+ * bins holding the percentiles, depending on l->pass
+ */
+static void
+_giza_limits_band (void *arg, int start, int end, int band)
+{
+  giza_limits_t *l = (giza_limits_t *) arg;
+  double *row = l->row + (size_t) band * l->width;
+  size_t *hist = l->hist + (size_t) band * GIZA_LIMITS_NBINS;
+  size_t offset, k, count = 0, next[2] = { 0, 0 };
+  double v, x, vmin = 0., vmax = 0.;
+  int i, j, bin;
+
+  if (l->pass == GIZA_LIMITS_GATHER)
+    {
+      next[0] = l->offset[0][band];
+      next[1] = l->offset[1][band];
+    }
+
+  for (j = start; j < end; j++)
+    {
+      offset = (size_t) (l->j1 + j) * l->sizex + l->i1;
+      _giza_data_row (l->type, l->data, offset, l->width, row);
+      for (i = 0; i < l->width; i++)
+        {
+          v = row[i];
+          k = offset + (size_t) i;
+          if (!isfinite (v) || v == l->blank
+              || (l->mask && !(l->mask[k >> 3] & (1 << (k & 7)))))
+            continue;
+
+          if (l->pass == GIZA_LIMITS_RANGE)
+            {
+              if (count == 0 || v < vmin) vmin = v;
+              if (count == 0 || v > vmax) vmax = v;
+              count++;
+              continue;
+            }
+
+          /* NaN when the range overflows, which goes in the last bin */
+          x = (v - l->lo) * l->scale;
+          bin = (x < GIZA_LIMITS_NBINS) ? (int) x : GIZA_LIMITS_NBINS - 1;
+          if (l->pass == GIZA_LIMITS_HISTOGRAM)
+            hist[bin]++;
+          else
+            {
+              if (bin == l->bin[0])
+                l->sel[0][next[0]++] = v;
+              if (bin == l->bin[1])
+                l->sel[1][next[1]++] = v;
+            }
+        }
+    }
+
+  if (l->pass == GIZA_LIMITS_RANGE)
+    {
+      l->bmin[band] = vmin;
+      l->bmax[band] = vmax;
+      l->count[band] = count;
+    }
+}
+
+/* the k-th smallest of n values (from 0), reordering them */
+static double
+_giza_select (double *val, size_t n, size_t k)
+{
+  ptrdiff_t lo = 0, hi = (ptrdiff_t) n - 1, i, j, want = (ptrdiff_t) k;
+  double pivot, tmp;
+
+  while (lo < hi)
+    {
+      /* median of three as the pivot */
+      i = lo + (hi - lo)/2;
+      if (val[i] < val[lo]) { tmp = val[i]; val[i] = val[lo]; val[lo] = tmp; }
+      if (val[hi] < val[lo]) { tmp = val[hi]; val[hi] = val[lo]; val[lo] = tmp; }
+      if (val[hi] < val[i]) { tmp = val[hi]; val[hi] = val[i]; val[i] = tmp; }
+      pivot = val[i];
+
+      i = lo;
+      j = hi;
+      while (i <= j)
+        {
+          while (val[i] < pivot) i++;
+          while (pivot < val[j]) j--;
+          if (i <= j)
+            {
+              tmp = val[i]; val[i] = val[j]; val[j] = tmp;
+              i++;
+              j--;
+            }
+        }
+      /* now val[lo..j] <= pivot <= val[i..hi] */
+      if (want <= j)
+        hi = j;
+      else if (want >= i)
+        lo = i;
+      else
+        break;
+    }
+  return val[k];
+}
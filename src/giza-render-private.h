@@ -22,14 +22,56 @@
  *      Daniel Price <daniel.price@monash.edu> (main contact)
  */
 
-static void _giza_colour_pixel (unsigned char *array, int pixNum, double pos);
-static void _giza_colour_pixel_alpha (unsigned char *array, int pixNum, double pos, double alpha);
-static void _giza_colour_pixel_index_alpha (unsigned char *array, int pixNum, int ci, double alpha);
+#include <stddef.h>
+#include <stdint.h>
+
+/* which pixels giza_render_blanked leaves out, besides NaNs */
+typedef struct
+{
+  double value;               /* data equal to this are blank */
+  const unsigned char *mask;  /* one bit per data value, clear if blank, or NULL */
+} giza_render_blank_t;
+
+/* a band of rows of a pixmap being coloured by _giza_render */
+typedef struct
+{
+  const void *data;
+  const void *alpha;
+  int type;                 /* GIZA_DATA_* */
+  int sizex, i1, j1, width, stride;
+  int itf, cimin, cimax, transparent;
+  const double *itflut;     /* table for the transfer function, or NULL */
+  double valMin, valMax;
+  const uint32_t *lut;
+  unsigned char *pixdata;
+  int *idx;
+  double *row;              /* integer data converted to double */
+  const uint32_t *pixlut;   /* pixel for every value of 8 or 16 bit data */
+  const giza_render_blank_t *blank; /* or NULL if no pixels are blank */
+  unsigned char *blanked;   /* scratch, one flag per pixel in the row */
+} giza_render_band_t;
+
+/* minimum number of pixels worth giving to a thread */
+#define GIZA_RENDER_BAND_PIXELS 65536
+
 void _giza_render (int sizex, int sizey, const double* data, int i1, int i2,
 	           int j1, int j2, double valMin, double valMax, const double *affine,
                    int transparent, int extend, int filter, const double* datalpha);
 void _giza_render_float (int sizex, int sizey, const float* data, int i1,
 		   int i2, int j1, int j2, float valMin, float valMax,
 		   const float *affine, int transparent, int extend, int filter, const float* datalpha);
+void _giza_clip_to_window (void);
+int _giza_render_margin (int filter, int limit);
+size_t _giza_data_size (int type);
+double _giza_data_value (int type, const void *data, size_t k);
+void _giza_data_row (int type, const void *data, size_t k, int n, double *val);
+void _giza_render_colours (int *cimin, int *cimax, uint32_t *lut);
+const double *_giza_render_itf_table (const giza_render_band_t *b, int height, double *table);
+int _giza_render_pixmap (giza_render_band_t *b, int height);
+int _giza_render_resampled (const giza_render_band_t *src, int height, int extend, int filter);
+void _giza_render_typed (const char *caller, int type, int sizex, int sizey, const void *data,
+                         int i1, int i2, int j1, int j2, double valMin, double valMax,
+                         const cairo_matrix_t *mat, int transparent, int extend, int filter,
+                         const void *datalpha, const giza_render_blank_t *blank);
 void _giza_get_extend (int extend, cairo_extend_t *cairoextend);
 void _giza_get_filter (int filter, cairo_filter_t *cairofilter);
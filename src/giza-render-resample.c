@@ -0,0 +1,408 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+#include "giza-io-private.h"
+#include "giza-private.h"
+#include "giza-render-private.h"
+#include "giza-threads-private.h"
+#include <giza.h>
+#include <stdlib.h>
+#include <math.h>
+
+/* largest resampled image, in device pixels, before giving up and letting
+ * cairo do the scaling (e.g. a magnified image on a very large page) */
+#define GIZA_RESAMPLE_MAX_PIXELS (1 << 26)
+
+/* fraction of a data pixel regarded as not covered at all */
+#define GIZA_RESAMPLE_EPS 1e-6
+
+/* the mapping from device pixels back to data pixels */
+typedef struct
+{
+  const giza_render_band_t *src;
+  int mode;
+  int magnify;
+  int bilinear;
+  int height;
+  int type;                   /* of the resampled data */
+  int nx, ny;
+  int *ilo, *ihi, *jlo, *jhi; /* data pixels covered by each device column/row */
+  double *uc, *vc;            /* data coordinates of device pixel centres */
+  void *out;
+  void *outalpha;
+  double *acc;                /* scratch, 3*nx per band */
+} giza_resample_t;
+
+static void _giza_resample_axis (int n, int first, double p, double scale, double offset,
+                                 int size, int *lo, int *hi, double *centre);
+static void _giza_resample_band (void *arg, int start, int end, int band);
+
+/**
+ * Settings: giza_set_image_resample
+ *
+ * Synopsis: Sets whether images are resampled to the device resolution
+ *           before they are coloured and drawn.
+ *
+ * By default every data pixel in the range given to giza_render is
+ * coloured and cairo scales the resulting image onto the device. With
+ * resampling switched on, images that are drawn unrotated are first
+ * reduced to one value per device pixel, which is much faster when the data
+ * has many more pixels than the device. Magnified images are interpolated
+ * at the device resolution instead, with nearest neighbour interpolation
+ * for GIZA_FILTER_NEAREST and GIZA_FILTER_FAST and bilinear otherwise.
+ * Rotated or sheared images, and images drawn with GIZA_EXTEND_REPEAT or
+ * GIZA_EXTEND_REFLECT, are always drawn as usual.
+ *
+ * Input:
+ *  -mode :- how to reduce the data pixels falling in one device pixel
+ *
+ * Allowed modes:
+ *  -0 or GIZA_RESAMPLE_NONE    :- no resampling (default)
+ *  -1 or GIZA_RESAMPLE_NEAREST :- the data pixel at the centre of the device pixel
+ *  -2 or GIZA_RESAMPLE_MEAN    :- the mean of the data pixels, ignoring NaNs
+ *  -3 or GIZA_RESAMPLE_MIN     :- the minimum of the data pixels, ignoring NaNs
+ *  -4 or GIZA_RESAMPLE_MAX     :- the maximum of the data pixels, ignoring NaNs
+ *
+ * See Also: giza_get_image_resample, giza_render
+ */
+void
+giza_set_image_resample (int mode)
+{
+  if (!_giza_check_device_ready ("giza_set_image_resample"))
+    return;
+  if (mode < GIZA_RESAMPLE_NONE || mode > GIZA_RESAMPLE_MAX)
+    {
+      _giza_warning ("giza_set_image_resample",
+                     "Invalid resampling mode, not set");
+      return;
+    }
+  Dev[id].resample = mode;
+}
+
+/**
+ * Settings: giza_get_image_resample
+ *
+ * Synopsis: Queries the image resampling mode
+ *
+ * Output:
+ *  -mode :- the current mode
+ *
+ * See Also: giza_set_image_resample
+ */
+void
+giza_get_image_resample (int *mode)
+{
+  if (!_giza_check_device_ready ("giza_get_image_resample"))
+    return;
+  *mode = Dev[id].resample;
+}
+
+/**
+ * Draws the image described by src (height rows) at the device resolution.
+ * Must be called with the image transformation applied to the context.
+ * Returns 0 if the image cannot be drawn this way, in which case the
+ * caller should draw it as usual.
+ */
+int
+_giza_render_resampled (const giza_render_band_t *src, int height, int extend, int filter)
+{
+  cairo_t *cr = Dev[id].context;
+  cairo_matrix_t ctm;
+  cairo_surface_t *pixmap;
+  giza_render_band_t colour;
+  giza_resample_t r;
+  double p = Dev[id].deviceUnitsPerPixel;
+  double x1, y1, x2, y2, work;
+  int c0, r0, nbands, ok;
+  size_t npix;
+
+  if (extend == GIZA_EXTEND_REPEAT || extend == GIZA_EXTEND_REFLECT)
+    return 0;
+
+  /* only for images that stay aligned with the device pixels */
+  cairo_get_matrix (cr, &ctm);
+  if (ctm.xy != 0. || ctm.yx != 0. || ctm.xx == 0. || ctm.yy == 0. || !(p > 0.))
+    return 0;
+
+  /* find the device pixels that can be drawn on */
+  cairo_save (cr);
+  if (extend != GIZA_EXTEND_PAD)
+    {
+      cairo_rectangle (cr, 0., 0., (double) src->width, (double) height);
+      cairo_clip (cr);
+    }
+  cairo_identity_matrix (cr);
+  cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+
+  c0 = (int) floor (x1/p);
+  r0 = (int) floor (y1/p);
+  r.nx = (int) ceil (x2/p) - c0;
+  r.ny = (int) ceil (y2/p) - r0;
+  if (r.nx <= 0 || r.ny <= 0)
+    {
+      /* nothing visible */
+      cairo_restore (cr);
+      return 1;
+    }
+  npix = (size_t) r.nx * (size_t) r.ny;
+  if ((double) r.nx * (double) r.ny > GIZA_RESAMPLE_MAX_PIXELS)
+    {
+      cairo_restore (cr);
+      return 0;
+    }
+
+  r.src = src;
+  r.height = height;
+  r.mode = Dev[id].resample;
+  r.magnify = (fabs (ctm.xx) >= p && fabs (ctm.yy) >= p);
+  r.bilinear = (filter != GIZA_FILTER_NEAREST && filter != GIZA_FILTER_FAST);
+  r.ilo = malloc (2 * (size_t) r.nx * sizeof (int));
+  r.jlo = malloc (2 * (size_t) r.ny * sizeof (int));
+  r.uc = malloc ((size_t) r.nx * sizeof (double));
+  r.vc = malloc ((size_t) r.ny * sizeof (double));
+  /* reduced integer data need not be whole numbers */
+  r.type = (src->type == GIZA_DATA_FLOAT) ? GIZA_DATA_FLOAT : GIZA_DATA_DOUBLE;
+  r.out = malloc (npix * _giza_data_size (r.type));
+  r.outalpha = (src->transparent==2) ? malloc (npix * _giza_data_size (r.type)) : NULL;
+
+  /* work per row of device pixels decides how many threads to use */
+  work = r.magnify ? r.nx : (double) src->width * height / r.ny + r.nx;
+  nbands = _giza_thread_bands (r.ny, (int) ceil (GIZA_RENDER_BAND_PIXELS / work));
+  r.acc = malloc ((size_t) nbands * 3 * (size_t) r.nx * sizeof (double));
+
+  colour = *src;
+  colour.type = r.type;
+  colour.sizex = r.nx;
+  colour.i1 = 0;
+  colour.j1 = 0;
+  colour.width = r.nx;
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 6, 0)
+  colour.stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, r.nx);
+#else
+  colour.stride = 4*r.nx;
+#endif
+  colour.pixdata = malloc ((size_t) colour.stride * (size_t) r.ny);
+
+  ok = (r.ilo && r.jlo && r.uc && r.vc && r.out && r.acc && colour.pixdata
+        && (r.outalpha || src->transparent!=2));
+  if (ok)
+    {
+      r.ihi = r.ilo + r.nx;
+      r.jhi = r.jlo + r.ny;
+      _giza_resample_axis (r.nx, c0, p, ctm.xx, ctm.x0, src->width, r.ilo, r.ihi, r.uc);
+      _giza_resample_axis (r.ny, r0, p, ctm.yy, ctm.y0, height, r.jlo, r.jhi, r.vc);
+      _giza_parallel_for (nbands, r.ny, _giza_resample_band, &r);
+
+      colour.data = r.out;
+      colour.alpha = r.outalpha;
+      ok = _giza_render_pixmap (&colour, r.ny);
+    }
+
+  if (ok)
+    {
+      /* blit one image pixel per device pixel */
+      pixmap = cairo_image_surface_create_for_data (colour.pixdata, CAIRO_FORMAT_ARGB32,
+                                                    r.nx, r.ny, colour.stride);
+      cairo_scale (cr, p, p);
+      cairo_set_source_surface (cr, pixmap, (double) c0, (double) r0);
+      cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_NONE);
+      cairo_pattern_set_filter (cairo_get_source (cr), CAIRO_FILTER_NEAREST);
+      cairo_paint (cr);
+      cairo_surface_destroy (pixmap);
+    }
+
+  cairo_restore (cr);
+  free (r.ilo);
+  free (r.jlo);
+  free (r.uc);
+  free (r.vc);
+  free (r.out);
+  free (r.outalpha);
+  free (r.acc);
+  free (colour.pixdata);
+  return ok;
+}
+
+/**
+ * Works out, for each of n device pixels along one axis starting at
+ * device pixel first, the range of data pixels lo..hi it covers and the
+ * data coordinate of its centre. Data coordinate u maps to device
+ * coordinate scale*u + offset; out of range pixels are clamped to the edge.
+ */
+static void
+_giza_resample_axis (int n, int first, double p, double scale, double offset,
+                     int size, int *lo, int *hi, double *centre)
+{
+  double ua, ub, tmp;
+  int k;
+
+  for (k = 0; k < n; k++)
+    {
+      ua = ((first + k)*p - offset)/scale;
+      ub = ((first + k + 1)*p - offset)/scale;
+      if (ub < ua)
+        {
+          tmp = ua;
+          ua = ub;
+          ub = tmp;
+        }
+      centre[k] = ((first + k + 0.5)*p - offset)/scale;
+      /* ignore slivers of data pixels due to round off */
+      lo[k] = (int) floor (ua + GIZA_RESAMPLE_EPS);
+      hi[k] = (int) ceil (ub - GIZA_RESAMPLE_EPS) - 1;
+      if (hi[k] < lo[k])
+        hi[k] = lo[k];
+      lo[k] = MAX(0, MIN(size - 1, lo[k]));
+      hi[k] = MAX(0, MIN(size - 1, hi[k]));
+    }
+}
+
+/* value of data pixel (i,j) of the image, relative to (i1,j1) */
+static double
+_giza_resample_get (const giza_render_band_t *s, const void *data, int i, int j)
+{
+  size_t k = (size_t) (s->j1 + j) * s->sizex + s->i1 + i;
+
+  /* alpha is only given for floating point data, and has the same type */
+  return _giza_data_value (s->type, data, k);
+}
+
+/* nearest or bilinear interpolation of data at data coordinates (u,v) */
+static double
+_giza_resample_point (const giza_resample_t *r, const void *data, double u, double v)
+{
+  const giza_render_band_t *s = r->src;
+  int ia, ib, ja, jb;
+  double tx, ty;
+
+  if (!r->bilinear || !r->magnify || r->mode == GIZA_RESAMPLE_NEAREST)
+    {
+      ia = MAX(0, MIN(s->width - 1, (int) floor (u)));
+      ja = MAX(0, MIN(r->height - 1, (int) floor (v)));
+      return _giza_resample_get (s, data, ia, ja);
+    }
+
+  /* pixel centres sit at half-integer coordinates */
+  u -= 0.5;
+  v -= 0.5;
+  ia = (int) floor (u);
+  ja = (int) floor (v);
+  tx = u - ia;
+  ty = v - ja;
+  ib = MAX(0, MIN(s->width - 1, ia + 1));
+  ia = MAX(0, MIN(s->width - 1, ia));
+  jb = MAX(0, MIN(r->height - 1, ja + 1));
+  ja = MAX(0, MIN(r->height - 1, ja));
+  return (1. - ty) * ((1. - tx) * _giza_resample_get (s, data, ia, ja)
+                      + tx * _giza_resample_get (s, data, ib, ja))
+         + ty * ((1. - tx) * _giza_resample_get (s, data, ia, jb)
+                 + tx * _giza_resample_get (s, data, ib, jb));
+}
+
+/* computes rows start..end-1 of the resampled image */
+static void
+_giza_resample_band (void *arg, int start, int end, int band)
+{
+  const giza_resample_t *r = arg;
+  const giza_render_band_t *s = r->src;
+  double *val = r->acc + (size_t) band * 3 * r->nx;
+  double *alpha = val + r->nx;
+  double *count = alpha + r->nx;
+  double v, a;
+  size_t k;
+  int c, i, j, row;
+
+  for (row = start; row < end; row++)
+    {
+      if (r->magnify || r->mode == GIZA_RESAMPLE_NEAREST)
+        {
+          for (c = 0; c < r->nx; c++)
+            {
+              val[c] = _giza_resample_point (r, s->data, r->uc[c], r->vc[row]);
+              if (s->alpha)
+                alpha[c] = _giza_resample_point (r, s->alpha, r->uc[c], r->vc[row]);
+            }
+        }
+      else
+        {
+          for (c = 0; c < r->nx; c++)
+            {
+              val[c] = (r->mode == GIZA_RESAMPLE_MEAN) ? 0. : NAN;
+              alpha[c] = 0.;
+              count[c] = 0.;
+            }
+          for (j = r->jlo[row]; j <= r->jhi[row]; j++)
+            {
+              for (c = 0; c < r->nx; c++)
+                {
+                  for (i = r->ilo[c]; i <= r->ihi[c]; i++)
+                    {
+                      v = _giza_resample_get (s, s->data, i, j);
+                      a = s->alpha ? _giza_resample_get (s, s->alpha, i, j) : 1.;
+                      if (r->mode == GIZA_RESAMPLE_MEAN)
+                        {
+                          /* blank (NaN) pixels do not count, but are still see-through */
+                          alpha[c] += a;
+                          if (isnan (v))
+                            continue;
+                          val[c] += v;
+                          count[c] += 1.;
+                        }
+                      else if (count[c] == 0. || isnan (val[c])
+                               || (r->mode == GIZA_RESAMPLE_MIN ? v < val[c] : v > val[c]))
+                        {
+                          /* the extreme pixel brings its own opacity */
+                          val[c] = v;
+                          alpha[c] = a;
+                          count[c] = 1.;
+                        }
+                    }
+                }
+            }
+          if (r->mode == GIZA_RESAMPLE_MEAN)
+            {
+              for (c = 0; c < r->nx; c++)
+                {
+                  alpha[c] /= (double) (r->ihi[c] - r->ilo[c] + 1) * (r->jhi[row] - r->jlo[row] + 1);
+                  val[c] = (count[c] > 0.) ? val[c] / count[c] : NAN;
+                }
+            }
+        }
+
+      k = (size_t) row * r->nx;
+      for (c = 0; c < r->nx; c++)
+        {
+          if (r->type == GIZA_DATA_FLOAT)
+            {
+              ((float *) r->out)[k + c] = (float) val[c];
+              if (r->outalpha)
+                ((float *) r->outalpha)[k + c] = (float) alpha[c];
+            }
+          else
+            {
+              ((double *) r->out)[k + c] = val[c];
+              if (r->outalpha)
+                ((double *) r->outalpha)[k + c] = alpha[c];
+            }
+        }
+    }
+}
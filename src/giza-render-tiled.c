@@ -0,0 +1,366 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+/*
+ * Rendering of images too large to hold in memory, a tile at a time.
+ * Each tile is read with a margin of neighbouring pixels wide enough for
+ * the interpolation filter, and painted with an aliased clip to its own
+ * pixels, so every device pixel is coloured by exactly one tile from the
+ * same neighbourhood as it would be in a single image: there are no seams.
+ */
+
+#include "giza-io-private.h"
+#include "giza-private.h"
+#include "giza-transforms-private.h"
+#include "giza-itf.h"
+#include "giza-render-private.h"
+#include <giza.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef _WIN32
+#define GIZA_HAVE_MMAP 1
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+/* largest tile, excluding the margin, in pixels along each side */
+#define GIZA_TILE_SIZE 2048
+
+/* data source for tiles read from a raw file */
+typedef struct
+{
+  size_t elsize;
+  int sizex;
+#ifdef GIZA_HAVE_MMAP
+  const unsigned char *map;
+  size_t offset;
+#else
+  FILE *file;
+  long offset;
+#endif
+} giza_tile_file_t;
+
+static int _giza_read_file_tile (void *user, int i1, int i2, int j1, int j2, void *tile);
+
+/**
+ * Drawing: giza_render_tiled
+ *
+ * Synopsis: Renders an image that need not be held in memory, a tile at a time.
+ *
+ * Draws the same image as giza_render (or giza_render_float) would for
+ * the whole array, but the data are requested from the reader function
+ * one tile at a time, so the memory used depends on the tile size
+ * rather than on the size of the image. Tiles join without seams
+ * whatever the filter, except that
+ * GIZA_EXTEND_REPEAT and GIZA_EXTEND_REFLECT are treated as GIZA_EXTEND_NONE,
+ * the image is not resampled as set by giza_set_image_resample, and
+ * histogram equalisation, which needs all the data at once, is drawn as
+ * the linear transfer function.
+ *
+ * Input:
+ *  -sizex  :- The dimensions of the data in the x-direction
+ *  -sizey  :- The dimensions of the data in the y-direction
+ *  -type   :- The type of the data: GIZA_DATA_DOUBLE, GIZA_DATA_FLOAT, GIZA_DATA_U8,
+ *             GIZA_DATA_U16, GIZA_DATA_I16 or GIZA_DATA_I32
+ *  -reader :- Function that fills tile with the data in columns i1..i2
+ *             and rows j1..j2, one row after another, and returns 0
+ *             (any other value abandons the rendering)
+ *  -user   :- Passed on to reader
+ *  -i1     :- The first index in the x-direction to render
+ *  -i2     :- The last index in the x-direction to render
+ *  -j1     :- The first index in the y-direction to render
+ *  -j2     :- The last index in the y-direction to render
+ *  -valMin, valMax, extend, filter, affine :- As for giza_render
+ *
+ * See Also: giza_render, giza_render_file
+ */
+void
+giza_render_tiled (int sizex, int sizey, int type,
+                   int (*reader) (void *user, int i1, int i2, int j1, int j2, void *tile),
+                   void *user, int i1, int i2, int j1, int j2, double valMin, double valMax,
+                   int extend, int filter, const double *affine)
+{
+  if (!_giza_check_device_ready ("giza_render_tiled"))
+    return;
+
+  if (sizex < 1 || sizey < 1)
+    {
+      _giza_warning ("giza_render_tiled", "Invalid array size, skipping render.");
+      return;
+    }
+  if (i1 < 0 || i2 < i1 || j1 < 0 || j2 < j1)
+    {
+      _giza_warning ("giza_render_tiled", "Invalid index range, skipping render.");
+      return;
+    }
+  if (_giza_data_size (type) == 0)
+    {
+      _giza_warning ("giza_render_tiled", "Invalid data type, skipping render.");
+      return;
+    }
+  /* Clamp indices to array bounds to avoid OOB reads */
+  if (i2 >= sizex) i2 = sizex - 1;
+  if (j2 >= sizey) j2 = sizey - 1;
+  if (i1 >= sizex || j1 >= sizey)
+    {
+      _giza_warning ("giza_render_tiled", "Index range outside array bounds, skipping render.");
+      return;
+    }
+
+  cairo_extend_t cairoextendtype;
+  cairo_filter_t cairofiltertype;
+  cairo_matrix_t mat;
+  cairo_surface_t *pixmap;
+  giza_render_band_t band;
+  double itflut[GIZA_ITF_LUT_SIZE];
+  size_t elsize = _giza_data_size (type);
+  void *tile;
+  double cx1, cy1, cx2, cy2, x1, y1, x2, y2;
+  int margin, ti, tj, ta, tb, ca, cb, width, height, stride;
+
+  if (extend == GIZA_EXTEND_REPEAT || extend == GIZA_EXTEND_REFLECT)
+    extend = GIZA_EXTEND_NONE;
+  _giza_get_extend (extend, &cairoextendtype);
+  _giza_get_filter (filter, &cairofiltertype);
+
+  int oldTrans = _giza_get_trans ();
+  _giza_set_trans (GIZA_TRANS_WORLD);
+
+  cairo_save (Dev[id].context);
+  _giza_clip_to_window ();
+  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
+                     affine[4], affine[5]);
+  cairo_transform (Dev[id].context, &mat);
+
+  /* what can be drawn on, in image pixels, for tiles at the edge of the image */
+  cairo_clip_extents (Dev[id].context, &cx1, &cy1, &cx2, &cy2);
+  margin = _giza_render_margin (filter, GIZA_TILE_SIZE/2);
+
+  /* scratch space for the largest tile */
+  width = MIN(GIZA_TILE_SIZE, i2 - i1 + 1) + 2*margin;
+  height = MIN(GIZA_TILE_SIZE, j2 - j1 + 1) + 2*margin;
+#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 6, 0)
+  stride = cairo_format_stride_for_width (CAIRO_FORMAT_ARGB32, width);
+#else
+  stride = 4*width;
+#endif
+  tile = malloc ((size_t) width * (size_t) height * elsize);
+  band.pixdata = malloc ((size_t) stride * (size_t) height);
+  if (!tile || !band.pixdata)
+    {
+      _giza_warning ("giza_render_tiled", "Allocation failed, skipping render.");
+      free (tile);
+      free (band.pixdata);
+      cairo_restore (Dev[id].context);
+      _giza_set_trans (oldTrans);
+      return;
+    }
+
+  band.alpha = NULL;
+  band.type = type;
+  band.i1 = 0;
+  band.j1 = 0;
+  band.itf = Dev[id].itf;
+  band.transparent = 0;
+  band.blank = NULL;
+  band.valMin = valMin;
+  band.valMax = valMax;
+  /* without the data, histogram equalisation gets no table, so is linear */
+  band.data = NULL;
+  band.itflut = _giza_render_itf_table (&band, 0, itflut);
+  band.data = tile;
+
+  for (tj = j1; tj <= j2; tj += GIZA_TILE_SIZE)
+    {
+      for (ti = i1; ti <= i2; ti += GIZA_TILE_SIZE)
+        {
+          /* the tile, and the margin around it that lies within the image */
+          ca = MAX(i1, ti - margin);
+          cb = MIN(i2, ti + GIZA_TILE_SIZE - 1 + margin);
+          ta = MAX(j1, tj - margin);
+          tb = MIN(j2, tj + GIZA_TILE_SIZE - 1 + margin);
+          band.sizex = band.width = cb - ca + 1;
+          band.stride = stride;
+
+          if (reader (user, ca, cb, ta, tb, tile) != 0)
+            {
+              _giza_warning ("giza_render_tiled", "Could not read data, render incomplete.");
+              tj = j2 + 1;
+              break;
+            }
+          if (!_giza_render_pixmap (&band, tb - ta + 1))
+            {
+              _giza_warning ("giza_render_tiled", "Allocation failed, render incomplete.");
+              tj = j2 + 1;
+              break;
+            }
+
+          /* the pixels belonging to this tile, in image pixels, reaching
+           * out to the edge of the clip region on the edges of the image */
+          x1 = (ti == i1) ? MIN(cx1, 0.) : ti - i1;
+          x2 = (ti + GIZA_TILE_SIZE > i2) ? MAX(cx2, i2 - i1 + 1.) : ti + GIZA_TILE_SIZE - i1;
+          y1 = (tj == j1) ? MIN(cy1, 0.) : tj - j1;
+          y2 = (tj + GIZA_TILE_SIZE > j2) ? MAX(cy2, j2 - j1 + 1.) : tj + GIZA_TILE_SIZE - j1;
+
+          cairo_save (Dev[id].context);
+          cairo_set_antialias (Dev[id].context, CAIRO_ANTIALIAS_NONE);
+          cairo_rectangle (Dev[id].context, x1, y1, x2 - x1, y2 - y1);
+          cairo_clip (Dev[id].context);
+
+          pixmap = cairo_image_surface_create_for_data (band.pixdata, CAIRO_FORMAT_ARGB32,
+                                                        band.width, tb - ta + 1, stride);
+          cairo_set_source_surface (Dev[id].context, pixmap, ca - i1, ta - j1);
+          cairo_pattern_set_extend (cairo_get_source (Dev[id].context), cairoextendtype);
+          cairo_pattern_set_filter (cairo_get_source (Dev[id].context), cairofiltertype);
+          cairo_paint (Dev[id].context);
+          cairo_restore (Dev[id].context);
+          cairo_surface_destroy (pixmap);
+        }
+    }
+
+  cairo_restore (Dev[id].context);
+  _giza_set_trans (oldTrans);
+  free (tile);
+  free (band.pixdata);
+
+  giza_flush_device ();
+}
+
+/**
+ * Drawing: giza_render_file
+ *
+ * Synopsis: Renders an image stored in a raw binary file, a tile at a time.
+ *
+ * The file holds sizex*sizey values of the given type in the native byte
+ * order, one row after another, starting offset bytes into the file. Where
+ * possible the file is memory mapped, so only the pages needed for each
+ * tile are read. See giza_render_tiled.
+ *
+ * Input:
+ *  -filename :- The file containing the data
+ *  -offset   :- Bytes to skip at the start of the file
+ *  -type     :- The type of the data, as for giza_render_tiled
+ *  -sizex, sizey, i1, i2, j1, j2, valMin, valMax, extend, filter, affine :-
+ *               As for giza_render
+ *
+ * See Also: giza_render_tiled, giza_render
+ */
+void
+giza_render_file (const char *filename, long offset, int type, int sizex, int sizey,
+                  int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine)
+{
+  giza_tile_file_t src;
+  size_t nbytes;
+
+  if (!_giza_check_device_ready ("giza_render_file"))
+    return;
+  if (_giza_data_size (type) == 0)
+    {
+      _giza_warning ("giza_render_file", "Invalid data type, skipping render.");
+      return;
+    }
+  if (sizex < 1 || sizey < 1 || offset < 0)
+    {
+      _giza_warning ("giza_render_file", "Invalid array size, skipping render.");
+      return;
+    }
+
+  src.elsize = _giza_data_size (type);
+  src.sizex = sizex;
+  nbytes = (size_t) offset + (size_t) sizex * (size_t) sizey * src.elsize;
+
+#ifdef GIZA_HAVE_MMAP
+  struct stat st;
+  void *map;
+  int fd = open (filename, O_RDONLY);
+
+  if (fd < 0)
+    {
+      _giza_warning ("giza_render_file", "Could not open %s, skipping render.", filename);
+      return;
+    }
+  if (fstat (fd, &st) != 0 || (size_t) st.st_size < nbytes)
+    {
+      _giza_warning ("giza_render_file", "%s is too small for the image, skipping render.",
+                     filename);
+      close (fd);
+      return;
+    }
+  map = mmap (NULL, nbytes, PROT_READ, MAP_SHARED, fd, 0);
+  close (fd);
+  if (map == MAP_FAILED)
+    {
+      _giza_warning ("giza_render_file", "Could not map %s, skipping render.", filename);
+      return;
+    }
+  src.map = map;
+  src.offset = (size_t) offset;
+
+  giza_render_tiled (sizex, sizey, type, _giza_read_file_tile, &src, i1, i2, j1, j2,
+                     valMin, valMax, extend, filter, affine);
+  munmap (map, nbytes);
+#else
+  src.file = fopen (filename, "rb");
+  if (!src.file)
+    {
+      _giza_warning ("giza_render_file", "Could not open %s, skipping render.", filename);
+      return;
+    }
+  src.offset = offset;
+  (void) nbytes;
+
+  giza_render_tiled (sizex, sizey, type, _giza_read_file_tile, &src, i1, i2, j1, j2,
+                     valMin, valMax, extend, filter, affine);
+  fclose (src.file);
+#endif
+}
+
+/* copies columns i1..i2 of rows j1..j2 from a raw file */
+static int
+_giza_read_file_tile (void *user, int i1, int i2, int j1, int j2, void *tile)
+{
+  const giza_tile_file_t *src = (const giza_tile_file_t *) user;
+  size_t rowbytes = (size_t) (i2 - i1 + 1) * src->elsize;
+  unsigned char *dest = (unsigned char *) tile;
+  size_t pos;
+  int j;
+
+  for (j = j1; j <= j2; j++)
+    {
+      pos = ((size_t) j * src->sizex + i1) * src->elsize;
+#ifdef GIZA_HAVE_MMAP
+      memcpy (dest, src->map + src->offset + pos, rowbytes);
+#else
+      if (fseek (src->file, src->offset + (long) pos, SEEK_SET) != 0
+          || fread (dest, 1, rowbytes, src->file) != rowbytes)
+        return 1;
+#endif
+      dest += rowbytes;
+    }
+  return 0;
+}
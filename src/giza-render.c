@@ -27,15 +27,28 @@
 #include "giza-transforms-private.h"
 #include "giza-itf.h"
 #include "giza-render-private.h"
+#include "giza-colour-private.h"
+#include "giza-threads-private.h"
 #include <giza.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
 
+static void _giza_colour_pixel (unsigned char *array, int pixNum, double pos);
+static void _giza_colour_pixel_alpha (unsigned char *array, int pixNum, double pos, double alpha);
+static void _giza_render_hist_band (void *arg, int start, int end, int band);
+static void _giza_render_blank_row (const giza_render_band_t *b, size_t offset,
+                                    const double *val, unsigned char *blanked, uint32_t *row);
+static void _giza_render_int (const char *caller, int type, int sizex, int sizey, const void *data,
+                              int i1, int i2, int j1, int j2, double valMin, double valMax,
+                              int extend, int filter, const double *affine);
+
 /**
  * Restrict drawing to the current world-coordinate window (PGPLOT window
  * clipping). Viewport clipping alone does not crop cairo image paints correctly.
  */
-static void
+void
 _giza_clip_to_window (void)
 {
   int clip;
@@ -51,6 +64,459 @@ _giza_clip_to_window (void)
   cairo_clip (Dev[id].context);
 }
 
+/**
+ * Number of pixels around those that can be seen that may still affect the
+ * device, enough to cover the support of the interpolation filter at the
+ * current scale, which for reduced images spans several data pixels per
+ * device pixel. Must be called with the image transformation applied to
+ * the context; returns limit if the filter reaches further than that.
+ */
+int
+_giza_render_margin (int filter, int limit)
+{
+  double p = Dev[id].deviceUnitsPerPixel;
+  double ux = p, uy = 0., vx = 0., vy = p, reach;
+
+  if (filter == GIZA_FILTER_NEAREST || filter == GIZA_FILTER_FAST)
+    return 1;
+
+  cairo_device_to_user_distance (Dev[id].context, &ux, &uy);
+  cairo_device_to_user_distance (Dev[id].context, &vx, &vy);
+  reach = MAX(fabs (ux) + fabs (vx), fabs (uy) + fabs (vy));
+  if (!(reach < limit))
+    return limit;
+  return MIN(limit, 3 + (int) ceil (2.*reach));
+}
+
+/**
+ * Size in bytes of one value of a GIZA_DATA_* type, or 0 for an unknown type
+ */
+size_t
+_giza_data_size (int type)
+{
+  switch (type)
+    {
+    case GIZA_DATA_DOUBLE:
+      return sizeof (double);
+    case GIZA_DATA_FLOAT:
+      return sizeof (float);
+    case GIZA_DATA_U8:
+      return sizeof (unsigned char);
+    case GIZA_DATA_U16:
+      return sizeof (unsigned short);
+    case GIZA_DATA_I16:
+      return sizeof (short);
+    case GIZA_DATA_I32:
+      return sizeof (int);
+    }
+  return 0;
+}
+
+/**
+ * Value k of an array of a GIZA_DATA_* type
+ */
+double
+_giza_data_value (int type, const void *data, size_t k)
+{
+  switch (type)
+    {
+    case GIZA_DATA_FLOAT:
+      return ((const float *) data)[k];
+    case GIZA_DATA_U8:
+      return ((const unsigned char *) data)[k];
+    case GIZA_DATA_U16:
+      return ((const unsigned short *) data)[k];
+    case GIZA_DATA_I16:
+      return ((const short *) data)[k];
+    case GIZA_DATA_I32:
+      return ((const int *) data)[k];
+    }
+  return ((const double *) data)[k];
+}
+
+/* copies n values of a GIZA_DATA_* type starting at value k into val */
+void
+_giza_data_row (int type, const void *data, size_t k, int n, double *val)
+{
+  int i;
+
+  switch (type)
+    {
+    case GIZA_DATA_DOUBLE:
+      memcpy (val, (const double *) data + k, (size_t) n * sizeof (double));
+      break;
+    case GIZA_DATA_FLOAT:
+      {
+        const float *in = (const float *) data + k;
+        for (i = 0; i < n; i++)
+          val[i] = in[i];
+      }
+      break;
+    case GIZA_DATA_U8:
+      {
+        const unsigned char *in = (const unsigned char *) data + k;
+        for (i = 0; i < n; i++)
+          val[i] = in[i];
+      }
+      break;
+    case GIZA_DATA_U16:
+      {
+        const unsigned short *in = (const unsigned short *) data + k;
+        for (i = 0; i < n; i++)
+          val[i] = in[i];
+      }
+      break;
+    case GIZA_DATA_I16:
+      {
+        const short *in = (const short *) data + k;
+        for (i = 0; i < n; i++)
+          val[i] = in[i];
+      }
+      break;
+    default:
+      {
+        const int *in = (const int *) data + k;
+        for (i = 0; i < n; i++)
+          val[i] = in[i];
+      }
+    }
+}
+
+/* colours a row of 8 or 16 bit data from the table of pixels for every value */
+static void
+_giza_render_lookup_row (const giza_render_band_t *b, size_t k, uint32_t *row)
+{
+  const uint32_t *pixlut = b->pixlut;
+  int i;
+
+  switch (b->type)
+    {
+    case GIZA_DATA_U8:
+      {
+        const unsigned char *in = (const unsigned char *) b->data + k;
+        for (i = 0; i < b->width; i++)
+          row[i] = pixlut[in[i]];
+      }
+      break;
+    case GIZA_DATA_U16:
+      {
+        const unsigned short *in = (const unsigned short *) b->data + k;
+        for (i = 0; i < b->width; i++)
+          row[i] = pixlut[in[i]];
+      }
+      break;
+    default:
+      {
+        const short *in = (const short *) b->data + k;
+        for (i = 0; i < b->width; i++)
+          row[i] = pixlut[in[i] + 32768];
+      }
+    }
+}
+
+/**
+ * Colours the rows start..end-1 of the pixmap described by arg, using the
+ * scratch row of colour indices belonging to this band
+ */
+static void
+_giza_render_band (void *arg, int start, int end, int band)
+{
+  const giza_render_band_t *b = (const giza_render_band_t *) arg;
+  const uint32_t *lut = b->lut;
+  int *idx = b->idx + (size_t) band * b->width;
+  double *val = b->row ? b->row + (size_t) band * b->width : NULL;
+  unsigned char *blanked = b->blanked ? b->blanked + (size_t) band * b->width : NULL;
+  uint32_t *row;
+  size_t offset;
+  int i, j;
+
+  for (j = start; j < end; j++)
+    {
+      offset = (size_t) (b->j1 + j) * b->sizex + b->i1;
+      row = (uint32_t *) (b->pixdata + (size_t) j * b->stride);
+      if (b->pixlut)
+        {
+          _giza_render_lookup_row (b, offset, row);
+          continue;
+        }
+      if (b->type == GIZA_DATA_FLOAT)
+        _giza_itf_idx_row_f (b->itf, b->itflut, (const float *) b->data + offset, b->width,
+                             (float) b->valMin, (float) b->valMax, b->cimin, b->cimax, idx);
+      else if (b->type == GIZA_DATA_DOUBLE)
+        _giza_itf_idx_row (b->itf, b->itflut, (const double *) b->data + offset, b->width,
+                           b->valMin, b->valMax, b->cimin, b->cimax, idx);
+      else
+        {
+          _giza_data_row (b->type, b->data, offset, b->width, val);
+          _giza_itf_idx_row (b->itf, b->itflut, val, b->width,
+                             b->valMin, b->valMax, b->cimin, b->cimax, idx);
+        }
+
+      /* transparent if-statement is outside the pixel loop as optimisation */
+      if (b->transparent==2 && b->type == GIZA_DATA_FLOAT) {
+        const float *alpharow = (const float *) b->alpha + offset;
+        for (i = 0; i < b->width; i++)
+          row[i] = (lut[idx[i]] & 0x00ffffff) | ((uint32_t) (unsigned char) (alpharow[i] * 255.) << 24);
+      } else if (b->transparent==2) {
+        const double *alpharow = (const double *) b->alpha + offset;
+        for (i = 0; i < b->width; i++)
+          row[i] = (lut[idx[i]] & 0x00ffffff) | ((uint32_t) (unsigned char) (alpharow[i] * 255.) << 24);
+      } else if (b->transparent==1) {
+        for (i = 0; i < b->width; i++)
+          row[i] = (idx[i]==b->cimin) ? (lut[idx[i]] & 0x00ffffff) : lut[idx[i]];
+      } else {
+        for (i = 0; i < b->width; i++)
+          row[i] = lut[idx[i]];
+      }
+
+      if (b->blank)
+        _giza_render_blank_row (b, offset, val, blanked, row);
+    }
+}
+
+/**
+ * Clears the pixels in a row that are blank: NaN, equal to the blank value
+ * or with their bit in the mask clear. The check for NaNs and the blank
+ * value is vectorised, so rows without blanks cost little.
+ */
+static void
+_giza_render_blank_row (const giza_render_band_t *b, size_t offset, const double *val,
+                        unsigned char *blanked, uint32_t *row)
+{
+  const unsigned char *mask = b->blank->mask;
+  size_t k;
+  int i, nblank;
+
+  if (b->type == GIZA_DATA_FLOAT)
+    nblank = _giza_itf_blank_row_f ((const float *) b->data + offset, b->width,
+                                    (float) b->blank->value, blanked);
+  else if (b->type == GIZA_DATA_DOUBLE)
+    nblank = _giza_itf_blank_row ((const double *) b->data + offset, b->width,
+                                  b->blank->value, blanked);
+  else
+    nblank = _giza_itf_blank_row (val, b->width, b->blank->value, blanked);
+
+  if (nblank > 0)
+    for (i = 0; i < b->width; i++)
+      if (blanked[i])
+        row[i] = 0;
+
+  if (mask)
+    for (i = 0; i < b->width; i++)
+      {
+        k = offset + (size_t) i;
+        if (!(mask[k >> 3] & (1 << (k & 7))))
+          row[i] = 0;
+      }
+}
+
+/**
+ * For 8 and 16 bit data, the transfer function and the colour table
+ * together give one pixel for each possible value. If the image has
+ * enough pixels to make it worthwhile, returns a table of them, which
+ * turns colouring into one lookup per pixel; otherwise returns NULL.
+ */
+static uint32_t *
+_giza_render_value_table (const giza_render_band_t *b, int height)
+{
+  uint32_t *pixlut;
+  double *val;
+  int *idx;
+  int k, nvalues, first;
+
+  switch (b->type)
+    {
+    case GIZA_DATA_U8:
+      nvalues = 256;
+      first = 0;
+      break;
+    case GIZA_DATA_U16:
+      nvalues = 65536;
+      first = 0;
+      break;
+    case GIZA_DATA_I16:
+      nvalues = 65536;
+      first = -32768;
+      break;
+    default:
+      return NULL;
+    }
+  if (b->transparent==2 || b->blank || (double) b->width * height < nvalues)
+    return NULL;
+
+  pixlut = malloc ((size_t) nvalues * sizeof (uint32_t));
+  val = malloc ((size_t) nvalues * sizeof (double));
+  idx = malloc ((size_t) nvalues * sizeof (int));
+  if (pixlut && val && idx)
+    {
+      for (k = 0; k < nvalues; k++)
+        val[k] = first + k;
+      _giza_itf_idx_row (b->itf, b->itflut, val, nvalues, b->valMin, b->valMax,
+                         b->cimin, b->cimax, idx);
+      for (k = 0; k < nvalues; k++)
+        pixlut[k] = (b->transparent==1 && idx[k]==b->cimin) ? (b->lut[idx[k]] & 0x00ffffff)
+                                                            : b->lut[idx[k]];
+    }
+  else
+    {
+      free (pixlut);
+      pixlut = NULL;
+    }
+  free (val);
+  free (idx);
+  return pixlut;
+}
+
+/**
+ * Gets the range of indices images are coloured with and the packed
+ * pixels for them, filling lut[cimin..cimax]: the colour index range, or in
+ * continuous colour mode the colour table sampled at GIZA_CTAB_LUT_SIZE
+ * points from index zero. lut needs room for GIZA_CTAB_LUT_SIZE entries.
+ */
+void
+_giza_render_colours (int *cimin, int *cimax, uint32_t *lut)
+{
+  if (Dev[id].colourmode == GIZA_COLOUR_MODE_CONTINUOUS)
+    {
+      *cimin = 0;
+      *cimax = GIZA_CTAB_LUT_SIZE - 1;
+      memcpy (lut, _giza_colour_table_argb (), GIZA_CTAB_LUT_SIZE * sizeof (uint32_t));
+      return;
+    }
+  giza_get_colour_index_range (cimin, cimax);
+  _giza_colour_index_to_argb (*cimin, *cimax, lut);
+}
+
+/* rows of an image being counted into a histogram for its transfer function */
+typedef struct
+{
+  const giza_render_band_t *b;
+  double *row;
+  unsigned char *skip;
+  size_t *hist;               /* GIZA_ITF_LUT_SIZE per band */
+} giza_render_hist_t;
+
+/**
+ * Makes the table for the transfer function of the image described by b, if
+ * it uses one, returning table, or NULL if it does not or the table cannot
+ * be made. Histogram equalisation counts the values in the image that are
+ * not blank, in parallel bands, so needs b->data.
+ */
+const double *
+_giza_render_itf_table (const giza_render_band_t *b, int height, double *table)
+{
+  giza_render_hist_t h;
+  size_t *hist;
+  int nbands, band, k, ok;
+
+  if (!_giza_itf_uses_lut (b->itf))
+    return NULL;
+  if (b->itf != GIZA_ITF_HISTEQ)
+    return _giza_itf_lut (b->itf, NULL, table) ? table : NULL;
+  if (!b->data)
+    return NULL;
+
+  nbands = _giza_thread_bands (height, (GIZA_RENDER_BAND_PIXELS + b->width - 1)/b->width);
+  h.b = b;
+  h.row = malloc ((size_t) nbands * (size_t) b->width * sizeof (double));
+  h.skip = b->blank ? malloc ((size_t) nbands * (size_t) b->width) : NULL;
+  h.hist = calloc ((size_t) nbands * GIZA_ITF_LUT_SIZE, sizeof (size_t));
+  ok = (h.row && h.hist && (h.skip || !b->blank));
+  if (ok)
+    {
+      _giza_parallel_for (nbands, height, _giza_render_hist_band, &h);
+      hist = h.hist;
+      for (band = 1; band < nbands; band++)
+        for (k = 0; k < GIZA_ITF_LUT_SIZE; k++)
+          hist[k] += h.hist[(size_t) band * GIZA_ITF_LUT_SIZE + k];
+      ok = _giza_itf_lut (b->itf, hist, table);
+    }
+  free (h.row);
+  free (h.skip);
+  free (h.hist);
+  return ok ? table : NULL;
+}
+
+/* counts rows start..end-1 of the image into this band's histogram */
+static void
+_giza_render_hist_band (void *arg, int start, int end, int band)
+{
+  const giza_render_hist_t *h = (const giza_render_hist_t *) arg;
+  const giza_render_band_t *b = h->b;
+  double *val = h->row + (size_t) band * b->width;
+  unsigned char *skip = h->skip ? h->skip + (size_t) band * b->width : NULL;
+  size_t *hist = h->hist + (size_t) band * GIZA_ITF_LUT_SIZE;
+  double blank = 0.;
+  size_t offset, k;
+  int i, j;
+
+  if (b->blank)
+    blank = (b->type == GIZA_DATA_FLOAT) ? (float) b->blank->value : b->blank->value;
+
+  for (j = start; j < end; j++)
+    {
+      offset = (size_t) (b->j1 + j) * b->sizex + b->i1;
+      _giza_data_row (b->type, b->data, offset, b->width, val);
+      if (skip)
+        {
+          _giza_itf_blank_row (val, b->width, blank, skip);
+          if (b->blank->mask)
+            for (i = 0; i < b->width; i++)
+              {
+                k = offset + (size_t) i;
+                if (!(b->blank->mask[k >> 3] & (1 << (k & 7))))
+                  skip[i] = 1;
+              }
+        }
+      _giza_itf_hist_row (val, b->width, b->valMin, b->valMax, skip, hist);
+    }
+}
+
+/**
+ * Fills the pixmap: colour indices come from the row transfer function
+ * kernels and the pixels are looked up from a table of packed pixels for
+ * the colour index range. Large images are split into bands of rows
+ * coloured in parallel, which gives the same pixels as a single band.
+ * Returns 0 if memory could not be allocated.
+ */
+int
+_giza_render_pixmap (giza_render_band_t *b, int height)
+{
+  uint32_t lut[GIZA_CTAB_LUT_SIZE];
+  uint32_t *pixlut;
+  int nbands, ok;
+
+  _giza_render_colours (&b->cimin, &b->cimax, lut);
+  b->lut = lut;
+
+  nbands = _giza_thread_bands (height, (GIZA_RENDER_BAND_PIXELS + b->width - 1)/b->width);
+  pixlut = _giza_render_value_table (b, height);
+  b->pixlut = pixlut;
+  b->idx = NULL;
+  b->row = NULL;
+  b->blanked = NULL;
+  if (!pixlut)
+    {
+      b->idx = malloc ((size_t) nbands * (size_t) b->width * sizeof (int));
+      if (b->type != GIZA_DATA_DOUBLE && b->type != GIZA_DATA_FLOAT)
+        b->row = malloc ((size_t) nbands * (size_t) b->width * sizeof (double));
+    }
+  if (b->blank)
+    b->blanked = malloc ((size_t) nbands * (size_t) b->width);
+
+  ok = (pixlut || (b->idx && (b->row || b->type == GIZA_DATA_DOUBLE
+                                     || b->type == GIZA_DATA_FLOAT)))
+       && (b->blanked || !b->blank);
+  if (ok)
+    _giza_parallel_for (nbands, height, _giza_render_band, b);
+
+  free (pixlut);
+  free (b->idx);
+  free (b->row);
+  free (b->blanked);
+  return ok;
+}
+
 /**
  * Drawing: giza_render
  *
@@ -86,7 +552,7 @@ _giza_clip_to_window (void)
  *  -4 or GIZA_FILTER_NEAREST  :- Nearest-neighbour filtering
  *  -5 or GIZA_FILTER_BILINEAR :- Linear interpolation in two dimensions
  *
- * See Also: giza_set_colour_table
+ * See Also: giza_set_colour_table, giza_set_image_colour_mode
  */
 void
 giza_render (int sizex, int sizey, const double* data, int i1, int i2,
@@ -130,17 +596,38 @@ _giza_render (int sizex, int sizey, const double* data, int i1, int i2,
                    int j1, int j2, double valMin, double valMax, const double *affine,
               int transparent, int extend, int filter, const double* datalpha)
 {
+  cairo_matrix_t mat;
+
   if (!_giza_check_device_ready ("giza_render"))
     return;
 
+  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
+                     affine[4], affine[5]);
+  _giza_render_typed ("giza_render", GIZA_DATA_DOUBLE, sizex, sizey, data, i1, i2, j1, j2,
+                      valMin, valMax, &mat, transparent, extend, filter, datalpha, NULL);
+}
+
+/**
+ * Renders data of any of the GIZA_DATA_* types; the pixmap has the
+ * colours of the data at indices i1..i2, j1..j2, and mat maps it to world
+ * coordinates. Pixels that are blank as described by blank, if not NULL,
+ * are left out. Used by _giza_render, _giza_render_float, and the integer
+ * and blanked variants of giza_render.
+ */
+void
+_giza_render_typed (const char *caller, int type, int sizex, int sizey, const void *data,
+                    int i1, int i2, int j1, int j2, double valMin, double valMax,
+                    const cairo_matrix_t *mat, int transparent, int extend, int filter,
+                    const void *datalpha, const giza_render_blank_t *blank)
+{
   if (sizex < 1 || sizey < 1)
     {
-      _giza_warning ("giza_render", "Invalid array size, skipping render.");
+      _giza_warning (caller, "Invalid array size, skipping render.");
       return;
     }
   if (i1 < 0 || i2 < i1 || j1 < 0 || j2 < j1)
     {
-      _giza_warning ("giza_render", "Invalid index range, skipping render.");
+      _giza_warning (caller, "Invalid index range, skipping render.");
       return;
     }
   /* Clamp indices to array bounds to avoid OOB reads */
@@ -148,16 +635,14 @@ _giza_render (int sizex, int sizey, const double* data, int i1, int i2,
   if (j2 >= sizey) j2 = sizey - 1;
   if (i1 >= sizex || j1 >= sizey)
     {
-      _giza_warning ("giza_render", "Index range outside array bounds, skipping render.");
+      _giza_warning (caller, "Index range outside array bounds, skipping render.");
       return;
     }
 
   unsigned char *pixdata;
   cairo_format_t format = CAIRO_FORMAT_ARGB32;
   cairo_surface_t *pixmap;
-  cairo_matrix_t mat;
-  int stride, pixnum, width = i2 - i1 + 1, height = j2 - j1 + 1;
-  int cimin, cimax;
+  int stride, width = i2 - i1 + 1, height = j2 - j1 + 1;
 
   cairo_extend_t cairoextendtype;
   _giza_get_extend(extend,&cairoextendtype);
@@ -171,12 +656,81 @@ _giza_render (int sizex, int sizey, const double* data, int i1, int i2,
   int oldTrans = _giza_get_trans ();
   _giza_set_trans (GIZA_TRANS_WORLD);
 
+  /* what needs to be coloured */
+  giza_render_band_t band;
+  band.data = data;
+  band.alpha = (transparent==2) ? datalpha : NULL;
+  band.type = type;
+  band.sizex = sizex;
+  band.i1 = i1;
+  band.j1 = j1;
+  band.width = width;
+  band.itf = Dev[id].itf;
+  band.transparent = (transparent==2 && !datalpha) ? 0 : transparent;
+  band.valMin = valMin;
+  band.valMax = valMax;
+  band.blank = blank;
+
+  /* tables for transfer functions are made from the whole image, before it is culled */
+  double itflut[GIZA_ITF_LUT_SIZE];
+  band.itflut = _giza_render_itf_table (&band, height, itflut);
+
   cairo_save (Dev[id].context);
   _giza_clip_to_window ();
 
-  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
-                   affine[4], affine[5]);
-  cairo_transform (Dev[id].context, &mat);
+  cairo_transform (Dev[id].context, mat);
+
+  /* only colour the pixels that can reach the device, when zoomed in */
+  if (extend != GIZA_EXTEND_REPEAT && extend != GIZA_EXTEND_REFLECT)
+    {
+      double cx1, cy1, cx2, cy2;
+      int margin, ca, cb, ta, tb;
+
+      cairo_clip_extents (Dev[id].context, &cx1, &cy1, &cx2, &cy2);
+      margin = _giza_render_margin (filter, MAX(width, height));
+      if (isfinite (cx1) && isfinite (cy1) && isfinite (cx2) && isfinite (cy2))
+        {
+          ca = (int) MIN((double) width, MAX(0., floor (cx1) - margin));
+          cb = (int) MAX(-1., MIN(width - 1., ceil (cx2) - 1. + margin));
+          ta = (int) MIN((double) height, MAX(0., floor (cy1) - margin));
+          tb = (int) MAX(-1., MIN(height - 1., ceil (cy2) - 1. + margin));
+          /* padding beyond the image extends its true edge, so keep the
+           * nearest row and column even if the clip lies wholly past them */
+          if (extend == GIZA_EXTEND_PAD)
+            {
+              ca = MIN(ca, width - 1);
+              cb = MAX(cb, 0);
+              ta = MIN(ta, height - 1);
+              tb = MAX(tb, 0);
+            }
+          if (ca > cb || ta > tb)
+            {
+              cairo_restore (Dev[id].context);
+              _giza_set_trans (oldTrans);
+              giza_set_colour_index (oldCi);
+              return;
+            }
+          band.i1 += ca;
+          band.j1 += ta;
+          width = cb - ca + 1;
+          height = tb - ta + 1;
+          band.width = width;
+          cairo_translate (Dev[id].context, ca, ta);
+        }
+    }
+
+  /* reduce or magnify the data to the device resolution if requested;
+   * NaNs stay NaN when resampled, but a mask or blank value cannot be */
+  if (Dev[id].resample != GIZA_RESAMPLE_NONE &&
+      (!blank || (!blank->mask && isnan (blank->value))) &&
+      _giza_render_resampled (&band, height, extend, filter))
+    {
+      cairo_restore (Dev[id].context);
+      _giza_set_trans (oldTrans);
+      giza_set_colour_index (oldCi);
+      giza_flush_device ();
+      return;
+    }
 
   /* allocate data for the pixmap */
 #if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 6, 0)
@@ -185,63 +739,21 @@ _giza_render (int sizex, int sizey, const double* data, int i1, int i2,
   stride = 4*width;
 #endif
   pixdata = malloc ((size_t) stride * (size_t) height);
-  if (!pixdata)
+
+  band.stride = stride;
+  band.pixdata = pixdata;
+
+  /* colour each pixel in the pixmap */
+  if (!pixdata || !_giza_render_pixmap (&band, height))
     {
-      _giza_warning ("giza_render", "Allocation failed, skipping render.");
+      _giza_warning (caller, "Allocation failed, skipping render.");
+      free (pixdata);
       cairo_restore (Dev[id].context);
       _giza_set_trans (oldTrans);
       giza_set_colour_index (oldCi);
       return;
     }
 
-  /* colour each pixel in the pixmap */
-  int i, j;
-  giza_itf_idx_type itf_idx = giza_itf_idx[ Dev[id].itf ];
-
-  giza_get_colour_index_range(&cimin, &cimax);
-  pixnum = 0;
-  /* transparent if-statement is outside loop as optimisation */
-  if (transparent==2) {
-    if (!datalpha)
-      {
-        /* Fallback to opaque if alpha array not provided */
-        transparent = 0;
-      }
-  }
-  if (transparent==2) {
-    /* render each pixel, using transparent routine */
-    for (j = j1; j <= j2; j++)
-      {
-        for (i = i1; i <= i2; i++)
-         {
-           _giza_colour_pixel_index_alpha (pixdata, pixnum, itf_idx(data[j*sizex + i], valMin, valMax, cimin, cimax), datalpha[j*sizex + i]);
-           pixnum = pixnum + 1;
-         }
-      }
-  } else if (transparent==1) {
-    /* render each pixel, using transparent routine */
-    int idx;
-    for (j = j1; j <= j2; j++)
-      {
-        for (i = i1; i <= i2; i++)
-         {
-      idx = itf_idx(data[j*sizex + i], valMin, valMax, cimin, cimax);
-           _giza_colour_pixel_index_alpha (pixdata, pixnum, idx, idx==cimin ? 0. : 1.);
-           pixnum = pixnum + 1;
-         }
-      }
-  } else {
-    /* render each pixel, usual routine */
-    for (j = j1; j <= j2; j++)
-      {
-        for (i = i1; i <= i2; i++)
-         {
-           _giza_colour_pixel_index_alpha (pixdata, pixnum, itf_idx(data[j*sizex + i], valMin, valMax, cimin,cimax), 1.);
-           pixnum = pixnum + 1;
-         }
-      }
-  }
-
   /* create the cairo surface from the pixmap */
   pixmap = cairo_image_surface_create_for_data (pixdata, format,
                                           width, height, stride);
@@ -308,141 +820,178 @@ giza_render_alpha_float (int sizex, int sizey, const float* data, const float* a
 {
    _giza_render_float (sizex, sizey, data,i1,i2,j1,j2,valMin,valMax,affine,2,extend,filter,alpha);
 }
+
 /**
- *  _giza_render_float is the internal routine with the most general (and changeable) interface
- *  c.f. _giza_render
+ * Drawing: giza_render_blanked
+ *
+ * Synopsis: Same as giza_render, but leaves out blank pixels, which are
+ *           left fully transparent.
+ *
+ * Blank pixels are those whose data are NaN, equal to blank or, if mask
+ * is given, not marked as valid in the mask.
+ *
+ * Input:
+ *  -mask  :- Packed bits, one for each value in data: value k = i + j*sizex
+ *            is valid if bit (k % 8) of byte k/8 is set, counting from the
+ *            least significant bit. Can be NULL if all values are valid.
+ *  -blank :- Data equal to this are blank. Pass NaN to blank only NaNs.
+ *
+ * Blanked images with a mask, or with a blank value other than NaN, are
+ * not resampled (see giza_set_image_resample).
+ *
+ * See Also: giza_render, giza_render_transparent
  */
 void
-_giza_render_float (int sizex, int sizey, const float* data, int i1,
-                  int i2, int j1, int j2, float valMin, float valMax,
-                  const float *affine, int transparent, int extend, int filter, const float* datalpha)
+giza_render_blanked (int sizex, int sizey, const double* data, const unsigned char* mask,
+                     double blank, int i1, int i2, int j1, int j2, double valMin, double valMax,
+                     int extend, int filter, const double *affine)
 {
-  if (!_giza_check_device_ready ("giza_render_float"))
+  giza_render_blank_t b;
+  cairo_matrix_t mat;
+
+  if (!_giza_check_device_ready ("giza_render_blanked"))
     return;
 
-  if (sizex < 1 || sizey < 1)
-    {
-      _giza_warning ("giza_render_float",
-                  "Invalid array size, skipping render.");
-      return;
-    }
-  if (i1 < 0 || i2 < i1 || j1 < 0 || j2 < j1)
-    {
-      _giza_warning ("giza_render_float",
-                  "Invalid index range, skipping render.");
-      return;
-    }
-  /* Clamp indices to array bounds to avoid OOB reads */
-  if (i2 >= sizex) i2 = sizex - 1;
-  if (j2 >= sizey) j2 = sizey - 1;
-  if (i1 >= sizex || j1 >= sizey)
-    {
-      _giza_warning ("giza_render_float", "Index range outside array bounds, skipping render.");
-      return;
-    }
+  b.value = blank;
+  b.mask = mask;
+  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
+                     affine[4], affine[5]);
+  _giza_render_typed ("giza_render_blanked", GIZA_DATA_DOUBLE, sizex, sizey, data,
+                      i1, i2, j1, j2, valMin, valMax, &mat, 0, extend, filter, NULL, &b);
+}
 
-  unsigned char *pixdata;
-  cairo_format_t format = CAIRO_FORMAT_ARGB32;
-  cairo_surface_t *pixmap;
+/**
+ * Drawing: giza_render_blanked_float
+ *
+ * Synopsis: Same as giza_render_blanked but takes floats
+ *
+ * See Also: giza_render_blanked
+ */
+void
+giza_render_blanked_float (int sizex, int sizey, const float* data, const unsigned char* mask,
+                           float blank, int i1, int i2, int j1, int j2, float valMin, float valMax,
+                           int extend, int filter, const float *affine)
+{
+  giza_render_blank_t b;
   cairo_matrix_t mat;
-  int stride, pixnum, width = i2 - i1 + 1, height = j2 - j1 + 1;
-  int cimin, cimax;
 
-  cairo_extend_t cairoextendtype;
-  _giza_get_extend(extend,&cairoextendtype);
-
-  cairo_filter_t cairofiltertype;
-  _giza_get_filter(filter,&cairofiltertype);
+  if (!_giza_check_device_ready ("giza_render_blanked_float"))
+    return;
 
-  int oldCi;
-  giza_get_colour_index (&oldCi);
-  int oldTrans = _giza_get_trans ();
-  _giza_set_trans (GIZA_TRANS_WORLD);
+  b.value = blank;
+  b.mask = mask;
+  cairo_matrix_init (&mat, (double) affine[0], (double) affine[1],
+                     (double) affine[2], (double) affine[3],
+                     (double) affine[4], (double) affine[5]);
+  _giza_render_typed ("giza_render_blanked_float", GIZA_DATA_FLOAT, sizex, sizey, data,
+                      i1, i2, j1, j2, valMin, valMax, &mat, 0, extend, filter, NULL, &b);
+}
+/**
+ * Drawing: giza_render_u8
+ *
+ * Synopsis: Same functionality as giza_render but takes unsigned 8 bit integers.
+ *
+ * The data are mapped through the image transfer function without being
+ * copied: for large images the colour of each of the 256 possible values is
+ * worked out first, and the image is coloured by looking them up.
+ *
+ * See Also: giza_render, giza_render_u16, giza_render_i16, giza_render_i32
+ */
+void
+giza_render_u8 (int sizex, int sizey, const unsigned char* data, int i1, int i2,
+                int j1, int j2, double valMin, double valMax, int extend, int filter,
+                const double *affine)
+{
+  _giza_render_int ("giza_render_u8", GIZA_DATA_U8, sizex, sizey, data, i1, i2, j1, j2,
+                    valMin, valMax, extend, filter, affine);
+}
 
-  cairo_save (Dev[id].context);
-  _giza_clip_to_window ();
+/**
+ * Drawing: giza_render_u16
+ *
+ * Synopsis: Same functionality as giza_render but takes unsigned 16 bit integers.
+ *
+ * As for giza_render_u8, large images are coloured by looking up the
+ * colour of each of the 65536 possible values.
+ *
+ * See Also: giza_render, giza_render_u8
+ */
+void
+giza_render_u16 (int sizex, int sizey, const unsigned short* data, int i1, int i2,
+                 int j1, int j2, double valMin, double valMax, int extend, int filter,
+                 const double *affine)
+{
+  _giza_render_int ("giza_render_u16", GIZA_DATA_U16, sizex, sizey, data, i1, i2, j1, j2,
+                    valMin, valMax, extend, filter, affine);
+}
 
-  cairo_matrix_init (&mat, (double) affine[0], (double) affine[1],
-                   (double) affine[2], (double) affine[3],
-                   (double) affine[4], (double) affine[5]);
-  cairo_transform (Dev[id].context, &mat);
+/**
+ * Drawing: giza_render_i16
+ *
+ * Synopsis: Same functionality as giza_render but takes signed 16 bit integers.
+ *
+ * See Also: giza_render, giza_render_u16
+ */
+void
+giza_render_i16 (int sizex, int sizey, const short* data, int i1, int i2,
+                 int j1, int j2, double valMin, double valMax, int extend, int filter,
+                 const double *affine)
+{
+  _giza_render_int ("giza_render_i16", GIZA_DATA_I16, sizex, sizey, data, i1, i2, j1, j2,
+                    valMin, valMax, extend, filter, affine);
+}
 
-#if CAIRO_VERSION >= CAIRO_VERSION_ENCODE(1, 6, 0)
-  stride = cairo_format_stride_for_width (format, width);
-#else
-  stride = 4*width;
-#endif
-  pixdata = malloc (stride * height);
-  if (!pixdata)
-    {
-      _giza_warning ("giza_render_float", "Allocation failed, skipping render.");
-      cairo_restore (Dev[id].context);
-      _giza_set_trans (oldTrans);
-      giza_set_colour_index (oldCi);
-      return;
-    }
+/**
+ * Drawing: giza_render_i32
+ *
+ * Synopsis: Same functionality as giza_render but takes signed 32 bit integers.
+ *
+ * See Also: giza_render, giza_render_u16
+ */
+void
+giza_render_i32 (int sizex, int sizey, const int* data, int i1, int i2,
+                 int j1, int j2, double valMin, double valMax, int extend, int filter,
+                 const double *affine)
+{
+  _giza_render_int ("giza_render_i32", GIZA_DATA_I32, sizex, sizey, data, i1, i2, j1, j2,
+                    valMin, valMax, extend, filter, affine);
+}
 
-  int i, j;
-  giza_itf_idx_type_f itf_idx = giza_itf_idx_f[ Dev[id].itf ];
+static void
+_giza_render_int (const char *caller, int type, int sizex, int sizey, const void *data,
+                  int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine)
+{
+  cairo_matrix_t mat;
 
-  giza_get_colour_index_range(&cimin, &cimax);
-  pixnum = 0;
-  /* transparent if-statement is outside loop as optimisation */
-  if (transparent==2) {
-    if (!datalpha)
-      {
-        transparent = 0;
-      }
-  }
-  if (transparent==2) {
-    /* render each pixel, using transparent routine */
-    for (j = j1; j <= j2; j++)
-      {
-        for (i = i1; i <= i2; i++)
-         {
-           _giza_colour_pixel_index_alpha (pixdata, pixnum, itf_idx(data[j*sizex + i], valMin, valMax, cimin, cimax), datalpha[j*sizex + i]);
-           pixnum = pixnum + 1;
-         }
-      }
-  } else if (transparent==1) {
-    /* render each pixel, using transparent routine */
-      int idx;
-    for (j = j1; j <= j2; j++)
-      {
-        for (i = i1; i <= i2; i++)
-         {
-              idx = itf_idx(data[j*sizex + i], valMin, valMax, cimin, cimax);
-              _giza_colour_pixel_index_alpha (pixdata, pixnum, idx, idx==cimin ? 0. : 1.);
-              pixnum = pixnum + 1;
-         }
-      }
-  } else {
-    /* render each pixel, usual routine */
-    for (j = j1; j <= j2; j++)
-      {
-        for (i = i1; i <= i2; i++)
-         {
-              _giza_colour_pixel_index_alpha (pixdata, pixnum, itf_idx(data[j*sizex + i], valMin, valMax, cimin, cimax), 1);
-              pixnum = pixnum + 1;
-         }
-      }
-  }
+  if (!_giza_check_device_ready ((char *) caller))
+    return;
 
-  pixmap = cairo_image_surface_create_for_data (pixdata, format,
-                                          width, height, stride);
+  cairo_matrix_init (&mat, affine[0], affine[1], affine[2], affine[3],
+                     affine[4], affine[5]);
+  _giza_render_typed (caller, type, sizex, sizey, data, i1, i2, j1, j2,
+                      valMin, valMax, &mat, 0, extend, filter, NULL, NULL);
+}
 
-  cairo_set_source_surface (Dev[id].context, pixmap, 0, 0);
-  cairo_pattern_set_extend (cairo_get_source (Dev[id].context), cairoextendtype);
-  cairo_pattern_set_filter (cairo_get_source(Dev[id].context), cairofiltertype);
+/**
+ *  _giza_render_float is the internal routine with the most general (and changeable) interface
+ *  c.f. _giza_render
+ */
+void
+_giza_render_float (int sizex, int sizey, const float* data, int i1,
+                  int i2, int j1, int j2, float valMin, float valMax,
+                  const float *affine, int transparent, int extend, int filter, const float* datalpha)
+{
+  cairo_matrix_t mat;
 
-  cairo_paint (Dev[id].context);
+  if (!_giza_check_device_ready ("giza_render_float"))
+    return;
 
-  cairo_restore (Dev[id].context);
-  _giza_set_trans (oldTrans);
-  giza_set_colour_index (oldCi);
-  cairo_surface_destroy (pixmap);
-  free (pixdata);
-  giza_flush_device ();
+  cairo_matrix_init (&mat, (double) affine[0], (double) affine[1],
+                     (double) affine[2], (double) affine[3],
+                     (double) affine[4], (double) affine[5]);
+  _giza_render_typed ("giza_render_float", GIZA_DATA_FLOAT, sizex, sizey, data, i1, i2, j1, j2,
+                      valMin, valMax, &mat, transparent, extend, filter, datalpha, NULL);
 }
 
 /**
@@ -605,29 +1154,6 @@ _giza_colour_pixel_index (unsigned char *array, int pixNum, int ci)
   array[pixNum * 4 + 0] = (unsigned char) (b * 255.);
 }
 
-/**
- * Sets the rgb for a given pixel, given the colour index, but allow
- * override of alpha
- *
- * Input:
- *  -array  :- the array in which to store the colour.
- *  -pixnum :- the pixel to be coloured.
- *  -ci     :- the colour index with which to colour the pixel.
- *  -alpha  :- the alpha to use, override what's in the colour table
- */
-static void
-_giza_colour_pixel_index_alpha (unsigned char *array, int pixNum, int ci, double alpha)
-{
-  double r, g, b,dummy;
-  giza_get_colour_representation_alpha(ci, &r, &g, &b, &dummy);
-  /* set the alpha */
-  array[pixNum * 4 + 3] = (unsigned char) (alpha * 255.);
-  /* set the red, green, and blue */
-  array[pixNum * 4 + 2] = (unsigned char) (r * 255.);
-  array[pixNum * 4 + 1] = (unsigned char) (g * 255.);
-  array[pixNum * 4 + 0] = (unsigned char) (b * 255.);
-}
-
 /**
  * Drawing: giza_draw_pixels
  *
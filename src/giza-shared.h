@@ -92,4 +92,26 @@
 #define GIZA_FILTER_BEST 3
 #define GIZA_FILTER_NEAREST 4
 #define GIZA_FILTER_BILINEAR 5
-#define GIZA_FILTER_GAUSSIAN 6
\ No newline at end of file
+#define GIZA_FILTER_GAUSSIAN 6
+
+#define GIZA_RESAMPLE_NONE 0
+#define GIZA_RESAMPLE_NEAREST 1
+#define GIZA_RESAMPLE_MEAN 2
+#define GIZA_RESAMPLE_MIN 3
+#define GIZA_RESAMPLE_MAX 4
+
+#define GIZA_DATA_DOUBLE 0
+#define GIZA_DATA_FLOAT 1
+#define GIZA_DATA_U8 2
+#define GIZA_DATA_U16 3
+#define GIZA_DATA_I16 4
+#define GIZA_DATA_I32 5
+
+#define GIZA_COLOUR_MODE_INDEXED 0
+#define GIZA_COLOUR_MODE_CONTINUOUS 1
+
+#define GIZA_ITF_LINEAR 0
+#define GIZA_ITF_LOG 1
+#define GIZA_ITF_SQRT 2
+#define GIZA_ITF_ASINH 3
+#define GIZA_ITF_HISTEQ 4
\ No newline at end of file
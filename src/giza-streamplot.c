@@ -23,6 +23,7 @@
 #include "giza-io-private.h"
 #include "giza-private.h"
 #include "giza-stroke-private.h"
+#include "giza-threads-private.h"
 #include "giza-transforms-private.h"
 #include <giza.h>
 #include <math.h>
@@ -40,15 +41,17 @@
 /* noisy/null fields can loop inside one occupancy cell; stop after a few steps */
 #define STREAM_MAX_SAME_CELL 4
 
+/* seeds traced speculatively per thread before they are committed in order */
+#define STREAM_BATCH 4
+
 typedef struct
 {
-  int n, m, i1, i2, j1, j2, nx, ny;
-  const double *u;
-  const double *v;
-  double blank;
+  int i1, i2, j1, j2, nx, ny;
+  float *uv;                  /* u,v interleaved over i1..i2, j1..j2 */
+  unsigned char *blanked;     /* one bit per point of uv, set if blank */
   int mask_nx, mask_ny;
   unsigned char *mask;
-  unsigned char *cur;
+  double minlength, maxlength;
   cairo_matrix_t mat;
 } giza_stream_t;
 
@@ -58,23 +61,54 @@ typedef struct
   double d2;
 } giza_seed_t;
 
-static int _giza_stream_blank (const giza_stream_t *s, int i, int j);
+/* scratch for tracing one seed, one per thread */
+typedef struct
+{
+  double *xback, *yback, *xfwd, *yfwd;
+  unsigned char *cur;
+} giza_stream_work_t;
+
+/* a traced streamline, waiting to be committed to the mask */
+typedef struct
+{
+  int mx, my;
+  double *x, *y;
+  int npts, kept;
+  int *occ;
+  int nocc;
+} giza_stream_line_t;
+
+typedef struct
+{
+  const giza_stream_t *s;
+  giza_stream_work_t *work;
+  giza_stream_line_t *lines;
+} giza_stream_batch_t;
+
+static int _giza_stream_pack (giza_stream_t *s, int n, int type,
+                              const void *u, const void *v, double blank);
+static int _giza_stream_blank (const giza_stream_t *s, int k);
 static int _giza_stream_sample (const giza_stream_t *s, double x, double y,
                                 double *uout, double *vout);
 static int _giza_stream_in_mask (const giza_stream_t *s, double x, double y,
                                  int *mx, int *my);
 static int _giza_seed_cmp (const void *a, const void *b);
-static int _giza_stream_integrate (giza_stream_t *s, double x0, double y0,
-                                   int direction, double maxlength,
+static int _giza_stream_integrate (const giza_stream_t *s, unsigned char *cur,
+                                   double x0, double y0, int direction,
                                    double *xpts, double *ypts, int *npts,
                                    int *occ, int *nocc, int noccmax);
+static void _giza_stream_trace (const giza_stream_t *s, giza_stream_work_t *w,
+                                giza_stream_line_t *line);
+static void _giza_stream_trace_band (void *arg, int start, int end, int band);
+static int _giza_stream_conflict (const giza_stream_line_t *line,
+                                  const unsigned char *fresh);
 static int _giza_stream_arrow_index (const double *xw, const double *yw,
                                      int npts, double x0, double y0);
 static int _giza_stream_add_line (giza_stream_t *s, const double *xg,
                                   const double *yg, int npts, double *xa,
                                   double *ya, double *xb, double *yb);
-static void _giza_streamplot_core (int n, int m, const double *u,
-                                   const double *v, int i1, int i2, int j1,
+static void _giza_streamplot_core (int n, int m, int type, const void *u,
+                                   const void *v, int i1, int i2, int j1,
                                    int j2, double density, const double *affine,
                                    double blank);
 
@@ -83,7 +117,8 @@ static void _giza_streamplot_core (int n, int m, const double *u,
  *
  * Synopsis: Plot evenly-spaced streamlines of a 2D vector field.
  * Trajectories are integrated with RK2 on the supplied regular grid
- * and spaced using an occupancy mask.
+ * and spaced using an occupancy mask. The field is interpolated in
+ * single precision.
  *
  * Input:
  *  -n        :- The dimensions of data in the x-direction
@@ -106,7 +141,8 @@ giza_streamplot (int n, int m, const double *u, const double *v,
   if (!_giza_check_device_ready ("giza_streamplot"))
     return;
 
-  _giza_streamplot_core (n, m, u, v, i1, i2, j1, j2, density, affine, blank);
+  _giza_streamplot_core (n, m, GIZA_DATA_DOUBLE, u, v, i1, i2, j1, j2,
+                         density, affine, blank);
 }
 
 /**
@@ -121,8 +157,8 @@ giza_streamplot_float (int n, int m, const float *u, const float *v,
                        int i1, int i2, int j1, int j2, float density,
                        const float *affine, float blank)
 {
-  size_t np, i;
-  double *ud, *vd, affd[6];
+  double affd[6];
+  int i;
 
   if (!_giza_check_device_ready ("giza_streamplot"))
     return;
@@ -130,50 +166,41 @@ giza_streamplot_float (int n, int m, const float *u, const float *v,
   if (n <= 0 || m <= 0)
     return;
 
-  np = (size_t) n * (size_t) m;
-  ud = malloc (np * sizeof (double));
-  vd = malloc (np * sizeof (double));
-  if (ud == NULL || vd == NULL)
-    {
-      _giza_error ("giza_streamplot", "memory allocation failed");
-      free (ud);
-      free (vd);
-      return;
-    }
-
-  for (i = 0; i < np; i++)
-    {
-      ud[i] = (double) u[i];
-      vd[i] = (double) v[i];
-    }
   for (i = 0; i < 6; i++)
     affd[i] = (double) affine[i];
 
-  _giza_streamplot_core (n, m, ud, vd, i1, i2, j1, j2, (double) density,
-                         affd, (double) blank);
-
-  free (ud);
-  free (vd);
+  _giza_streamplot_core (n, m, GIZA_DATA_FLOAT, u, v, i1, i2, j1, j2,
+                         (double) density, affd, (double) blank);
 }
 
 /*
  * Build an occupancy mask, seed streamlines from the centre outward,
  * integrate each candidate in both directions, and draw those that
  * exceed the minimum length.
+ *
+ * With several threads, the next few seeds not yet covered are traced at
+ * once against the mask as it stands, then committed in seed order. A
+ * line that entered a cell taken by a line committed before it in the
+ * same batch is traced again, so the lines drawn do not depend on the
+ * number of threads.
  */
 static void
-_giza_streamplot_core (int n, int m, const double *u, const double *v,
+_giza_streamplot_core (int n, int m, int type, const void *u, const void *v,
                        int i1, int i2, int j1, int j2, double density,
                        const double *affine, double blank)
 {
   giza_stream_t s;
   giza_seed_t *seeds;
-  int mx, my, nback, nfwd, ntot, i, nseed, iseed, nocc, oldBuf, narrow, oldTrans;
-  double x0, y0, minlength, maxlength, length, cx, cy, dx, dy;
-  double *xback, *yback, *xfwd, *yfwd, *xline, *yline;
+  giza_stream_work_t *work;
+  giza_stream_line_t *lines, *line;
+  giza_stream_batch_t batch;
+  int mx, my, i, c, nseed, iseed, nline, nslot, nbands, oldBuf, narrow, oldTrans;
+  double cx, cy, dx, dy;
+  double *wbuf, *lbuf;
   double *ax1, *ay1, *ax2, *ay2;
-  int *occ;
-  size_t nbuf;
+  unsigned char *cur, *fresh;
+  int *locc;
+  size_t nbuf, ncell;
 
   if (i1 < 0 || i2 >= n || i1 > i2)
     {
@@ -192,71 +219,84 @@ _giza_streamplot_core (int n, int m, const double *u, const double *v,
   if (density > STREAM_DENSITY_MAX)
     density = STREAM_DENSITY_MAX;
 
-  s.n = n;
-  s.m = m;
   s.i1 = i1;
   s.i2 = i2;
   s.j1 = j1;
   s.j2 = j2;
   s.nx = i2 - i1 + 1;
   s.ny = j2 - j1 + 1;
-  s.u = u;
-  s.v = v;
-  s.blank = blank;
   s.mask_nx = MAX (1, (int) (STREAM_MASK_BASE * density + 0.5));
   s.mask_ny = MAX (1, (int) (STREAM_MASK_BASE * density + 0.5));
   cairo_matrix_init (&s.mat, affine[0], affine[1], affine[2], affine[3],
                      affine[4], affine[5]);
-
-  s.mask = calloc ((size_t) s.mask_nx * (size_t) s.mask_ny, 1);
-  s.cur = calloc ((size_t) s.mask_nx * (size_t) s.mask_ny, 1);
-  seeds = malloc ((size_t) s.mask_nx * (size_t) s.mask_ny * sizeof (giza_seed_t));
-  if (s.mask == NULL || s.cur == NULL || seeds == NULL)
+  ncell = (size_t) s.mask_nx * (size_t) s.mask_ny;
+  if (!_giza_stream_pack (&s, n, type, u, v, blank))
     {
       _giza_error ("giza_streamplot", "memory allocation failed");
-      free (s.mask);
-      free (s.cur);
-      free (seeds);
       return;
     }
 
+  /* keep short closed loops around small islands; reject only tiny stubs */
+  s.minlength = 2.0 * (double) s.nx / (double) s.mask_nx;
+  s.maxlength = STREAM_MAXLENGTH_FRAC * (double) MAX (s.nx, s.ny);
+
+  nbands = _giza_thread_bands ((int) ncell, STREAM_BATCH);
+  nslot = (nbands > 1) ? nbands * STREAM_BATCH : 1;
   nbuf = (size_t) STREAM_MAX_PTS;
-  xback = malloc (nbuf * sizeof (double));
-  yback = malloc (nbuf * sizeof (double));
-  xfwd = malloc (nbuf * sizeof (double));
-  yfwd = malloc (nbuf * sizeof (double));
-  xline = malloc (nbuf * sizeof (double));
-  yline = malloc (nbuf * sizeof (double));
-  occ = malloc (nbuf * sizeof (int));
-  ax1 = malloc ((size_t) s.mask_nx * (size_t) s.mask_ny * sizeof (double));
-  ay1 = malloc ((size_t) s.mask_nx * (size_t) s.mask_ny * sizeof (double));
-  ax2 = malloc ((size_t) s.mask_nx * (size_t) s.mask_ny * sizeof (double));
-  ay2 = malloc ((size_t) s.mask_nx * (size_t) s.mask_ny * sizeof (double));
-  if (xback == NULL || yback == NULL || xfwd == NULL || yfwd == NULL
-      || xline == NULL || yline == NULL || occ == NULL
-      || ax1 == NULL || ay1 == NULL || ax2 == NULL || ay2 == NULL)
+
+  s.mask = calloc (ncell, 1);
+  fresh = calloc (ncell, 1);
+  cur = calloc ((size_t) nbands * ncell, 1);
+  seeds = malloc (ncell * sizeof (giza_seed_t));
+  work = malloc ((size_t) nbands * sizeof (giza_stream_work_t));
+  lines = malloc ((size_t) nslot * sizeof (giza_stream_line_t));
+  wbuf = malloc ((size_t) nbands * 4 * nbuf * sizeof (double));
+  lbuf = malloc ((size_t) nslot * 2 * nbuf * sizeof (double));
+  locc = malloc ((size_t) nslot * nbuf * sizeof (int));
+  ax1 = malloc (ncell * sizeof (double));
+  ay1 = malloc (ncell * sizeof (double));
+  ax2 = malloc (ncell * sizeof (double));
+  ay2 = malloc (ncell * sizeof (double));
+  if (s.mask == NULL || fresh == NULL || cur == NULL || seeds == NULL
+      || work == NULL || lines == NULL || wbuf == NULL || lbuf == NULL
+      || locc == NULL || ax1 == NULL || ay1 == NULL || ax2 == NULL || ay2 == NULL)
     {
       _giza_error ("giza_streamplot", "memory allocation failed");
-      free (xback);
-      free (yback);
-      free (xfwd);
-      free (yfwd);
-      free (xline);
-      free (yline);
-      free (occ);
+      free (s.uv);
+      free (s.blanked);
+      free (s.mask);
+      free (fresh);
+      free (cur);
+      free (seeds);
+      free (work);
+      free (lines);
+      free (wbuf);
+      free (lbuf);
+      free (locc);
       free (ax1);
       free (ay1);
       free (ax2);
       free (ay2);
-      free (s.mask);
-      free (s.cur);
-      free (seeds);
       return;
     }
 
-  /* keep short closed loops around small islands; reject only tiny stubs */
-  minlength = 2.0 * (double) s.nx / (double) s.mask_nx;
-  maxlength = STREAM_MAXLENGTH_FRAC * (double) MAX (s.nx, s.ny);
+  for (i = 0; i < nbands; i++)
+    {
+      work[i].xback = wbuf + (size_t) (4 * i) * nbuf;
+      work[i].yback = wbuf + (size_t) (4 * i + 1) * nbuf;
+      work[i].xfwd = wbuf + (size_t) (4 * i + 2) * nbuf;
+      work[i].yfwd = wbuf + (size_t) (4 * i + 3) * nbuf;
+      work[i].cur = cur + (size_t) i * ncell;
+    }
+  for (c = 0; c < nslot; c++)
+    {
+      lines[c].x = lbuf + (size_t) (2 * c) * nbuf;
+      lines[c].y = lbuf + (size_t) (2 * c + 1) * nbuf;
+      lines[c].occ = locc + (size_t) c * nbuf;
+    }
+  batch.s = &s;
+  batch.work = work;
+  batch.lines = lines;
 
   /* seed from the centre outward so top/bottom (and left/right) are equivalent */
   cx = 0.5 * (double) (s.mask_nx - 1);
@@ -284,77 +324,62 @@ _giza_streamplot_core (int n, int m, const double *u, const double *v,
   _giza_set_trans (GIZA_TRANS_WORLD);
   narrow = 0;
 
-  for (iseed = 0; iseed < nseed; iseed++)
+  iseed = 0;
+  while (iseed < nseed)
     {
-      mx = seeds[iseed].mx;
-      my = seeds[iseed].my;
-      if (s.mask[my * s.mask_nx + mx])
-        continue;
-
-      x0 = (double) i1 + ((mx + 0.5) / (double) s.mask_nx) * (double) s.nx - 0.5;
-      y0 = (double) j1 + ((my + 0.5) / (double) s.mask_ny) * (double) s.ny - 0.5;
-      if (x0 < i1)
-        x0 = (double) i1;
-      if (x0 > i2)
-        x0 = (double) i2;
-      if (y0 < j1)
-        y0 = (double) j1;
-      if (y0 > j2)
-        y0 = (double) j2;
-
-      nocc = 0;
-      nback = 0;
-      nfwd = 0;
-      _giza_stream_integrate (&s, x0, y0, -1, maxlength,
-                              xback, yback, &nback, occ, &nocc, STREAM_MAX_PTS);
-      _giza_stream_integrate (&s, x0, y0, +1, maxlength,
-                              xfwd, yfwd, &nfwd, occ, &nocc, STREAM_MAX_PTS);
-
-      /* stitch backward (reversed) then forward, without duplicating the seed */
-      ntot = 0;
-      for (i = nback - 1; i >= 1; i--)
+      /* the next seeds not already covered by a line */
+      nline = 0;
+      for (; iseed < nseed && nline < nslot; iseed++)
         {
-          xline[ntot] = xback[i];
-          yline[ntot] = yback[i];
-          ntot++;
+          mx = seeds[iseed].mx;
+          my = seeds[iseed].my;
+          if (s.mask[my * s.mask_nx + mx])
+            continue;
+          lines[nline].mx = mx;
+          lines[nline].my = my;
+          nline++;
         }
-      if (nfwd > 0)
+      if (nline == 0)
+        break;
+
+      if (nline > 1)
+        _giza_parallel_for (MIN (nbands, nline), nline, _giza_stream_trace_band, &batch);
+      else
+        _giza_stream_trace (&s, &work[0], &lines[0]);
+
+      for (c = 0; c < nline; c++)
         {
-          for (i = 0; i < nfwd && ntot < STREAM_MAX_PTS; i++)
+          line = &lines[c];
+          if (s.mask[line->my * s.mask_nx + line->mx])
             {
-              xline[ntot] = xfwd[i];
-              yline[ntot] = yfwd[i];
-              ntot++;
+              line->kept = 0;
+              continue;
             }
-        }
-      else if (nback > 0)
-        {
-          xline[ntot] = xback[0];
-          yline[ntot] = yback[0];
-          ntot++;
-        }
+          if (_giza_stream_conflict (line, fresh))
+            _giza_stream_trace (&s, &work[0], line);
+          if (!line->kept)
+            continue;
 
-      length = 0.;
-      for (i = 1; i < ntot; i++)
-        {
-          length += hypot (xline[i] - xline[i - 1],
-                           yline[i] - yline[i - 1]);
-        }
-      if (ntot >= 2 && length >= minlength)
-        {
           /* only occupy the mask once the line is kept, so rejected
            * stubs do not leave holes */
-          for (i = 0; i < nocc; i++)
-            s.mask[occ[i]] = 1;
-          if (_giza_stream_add_line (&s, xline, yline, ntot,
+          for (i = 0; i < line->nocc; i++)
+            {
+              s.mask[line->occ[i]] = 1;
+              fresh[line->occ[i]] = 1;
+            }
+          if (_giza_stream_add_line (&s, line->x, line->y, line->npts,
                                      &ax1[narrow], &ay1[narrow],
                                      &ax2[narrow], &ay2[narrow]))
             narrow++;
         }
 
-      /* clear per-trajectory markers for the next seed attempt */
-      for (i = 0; i < nocc; i++)
-        s.cur[occ[i]] = 0;
+      /* the next batch is traced against everything committed so far */
+      for (c = 0; c < nline; c++)
+        {
+          if (lines[c].kept)
+            for (i = 0; i < lines[c].nocc; i++)
+              fresh[lines[c].occ[i]] = 0;
+        }
     }
 
   _giza_stroke ();
@@ -366,20 +391,21 @@ _giza_streamplot_core (int n, int m, const double *u, const double *v,
     giza_end_buffer ();
 
   giza_flush_device ();
-  free (xback);
-  free (yback);
-  free (xfwd);
-  free (yfwd);
-  free (xline);
-  free (yline);
-  free (occ);
+  free (s.uv);
+  free (s.blanked);
+  free (s.mask);
+  free (fresh);
+  free (cur);
+  free (seeds);
+  free (work);
+  free (lines);
+  free (wbuf);
+  free (lbuf);
+  free (locc);
   free (ax1);
   free (ay1);
   free (ax2);
   free (ay2);
-  free (s.mask);
-  free (s.cur);
-  free (seeds);
 }
 
 /**
@@ -409,28 +435,82 @@ _giza_seed_cmp (const void *a, const void *b)
   return pa->my - pb->my;
 }
 
+/**
+ * Internal: _giza_stream_pack
+ *
+ * Synopsis: Copy the i1..i2, j1..j2 part of the field into one buffer of
+ * interleaved single precision (u,v) pairs and flag the points where both
+ * components equal the blank sentinel, so that each step of the
+ * integrator reads a corner from one place and tests one bit.
+ *
+ * Input:
+ *  -s     :- Streamplot context with the index ranges set; uv and
+ *            blanked are allocated here
+ *  -n     :- The dimensions of data in the x-direction
+ *  -type  :- GIZA_DATA_DOUBLE or GIZA_DATA_FLOAT
+ *  -u, v  :- The x- and y-components of the vector field
+ *  -blank :- Value of u and v that marks an empty cell
+ *
+ * Returns: 1 on success, 0 if memory could not be allocated
+ */
+static int
+_giza_stream_pack (giza_stream_t *s, int n, int type, const void *u,
+                   const void *v, double blank)
+{
+  size_t np, k, src;
+  double ui, vi;
+  int i, j;
+
+  np = (size_t) s->nx * (size_t) s->ny;
+  s->uv = malloc (2 * np * sizeof (float));
+  s->blanked = calloc ((np + 7) / 8, 1);
+  if (s->uv == NULL || s->blanked == NULL)
+    {
+      free (s->uv);
+      free (s->blanked);
+      return 0;
+    }
+
+  k = 0;
+  for (j = s->j1; j <= s->j2; j++)
+    {
+      src = (size_t) j * (size_t) n + (size_t) s->i1;
+      for (i = 0; i < s->nx; i++, k++, src++)
+        {
+          if (type == GIZA_DATA_FLOAT)
+            {
+              ui = ((const float *) u)[src];
+              vi = ((const float *) v)[src];
+            }
+          else
+            {
+              ui = ((const double *) u)[src];
+              vi = ((const double *) v)[src];
+            }
+          s->uv[2 * k] = (float) ui;
+          s->uv[2 * k + 1] = (float) vi;
+          if (_giza_equal (ui, blank) && _giza_equal (vi, blank))
+            s->blanked[k >> 3] |= (unsigned char) (1 << (k & 7));
+        }
+    }
+  return 1;
+}
+
 /**
  * Internal: _giza_stream_blank
  *
- * Synopsis: Return 1 if grid cell (i,j) is outside the plot range or both
- * components equal the blank sentinel.
+ * Synopsis: Return 1 if point k of the packed field is blank.
  *
  * Input:
- *  -s   :- Streamplot context (grid bounds, u/v arrays, blank value)
- *  -i,j :- Grid indices
+ *  -s :- Streamplot context (packed field)
+ *  -k :- Index of the point, (j - j1)*nx + (i - i1)
  *
  * Returns: 1 if blank/unusable, 0 otherwise
  */
 static int
-_giza_stream_blank (const giza_stream_t *s, int i, int j)
+_giza_stream_blank (const giza_stream_t *s, int k)
 {
-  double ui, vi;
-
-  if (i < s->i1 || i > s->i2 || j < s->j1 || j > s->j2)
-    return 1;
-  ui = s->u[j * s->n + i];
-  vi = s->v[j * s->n + i];
-  return (_giza_equal (ui, s->blank) && _giza_equal (vi, s->blank));
+  return (s->blanked[k >> 3] >> (k & 7)) & 1;
 }
 
 /**
@@ -450,8 +530,9 @@ static int
 _giza_stream_sample (const giza_stream_t *s, double x, double y,
                      double *uout, double *vout)
 {
-  int i0, j0, i1, j1;
+  int i0, j0, k, di, dj;
   double tx, ty, u00, u10, u01, u11, v00, v10, v01, v11;
+  const float *p;
 
   if (x < s->i1 || x > s->i2 || y < s->j1 || y > s->j2)
     return 0;
@@ -466,15 +547,13 @@ _giza_stream_sample (const giza_stream_t *s, double x, double y,
     i0 = s->i2;
   if (j0 > s->j2)
     j0 = s->j2;
-  i1 = i0 + 1;
-  j1 = j0 + 1;
-  if (i1 > s->i2)
-    i1 = s->i2;
-  if (j1 > s->j2)
-    j1 = s->j2;
-
-  if (_giza_stream_blank (s, i0, j0) || _giza_stream_blank (s, i1, j0)
-      || _giza_stream_blank (s, i0, j1) || _giza_stream_blank (s, i1, j1))
+  /* offsets to the corners at i0+1 and j0+1, clamped to the range */
+  di = (i0 < s->i2) ? 1 : 0;
+  dj = (j0 < s->j2) ? s->nx : 0;
+
+  k = (j0 - s->j1) * s->nx + (i0 - s->i1);
+  if (_giza_stream_blank (s, k) || _giza_stream_blank (s, k + di)
+      || _giza_stream_blank (s, k + dj) || _giza_stream_blank (s, k + di + dj))
     return 0;
 
   tx = x - (double) i0;
@@ -488,14 +567,15 @@ _giza_stream_sample (const giza_stream_t *s, double x, double y,
   if (ty > 1.)
     ty = 1.;
 
-  u00 = s->u[j0 * s->n + i0];
-  u10 = s->u[j0 * s->n + i1];
-  u01 = s->u[j1 * s->n + i0];
-  u11 = s->u[j1 * s->n + i1];
-  v00 = s->v[j0 * s->n + i0];
-  v10 = s->v[j0 * s->n + i1];
-  v01 = s->v[j1 * s->n + i0];
-  v11 = s->v[j1 * s->n + i1];
+  p = s->uv + 2 * (size_t) k;
+  u00 = p[0];
+  v00 = p[1];
+  u10 = p[2 * di];
+  v10 = p[2 * di + 1];
+  u01 = p[2 * dj];
+  v01 = p[2 * dj + 1];
+  u11 = p[2 * (di + dj)];
+  v11 = p[2 * (di + dj) + 1];
 
   *uout = (1. - tx) * (1. - ty) * u00 + tx * (1. - ty) * u10
           + (1. - tx) * ty * u01 + tx * ty * u11;
@@ -541,10 +621,10 @@ _giza_stream_in_mask (const giza_stream_t *s, double x, double y,
  * along the given direction, tracking occupancy cells in occ[] and cur[].
  *
  * Input:
- *  -s          :- Streamplot context
+ *  -s          :- Streamplot context (mask read only)
+ *  -cur        :- Mask cells visited on this trajectory so far
  *  -x0, y0     :- Starting position in grid coordinates
  *  -direction  :- +1 forward or -1 backward along the field
- *  -maxlength  :- Maximum arc length in grid units
  *  -xpts, ypts :- Output trajectory coordinates
  *  -npts       :- Number of points written (updated)
  *  -occ, nocc  :- Mask cells visited on this trajectory
@@ -553,9 +633,10 @@ _giza_stream_in_mask (const giza_stream_t *s, double x, double y,
  * Returns: final npts value
  */
 static int
-_giza_stream_integrate (giza_stream_t *s, double x0, double y0, int direction,
-                        double maxlength, double *xpts, double *ypts,
-                        int *npts, int *occ, int *nocc, int noccmax)
+_giza_stream_integrate (const giza_stream_t *s, unsigned char *cur,
+                        double x0, double y0, int direction,
+                        double *xpts, double *ypts, int *npts,
+                        int *occ, int *nocc, int noccmax)
 {
   double x, y, u, v, speed, k1x, k1y, k2x, k2y, length;
   double ds, maxds, dsmin, error, dx1, dy1, dx2, dy2, nx, ny;
@@ -586,7 +667,7 @@ _giza_stream_integrate (giza_stream_t *s, double x0, double y0, int direction,
   nreject = 0;
   nsame = 0;
 
-  while (*npts < STREAM_MAX_PTS && length < maxlength)
+  while (*npts < STREAM_MAX_PTS && length < s->maxlength)
     {
       if (!_giza_stream_sample (s, x, y, &u, &v))
         break;
@@ -600,11 +681,11 @@ _giza_stream_integrate (giza_stream_t *s, double x0, double y0, int direction,
         {
           /* stop on a cell already used by this trajectory or a previous
            * line, otherwise closed orbits retrace themselves until maxlength */
-          if (*npts > 0 && (s->mask[k] || s->cur[k]))
+          if (*npts > 0 && (s->mask[k] || cur[k]))
             break;
-          if (!s->cur[k] && *nocc < noccmax)
+          if (!cur[k] && *nocc < noccmax)
             {
-              s->cur[k] = 1;
+              cur[k] = 1;
               occ[(*nocc)++] = k;
             }
           mxprev = mx;
@@ -673,6 +754,126 @@ _giza_stream_integrate (giza_stream_t *s, double x0, double y0, int direction,
   return *npts;
 }
 
+/**
+ * Internal: _giza_stream_trace
+ *
+ * Synopsis: Integrate the streamline through a seed in both directions
+ * against the current occupancy mask, without changing the mask.
+ *
+ * Input:
+ *  -s    :- Streamplot context
+ *  -w    :- Scratch buffers of the calling thread
+ *  -line :- Seed cell on input; the stitched line, the mask cells it
+ *           visited and whether it is long enough to keep on output
+ */
+static void
+_giza_stream_trace (const giza_stream_t *s, giza_stream_work_t *w,
+                    giza_stream_line_t *line)
+{
+  int nback, nfwd, ntot, i;
+  double x0, y0, length;
+
+  x0 = (double) s->i1 + ((line->mx + 0.5) / (double) s->mask_nx) * (double) s->nx - 0.5;
+  y0 = (double) s->j1 + ((line->my + 0.5) / (double) s->mask_ny) * (double) s->ny - 0.5;
+  if (x0 < s->i1)
+    x0 = (double) s->i1;
+  if (x0 > s->i2)
+    x0 = (double) s->i2;
+  if (y0 < s->j1)
+    y0 = (double) s->j1;
+  if (y0 > s->j2)
+    y0 = (double) s->j2;
+
+  line->nocc = 0;
+  nback = 0;
+  nfwd = 0;
+  _giza_stream_integrate (s, w->cur, x0, y0, -1, w->xback, w->yback, &nback,
+                          line->occ, &line->nocc, STREAM_MAX_PTS);
+  _giza_stream_integrate (s, w->cur, x0, y0, +1, w->xfwd, w->yfwd, &nfwd,
+                          line->occ, &line->nocc, STREAM_MAX_PTS);
+
+  /* stitch backward (reversed) then forward, without duplicating the seed */
+  ntot = 0;
+  for (i = nback - 1; i >= 1; i--)
+    {
+      line->x[ntot] = w->xback[i];
+      line->y[ntot] = w->yback[i];
+      ntot++;
+    }
+  if (nfwd > 0)
+    {
+      for (i = 0; i < nfwd && ntot < STREAM_MAX_PTS; i++)
+        {
+          line->x[ntot] = w->xfwd[i];
+          line->y[ntot] = w->yfwd[i];
+          ntot++;
+        }
+    }
+  else if (nback > 0)
+    {
+      line->x[ntot] = w->xback[0];
+      line->y[ntot] = w->yback[0];
+      ntot++;
+    }
+
+  length = 0.;
+  for (i = 1; i < ntot; i++)
+    {
+      length += hypot (line->x[i] - line->x[i - 1],
+                       line->y[i] - line->y[i - 1]);
+    }
+  line->npts = ntot;
+  line->kept = (ntot >= 2 && length >= s->minlength);
+
+  /* clear per-trajectory markers for the next seed attempt */
+  for (i = 0; i < line->nocc; i++)
+    w->cur[line->occ[i]] = 0;
+}
+
+/*
+ * Traces the seeds of lines start..end-1 of a batch
+ */
+static void
+_giza_stream_trace_band (void *arg, int start, int end, int band)
+{
+  giza_stream_batch_t *b = (giza_stream_batch_t *) arg;
+  int c;
+
+  for (c = start; c < end; c++)
+    _giza_stream_trace (b->s, &b->work[band], &b->lines[c]);
+}
+
+/**
+ * Internal: _giza_stream_conflict
+ *
+ * Synopsis: Return 1 if a line traced ahead of time would have come out
+ * differently against the mask as it is now. The mask only gains cells,
+ * and a trajectory only reads the mask on entering a cell, which it then
+ * records in occ[] unless it stops there; a cell that stopped it stays
+ * occupied. So the line is unchanged unless one of its occ[] cells has
+ * been taken since it was traced.
+ *
+ * Input:
+ *  -line  :- Line traced ahead of time
+ *  -fresh :- Mask cells taken since the line was traced
+ *
+ * Returns: 1 if the line must be traced again, 0 otherwise
+ */
+static int
+_giza_stream_conflict (const giza_stream_line_t *line,
+                       const unsigned char *fresh)
+{
+  int i;
+
+  /* occ[] is full, so it may not hold every cell read */
+  if (line->nocc >= STREAM_MAX_PTS)
+    return 1;
+  for (i = 0; i < line->nocc; i++)
+    if (fresh[line->occ[i]])
+      return 1;
+  return 0;
+}
+
 /**
  * Internal: _giza_stream_arrow_index
  *
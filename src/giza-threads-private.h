@@ -0,0 +1,32 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+#ifndef GIZA_THREADS_PRIVATE_H
+#define GIZA_THREADS_PRIVATE_H
+
+/* work on items start..end-1 of a band, band is 0..nbands-1 */
+typedef void (*giza_band_task) (void *arg, int start, int end, int band);
+
+void _giza_init_threads (void);
+int  _giza_thread_bands (int n, int grain);
+void _giza_parallel_for (int nbands, int n, giza_band_task task, void *arg);
+
+#endif
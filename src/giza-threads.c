@@ -0,0 +1,294 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ *
+ * Contributor(s):
+ *      Daniel Price <daniel.price@monash.edu> (main contact)
+ */
+
+/*
+ * A small persistent pool of worker threads, used to split the pixel work
+ * of image rendering into bands of rows. The calling thread always works
+ * on band 0 and worker k on band k, so each band can own a scratch buffer.
+ * Without POSIX threads (configure finds no pthread_create) everything
+ * runs serially.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "giza-threads-private.h"
+#include "giza-io-private.h"
+#include <giza.h>
+#include <stdlib.h>
+
+#ifdef GIZA_HAVE_PTHREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define GIZA_MAX_THREADS 256
+
+static int _giza_nthreads = 1;
+static int _giza_nthreads_set = 0;
+
+#ifdef GIZA_HAVE_PTHREADS
+static pthread_mutex_t _giza_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _giza_pool_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t _giza_pool_done = PTHREAD_COND_INITIALIZER;
+
+/* state shared with the workers, protected by _giza_pool_lock */
+static struct
+{
+  pthread_t thread[GIZA_MAX_THREADS];
+  unsigned long created[GIZA_MAX_THREADS];
+  int nworkers;
+  unsigned long job;
+  int busy;
+  int pending;
+  int nbands;
+  int n;
+  giza_band_task task;
+  void *arg;
+} _giza_pool;
+
+static void _giza_band_range (int n, int nbands, int band, int *start, int *end);
+static void *_giza_worker (void *arg);
+static int _giza_start_workers (int nworkers);
+#endif
+
+/**
+ * Settings: giza_set_num_threads
+ *
+ * Synopsis: Sets the number of threads used to colour the pixels of images,
+ * trace contours and integrate streamlines. Images too small to benefit are
+ * always coloured by a single thread, and the result does not depend on
+ * the number of threads.
+ * The default is taken from the GIZA_NUM_THREADS environment variable, or 1.
+ *
+ * Input:
+ *  -nthreads :- number of threads; 0 uses one thread per processor
+ *
+ * See Also: giza_get_num_threads, giza_render, giza_contour, giza_streamplot
+ */
+void
+giza_set_num_threads (int nthreads)
+{
+  if (nthreads < 0)
+    {
+      _giza_warning ("giza_set_num_threads", "Invalid number of threads, not set");
+      return;
+    }
+  if (nthreads == 0)
+    {
+#if defined(GIZA_HAVE_PTHREADS) && defined(_SC_NPROCESSORS_ONLN)
+      long nproc = sysconf (_SC_NPROCESSORS_ONLN);
+      nthreads = (nproc > 0) ? (int) nproc : 1;
+#else
+      nthreads = 1;
+#endif
+    }
+  if (nthreads > GIZA_MAX_THREADS)
+    nthreads = GIZA_MAX_THREADS;
+
+  _giza_nthreads = nthreads;
+  _giza_nthreads_set = 1;
+}
+
+/**
+ * Settings: giza_get_num_threads
+ *
+ * Synopsis: Queries the number of threads used to colour the pixels of images.
+ *
+ * Output:
+ *  -nthreads :- number of threads
+ *
+ * See Also: giza_set_num_threads
+ */
+void
+giza_get_num_threads (int *nthreads)
+{
+  *nthreads = _giza_nthreads;
+}
+
+/**
+ * Reads the default number of threads from the GIZA_NUM_THREADS environment
+ * variable, unless it has already been set with giza_set_num_threads
+ */
+void
+_giza_init_threads (void)
+{
+  char *tmp;
+
+  if (_giza_nthreads_set)
+    return;
+
+  tmp = getenv ("GIZA_NUM_THREADS");
+  if (tmp && tmp[0])
+    {
+      char *end;
+      long n = strtol (tmp, &end, 10);
+      if (*end != '\0' || n < 0)
+        {
+          _giza_warning ("giza", "Ignoring invalid GIZA_NUM_THREADS=%s", tmp);
+          return;
+        }
+      giza_set_num_threads ((int) n);
+    }
+}
+
+/**
+ * Returns the number of bands to split n items into, such that each band
+ * has at least grain items and there is no more than one band per thread
+ */
+int
+_giza_thread_bands (int n, int grain)
+{
+  int nbands;
+
+  if (grain < 1)
+    grain = 1;
+  nbands = n / grain;
+  if (nbands > _giza_nthreads)
+    nbands = _giza_nthreads;
+  if (nbands < 1)
+    nbands = 1;
+  return nbands;
+}
+
+#ifdef GIZA_HAVE_PTHREADS
+/**
+ * Calls task for each of nbands contiguous bands of the items 0..n-1, in
+ * parallel, and returns when all have finished. nbands should come from
+ * _giza_thread_bands; if the worker threads cannot be started, or the pool
+ * is already in use, the bands are processed one after the other.
+ */
+void
+_giza_parallel_for (int nbands, int n, giza_band_task task, void *arg)
+{
+  int band, start, end;
+
+  if (nbands > 1)
+    {
+      pthread_mutex_lock (&_giza_pool_lock);
+      if (_giza_pool.busy || !_giza_start_workers (nbands - 1))
+        {
+          pthread_mutex_unlock (&_giza_pool_lock);
+        }
+      else
+        {
+          _giza_pool.busy = 1;
+          _giza_pool.task = task;
+          _giza_pool.arg = arg;
+          _giza_pool.n = n;
+          _giza_pool.nbands = nbands;
+          _giza_pool.pending = nbands - 1;
+          _giza_pool.job++;
+          pthread_cond_broadcast (&_giza_pool_wake);
+          pthread_mutex_unlock (&_giza_pool_lock);
+
+          _giza_band_range (n, nbands, 0, &start, &end);
+          task (arg, start, end, 0);
+
+          pthread_mutex_lock (&_giza_pool_lock);
+          while (_giza_pool.pending > 0)
+            pthread_cond_wait (&_giza_pool_done, &_giza_pool_lock);
+          _giza_pool.busy = 0;
+          pthread_mutex_unlock (&_giza_pool_lock);
+          return;
+        }
+    }
+
+  for (band = 0; band < nbands; band++)
+    {
+      _giza_band_range (n, nbands, band, &start, &end);
+      task (arg, start, end, band);
+    }
+}
+
+/* items handled by a given band */
+static void
+_giza_band_range (int n, int nbands, int band, int *start, int *end)
+{
+  *start = (int) (((long long) n * band) / nbands);
+  *end = (int) (((long long) n * (band + 1)) / nbands);
+}
+
+/* make sure at least nworkers threads exist; call with the lock held */
+static int
+_giza_start_workers (int nworkers)
+{
+  while (_giza_pool.nworkers < nworkers)
+    {
+      /* worker k works on band k, starting from the next job posted */
+      long band = _giza_pool.nworkers + 1;
+      _giza_pool.created[_giza_pool.nworkers] = _giza_pool.job;
+      if (pthread_create (&_giza_pool.thread[_giza_pool.nworkers], NULL,
+                          _giza_worker, (void *) band) != 0)
+        {
+          _giza_warning ("giza_set_num_threads",
+                         "Could not start thread, rendering serially");
+          _giza_nthreads = _giza_pool.nworkers + 1;
+          return 0;
+        }
+      _giza_pool.nworkers++;
+    }
+  return 1;
+}
+
+static void *
+_giza_worker (void *arg)
+{
+  int band = (int) (long) arg;
+  unsigned long seen;
+  int start, end;
+
+  pthread_mutex_lock (&_giza_pool_lock);
+  seen = _giza_pool.created[band - 1];
+  for (;;)
+    {
+      while (_giza_pool.job == seen)
+        pthread_cond_wait (&_giza_pool_wake, &_giza_pool_lock);
+      seen = _giza_pool.job;
+      if (band >= _giza_pool.nbands)
+        continue;
+
+      _giza_band_range (_giza_pool.n, _giza_pool.nbands, band, &start, &end);
+      giza_band_task task = _giza_pool.task;
+      void *taskarg = _giza_pool.arg;
+      pthread_mutex_unlock (&_giza_pool_lock);
+
+      task (taskarg, start, end, band);
+
+      pthread_mutex_lock (&_giza_pool_lock);
+      if (--_giza_pool.pending == 0)
+        pthread_cond_signal (&_giza_pool_done);
+    }
+  return NULL;
+}
+
+#else
+
+void
+_giza_parallel_for (int nbands, int n, giza_band_task task, void *arg)
+{
+  (void) nbands;
+  task (arg, 0, n, 0);
+}
+
+#endif
@@ -25,6 +25,8 @@
 #include "giza-private.h"
 #include "giza-drivers-private.h"
 #include "giza-io-private.h"
+#include "giza-threads-private.h"
+#include "giza-itf.h"
 #include <math.h>
 #include <stdlib.h>
 
@@ -93,4 +95,7 @@ void _giza_init(void)
      {
        Sets.autolog = 1;
      }
+   _giza_init_threads ();
+   /* pick the image kernels here, before any worker thread uses them */
+   _giza_itf_set_simd_level (-1);
 }
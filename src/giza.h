@@ -135,6 +135,10 @@ void giza_rgb_from_table (double pos, double *red, double *green,
 			  double *blue);
 void giza_rgb_from_table_float (float pos, float *red, float *green,
 				float *blue);
+void giza_rgb_from_table_array (int n, const double *pos, double *red,
+				double *green, double *blue);
+void giza_rgb_from_table_array_float (int n, const float *pos, float *red,
+				      float *green, float *blue);
 
 void giza_contour (int sizex, int sizey, const double* data,
 		   int i1, int i2, int j1, int j2, int ncont,
@@ -149,10 +153,29 @@ void giza_contour_blanked_float (int sizex, int sizey, const float* data, int i1
 	      int i2, int j1, int j2, int ncont, const float* cont,
 	      const float *affine, float blank);
 
+void giza_contour_curvilinear (int sizex, int sizey, const double* data, const double* x,
+	      const double* y, int i1, int i2, int j1, int j2, int ncont, const double* cont);
+void giza_contour_curvilinear_float (int sizex, int sizey, const float* data, const float* x,
+	      const float* y, int i1, int i2, int j1, int j2, int ncont, const float* cont);
+
 void giza_contour_fill (int sizex, int sizey, const double* data, int i1,
 	      int i2, int j1, int j2, double c1, double c2, const double *affine);
 void giza_contour_fill_float (int sizex, int sizey, const float* data, int i1,
 	      int i2, int j1, int j2, float c1, float c2, const float *affine);
+void giza_contour_fill_levels (int sizex, int sizey, const double* data, int i1,
+	      int i2, int j1, int j2, int nlevel, const double* level, const double *affine);
+void giza_contour_fill_levels_float (int sizex, int sizey, const float* data, int i1,
+	      int i2, int j1, int j2, int nlevel, const float* level, const float *affine);
+
+int giza_contour_extract (int sizex, int sizey, const double* data, int i1,
+	      int i2, int j1, int j2, int ncont, const double* cont, const double *affine);
+int giza_contour_extract_float (int sizex, int sizey, const float* data, int i1,
+	      int i2, int j1, int j2, int ncont, const float* cont, const float *affine);
+void giza_draw_contour_set (int set);
+int giza_get_contour_set_nline (int set, int k);
+int giza_get_contour_set_line (int set, int k, int line, int maxpts, double *x, double *y);
+int giza_get_contour_set_line_float (int set, int k, int line, int maxpts, float *x, float *y);
+void giza_free_contour_set (int set);
 
 void giza_contour_labelled (int sizex, int sizey, const double* data, int i1,
 	      int i2, int j1, int j2, double c,
@@ -336,6 +359,53 @@ void giza_render_alpha (int sizex, int sizey, const double* data, const double*
 void giza_render_alpha_float (int sizex, int sizey, const float* data, const float* alpha,
                   int i1, int i2, int j1, int j2, float valMin, float valMax,
                   int extend, int filter, const float *affine);
+void giza_render_blanked (int sizex, int sizey, const double* data, const unsigned char* mask,
+			  double blank, int i1, int i2, int j1, int j2, double valMin, double valMax,
+			  int extend, int filter, const double *affine);
+void giza_render_blanked_float (int sizex, int sizey, const float* data, const unsigned char* mask,
+				float blank, int i1, int i2, int j1, int j2, float valMin, float valMax,
+				int extend, int filter, const float *affine);
+void giza_render_u8 (int sizex, int sizey, const unsigned char* data,
+                  int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine);
+void giza_render_u16 (int sizex, int sizey, const unsigned short* data,
+                  int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine);
+void giza_render_i16 (int sizex, int sizey, const short* data,
+                  int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine);
+void giza_render_i32 (int sizex, int sizey, const int* data,
+                  int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine);
+int giza_get_render_limits (int sizex, int sizey, const double* data, const unsigned char* mask,
+                  double blank, int i1, int i2, int j1, int j2, double pmin, double pmax,
+                  double *valMin, double *valMax);
+int giza_get_render_limits_float (int sizex, int sizey, const float* data, const unsigned char* mask,
+                  float blank, int i1, int i2, int j1, int j2, float pmin, float pmax,
+                  float *valMin, float *valMax);
+int giza_get_render_limits_typed (int sizex, int sizey, int type, const void* data,
+                  const unsigned char* mask, double blank, int i1, int i2, int j1, int j2,
+                  double pmin, double pmax, double *valMin, double *valMax);
+
+int giza_image_create (int sizex, int sizey, const double* data, int i1, int i2,
+                  int j1, int j2, double valMin, double valMax, int transparent);
+int giza_image_create_float (int sizex, int sizey, const float* data, int i1, int i2,
+                  int j1, int j2, float valMin, float valMax, int transparent);
+void giza_image_update (int image, int sizex, int sizey, const double* data, int i1, int i2,
+                  int j1, int j2, double valMin, double valMax);
+void giza_image_update_float (int image, int sizex, int sizey, const float* data, int i1, int i2,
+                  int j1, int j2, float valMin, float valMax);
+void giza_image_draw (int image, int extend, int filter, const double *affine);
+void giza_image_draw_float (int image, int extend, int filter, const float *affine);
+void giza_image_destroy (int image);
+
+void giza_render_tiled (int sizex, int sizey, int type,
+                  int (*reader) (void *user, int i1, int i2, int j1, int j2, void *tile),
+                  void *user, int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine);
+void giza_render_file (const char *filename, long offset, int type, int sizex, int sizey,
+                  int i1, int i2, int j1, int j2, double valMin, double valMax,
+                  int extend, int filter, const double *affine);
 
 void giza_render_gray (int sizex, int sizey, const double* data, int i1,
 		  int i2, int j1, int j2, double valMin, double valMax, int extend, int filter,
@@ -353,6 +423,12 @@ void giza_draw_pixels (int sizex, int sizey, const int* idata, int i1, int i2,
 	    int j1, int j2, double xmin, double xmax, double ymin, double ymax, int extend, int filter);
 void giza_draw_pixels_float (int sizex, int sizey, const int* idata, int i1, int i2,
 	    int j1, int j2, float xmin, float xmax, float ymin, float ymax, int extend, int filter);
+void giza_draw_rgb (int sizex, int sizey, const unsigned char* rgb, int i1, int i2,
+	    int j1, int j2, double xmin, double xmax, double ymin, double ymax, int extend, int filter);
+void giza_draw_rgba (int sizex, int sizey, const unsigned char* rgba, int i1, int i2,
+	    int j1, int j2, double xmin, double xmax, double ymin, double ymax, int extend, int filter);
+void giza_draw_argb32 (int sizex, int sizey, int stride, const unsigned char* argb, int i1, int i2,
+	    int j1, int j2, double xmin, double xmax, double ymin, double ymax, int extend, int filter);
 
 double giza_round (double x, int *nsub);
 float giza_round_float (float x, int *nsub);
@@ -424,3 +500,11 @@ void giza_get_window_float (float *x1, float *x2, float *y1, float *y2);
 
 void giza_set_image_transfer_function(int itf);
 void giza_get_image_transfer_function(int* itfp);
+int giza_register_image_transfer_function (double (*func) (double fraction, void *user), void *user);
+
+void giza_set_num_threads (int nthreads);
+void giza_get_num_threads (int *nthreads);
+void giza_set_image_resample (int mode);
+void giza_get_image_resample (int *mode);
+void giza_set_image_colour_mode (int mode);
+void giza_get_image_colour_mode (int *mode);
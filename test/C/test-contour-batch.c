@@ -0,0 +1,139 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that contours drawn one path per level look the same however the
+ * levels are grouped into calls, with and without a blank value, and that
+ * negative levels are dotted when the line style is chosen automatically */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 120
+#define NY 90
+#define W 360
+#define H 270
+
+static double data[NY*NX];
+static const double affine[6] = { 3., 0., 0., 3., -1.5, -1.5 };
+
+static cairo_surface_t *draw (int ncont, const double *cont, int blanked, int split);
+static long inked (cairo_surface_t *a);
+
+int
+main (void)
+{
+  static const double cont[] = { -0.6, -0.2, 0.1, 0.5 };
+  cairo_surface_t *all, *one, *other;
+  int i, j, failed = 0;
+
+  giza_start_warnings ();
+
+  for (j = 0; j < NY; j++)
+    for (i = 0; i < NX; i++)
+      {
+        double x = -1.5 + 3. * i / (NX - 1.), y = -1.5 + 3. * j / (NY - 1.);
+        data[j*NX+i] = x * cos (3.*x*y);
+      }
+
+  all = draw (4, cont, 0, 0);
+  if (inked (all) == 0)
+    {
+      fprintf (stderr, "Error: no contours were drawn\n");
+      failed++;
+    }
+
+  one = draw (4, cont, 0, 1);
+  if (test_surfaces_differ (all, one))
+    {
+      fprintf (stderr, "Error: contours drawn a level at a time differ\n");
+      failed++;
+    }
+  cairo_surface_destroy (one);
+
+  one = draw (4, cont, 1, 0);
+  if (test_surfaces_differ (all, one))
+    {
+      fprintf (stderr, "Error: contours with an unused blank value differ\n");
+      failed++;
+    }
+  cairo_surface_destroy (one);
+  cairo_surface_destroy (all);
+
+  /* automatic style: negative levels dotted, positive ones solid */
+  one = draw (2, cont, 0, 0);
+  other = draw (-2, cont, 0, 0);
+  if (!test_surfaces_differ (one, other) || inked (one) >= inked (other))
+    {
+      fprintf (stderr, "Error: negative levels are not dotted\n");
+      failed++;
+    }
+  cairo_surface_destroy (one);
+  cairo_surface_destroy (other);
+
+  one = draw (2, cont + 2, 0, 0);
+  other = draw (-2, cont + 2, 0, 0);
+  if (test_surfaces_differ (one, other))
+    {
+      fprintf (stderr, "Error: positive levels are not solid\n");
+      failed++;
+    }
+  cairo_surface_destroy (one);
+  cairo_surface_destroy (other);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* draws the contours in one call, or in one call per level if split */
+static cairo_surface_t *
+draw (int ncont, const double *cont, int blanked, int split)
+{
+  cairo_surface_t *surface;
+  int k, n = abs (ncont);
+
+  surface = test_device_begin (W, H);
+  giza_set_window (-1.5, 1.5 + 3.*NX, -1.5, 1.5 + 3.*NY);
+  giza_set_line_style (GIZA_LS_SOLID);
+
+  for (k = 0; k < (split ? n : 1); k++)
+    {
+      int nc = split ? (ncont > 0 ? 1 : -1) : ncont;
+      const double *c = split ? cont + k : cont;
+      if (blanked)
+        giza_contour_blanked (NX, NY, data, 0, NX-1, 0, NY-1, nc, c, affine, -999.);
+      else
+        giza_contour (NX, NY, data, 0, NX-1, 0, NY-1, nc, c, affine);
+    }
+
+  return test_device_end (surface);
+}
+
+static long
+inked (cairo_surface_t *a)
+{
+  const unsigned char *p = cairo_image_surface_get_data (a);
+  long n = 0;
+  size_t k;
+
+  for (k = 0; k < (size_t) cairo_image_surface_get_stride (a) * H; k++)
+    n += p[k];
+  return n;
+}
@@ -0,0 +1,123 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that contours of data on a curvilinear (polar) grid are drawn
+ * where they lie in world coordinates, in double and float precision */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NR 40
+#define NT 121
+#define W 440
+#define H 440
+#define LEVEL 5.05
+
+static double data[NT*NR], x[NT*NR], y[NT*NR];
+static float fdata[NT*NR], fx[NT*NR], fy[NT*NR];
+
+static cairo_surface_t *draw (int isfloat);
+static int inked_near (cairo_surface_t *s, double r, double angle);
+
+int
+main (void)
+{
+  static const char *names[] = { "double", "float" };
+  cairo_surface_t *s;
+  double r, t;
+  int i, j, k, f, failed = 0;
+
+  giza_start_warnings ();
+
+  /* the data are the distance from the origin, so each contour is a circle */
+  for (j = 0; j < NT; j++)
+    for (i = 0; i < NR; i++)
+      {
+        r = 1. + 9. * i / (NR - 1.);
+        t = 2. * M_PI * j / (NT - 1.);
+        data[j*NR+i] = r;
+        x[j*NR+i] = r * cos (t);
+        y[j*NR+i] = r * sin (t);
+        fdata[j*NR+i] = (float) data[j*NR+i];
+        fx[j*NR+i] = (float) x[j*NR+i];
+        fy[j*NR+i] = (float) y[j*NR+i];
+      }
+
+  for (f = 0; f < 2; f++)
+    {
+      s = draw (f);
+      for (k = 0; k < 16; k++)
+        {
+          t = 2. * M_PI * (k + 0.3) / 16.;
+          if (!inked_near (s, LEVEL, t))
+            {
+              fprintf (stderr, "Error: %s contour missing at angle %g\n", names[f], t);
+              failed++;
+            }
+          if (inked_near (s, LEVEL - 2., t) || inked_near (s, LEVEL + 2., t))
+            {
+              fprintf (stderr, "Error: %s contour drawn away from its circle at angle %g\n",
+                       names[f], t);
+              failed++;
+            }
+        }
+      cairo_surface_destroy (s);
+    }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static cairo_surface_t *
+draw (int isfloat)
+{
+  double level = LEVEL;
+  float flevel = (float) LEVEL;
+  cairo_surface_t *surface;
+
+  surface = test_device_begin (W, H);
+  giza_set_window (-11., 11., -11., 11.);
+
+  if (isfloat)
+    giza_contour_curvilinear_float (NR, NT, fdata, fx, fy, 0, NR-1, 0, NT-1, 1, &flevel);
+  else
+    giza_contour_curvilinear (NR, NT, data, x, y, 0, NR-1, 0, NT-1, 1, &level);
+
+  return test_device_end (surface);
+}
+
+/* whether any pixel within two of the point at radius r and angle is drawn */
+static int
+inked_near (cairo_surface_t *s, double r, double angle)
+{
+  const uint32_t *pix = (const uint32_t *) cairo_image_surface_get_data (s);
+  const int stride = cairo_image_surface_get_stride (s) / 4;
+  int px = (int) ((r * cos (angle) + 11.) / 22. * W);
+  int py = (int) ((11. - r * sin (angle)) / 22. * H);
+  int i, j;
+
+  for (j = py - 2; j <= py + 2; j++)
+    for (i = px - 2; i <= px + 2; i++)
+      if (i >= 0 && i < W && j >= 0 && j < H && pix[j*stride + i] != 0)
+        return 1;
+  return 0;
+}
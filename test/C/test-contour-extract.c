@@ -0,0 +1,156 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that a contour set drawn with giza_draw_contour_set looks the same
+ * as the contours drawn by giza_contour, on each device it is drawn on,
+ * and that its lines are the contours in world coordinates */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define N 101
+#define W 300
+#define H 300
+#define MAXPTS 4096
+
+static double data[N*N];
+static float fdata[N*N];
+
+static cairo_surface_t *draw (int set, int ncont, const double *cont);
+
+int
+main (void)
+{
+  /* circles of radius 10.3, 20.3 and 30.3, the first two dotted */
+  static const double cont[] = { -15., -5., 5. };
+  static const double unit[6] = { 1., 0., 0., 1., 0., 0. };
+  static const double affine[6] = { 2., 0., 0., 2., 5., -3. };
+  static const float fcont[] = { -15.f, -5.f, 5.f };
+  static const float faffine[6] = { 2.f, 0.f, 0.f, 2.f, 5.f, -3.f };
+  static double x[MAXPTS], y[MAXPTS];
+  static float fx[MAXPTS], fy[MAXPTS];
+  cairo_surface_t *want, *got;
+  double r, err;
+  int i, j, k, n, set, fset, failed = 0;
+
+  giza_start_warnings ();
+
+  for (j = 0; j < N; j++)
+    for (i = 0; i < N; i++)
+      {
+        data[j*N+i] = hypot (i - 50., j - 50.) - 25.3;
+        fdata[j*N+i] = (float) data[j*N+i];
+      }
+
+  /* drawn from the set, on two devices in turn, or traced each time */
+  set = giza_contour_extract (N, N, data, 0, N-1, 0, N-1, 3, cont, unit);
+  if (set <= 0)
+    {
+      fprintf (stderr, "Error: no contour set was extracted\n");
+      return EXIT_FAILURE;
+    }
+  want = draw (0, 3, cont);
+  got = draw (set, 3, cont);
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: contour set drawn differs from giza_contour\n");
+      failed++;
+    }
+  cairo_surface_destroy (got);
+  got = draw (set, 3, cont);
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: contour set drawn again differs from giza_contour\n");
+      failed++;
+    }
+  cairo_surface_destroy (got);
+  cairo_surface_destroy (want);
+  giza_free_contour_set (set);
+
+  /* each level is one closed circle, in world coordinates */
+  set = giza_contour_extract (N, N, data, 0, N-1, 0, N-1, 3, cont, affine);
+  fset = giza_contour_extract_float (N, N, fdata, 0, N-1, 0, N-1, 3, fcont, faffine);
+  for (k = 0; k < 3; k++)
+    {
+      if (giza_get_contour_set_nline (set, k) != 1 || giza_get_contour_set_nline (fset, k) != 1)
+        {
+          fprintf (stderr, "Error: level %g has %d lines, should have 1\n", cont[k],
+                   giza_get_contour_set_nline (set, k));
+          failed++;
+          continue;
+        }
+      n = giza_get_contour_set_line (set, k, 0, MAXPTS, x, y);
+      if (n < 4 || n > MAXPTS || x[0] != x[n-1] || y[0] != y[n-1])
+        {
+          fprintf (stderr, "Error: level %g is not a closed line\n", cont[k]);
+          failed++;
+          continue;
+        }
+      err = 0.;
+      for (i = 0; i < n; i++)
+        {
+          /* back to the grid, where the centre is at 50.5, 50.5 */
+          r = hypot ((x[i] - 5.)/2. - 50.5, (y[i] + 3.)/2. - 50.5);
+          err = fmax (err, fabs (r - 25.3 - cont[k]));
+        }
+      if (err > 0.05)
+        {
+          fprintf (stderr, "Error: level %g is %g from the circle it should be\n", cont[k], err);
+          failed++;
+        }
+      if (giza_get_contour_set_line_float (fset, k, 0, MAXPTS, fx, fy) != n)
+        {
+          fprintf (stderr, "Error: float level %g has a different number of points\n", cont[k]);
+          failed++;
+        }
+    }
+  giza_free_contour_set (fset);
+
+  /* freed sets are gone */
+  giza_free_contour_set (set);
+  if (giza_get_contour_set_nline (set, 0) != 0)
+    {
+      fprintf (stderr, "Error: a freed contour set still has lines\n");
+      failed++;
+    }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* draws the contour set, or the contours themselves if set is 0 */
+static cairo_surface_t *
+draw (int set, int ncont, const double *cont)
+{
+  static const double unit[6] = { 1., 0., 0., 1., 0., 0. };
+  cairo_surface_t *surface;
+
+  surface = test_device_begin (W, H);
+  giza_set_window (0., N + 1., 0., N + 1.);
+  giza_set_line_style (GIZA_LS_SOLID);
+
+  if (set)
+    giza_draw_contour_set (set);
+  else
+    giza_contour (N, N, data, 0, N-1, 0, N-1, ncont, cont, unit);
+
+  return test_device_end (surface);
+}
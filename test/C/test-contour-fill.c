@@ -0,0 +1,171 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that filling between two levels is the same as a single region
+ * of giza_contour_fill_levels, that the regions between several levels
+ * take their colours in turn from the colour index range, that float data
+ * fill as double data do, and that a filled region has no seams */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 120
+#define NY 90
+#define W 360
+#define H 270
+
+static double data[NY*NX];
+static float fdata[NY*NX];
+static const double affine[6] = { 3., 0., 0., 3., -1.5, -1.5 };
+
+static cairo_surface_t *draw (int how, int nlevel, const double *level);
+
+enum { FILL, FILL_FLOAT, LEVELS, LEVELS_FLOAT };
+
+int
+main (void)
+{
+  static const double level[] = { -0.6, -0.2, 0.1, 0.5 };
+  static const double down[] = { 0.5, 0.1 };
+  static const double all[] = { -10., 10. };
+  cairo_surface_t *want, *got;
+  const uint32_t *pix;
+  int i, j, stride, seam = 0, failed = 0;
+
+  giza_start_warnings ();
+
+  for (j = 0; j < NY; j++)
+    for (i = 0; i < NX; i++)
+      {
+        double x = -1.5 + 3. * i / (NX - 1.), y = -1.5 + 3. * j / (NY - 1.);
+        fdata[j*NX+i] = (float) (x * cos (3.*x*y));
+        data[j*NX+i] = fdata[j*NX+i];
+      }
+
+  /* one region, each way and for each type */
+  want = draw (FILL, 2, level + 1);
+  got = draw (LEVELS, 2, level + 1);
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: one region of giza_contour_fill_levels differs from giza_contour_fill\n");
+      failed++;
+    }
+  cairo_surface_destroy (got);
+  got = draw (FILL_FLOAT, 2, level + 1);
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: giza_contour_fill_float differs from giza_contour_fill\n");
+      failed++;
+    }
+  cairo_surface_destroy (got);
+  cairo_surface_destroy (want);
+
+  /* several regions at once, or one at a time in the colours they should take */
+  want = draw (FILL, 4, level);
+  got = draw (LEVELS, 4, level);
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: regions between several levels differ from filling them one at a time\n");
+      failed++;
+    }
+  cairo_surface_destroy (want);
+  want = draw (LEVELS_FLOAT, 4, level);
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: giza_contour_fill_levels_float differs from giza_contour_fill_levels\n");
+      failed++;
+    }
+  cairo_surface_destroy (got);
+  cairo_surface_destroy (want);
+
+  /* levels that do not increase draw nothing */
+  want = draw (LEVELS, 0, level);
+  got = draw (LEVELS, 2, down);
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: levels that decrease should not be filled\n");
+      failed++;
+    }
+  cairo_surface_destroy (got);
+  cairo_surface_destroy (want);
+
+  /* data all in one region fill the grid without seams between cells */
+  want = draw (FILL, 2, all);
+  pix = (const uint32_t *) cairo_image_surface_get_data (want);
+  stride = cairo_image_surface_get_stride (want)/4;
+  for (j = 4; j < H - 8; j++)
+    for (i = 4; i < W - 8; i++)
+      if (pix[j*stride + i] != pix[(H/2)*stride + W/2] && !seam++)
+        {
+          fprintf (stderr, "Error: filled region has a seam at pixel %d, %d\n", i, j);
+          failed++;
+        }
+  cairo_surface_destroy (want);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* fills between the levels in one call, or one region per call if FILL,
+ * with the colour index range 2 to 4 */
+static cairo_surface_t *
+draw (int how, int nlevel, const double *level)
+{
+  cairo_surface_t *surface;
+  float flevel[4], faffine[6];
+  int k;
+
+  surface = test_device_begin (W, H);
+  giza_set_window (-1.5, 1.5 + 3.*NX, -1.5, 1.5 + 3.*NY);
+  giza_set_colour_index_range (2, 4);
+  if (nlevel == 2)
+    giza_set_colour_index_range (3, 3);
+
+  for (k = 0; k < nlevel; k++)
+    flevel[k] = (float) level[k];
+  for (k = 0; k < 6; k++)
+    faffine[k] = (float) affine[k];
+
+  switch (how)
+    {
+    case FILL:
+    case FILL_FLOAT:
+      for (k = 0; k < nlevel - 1; k++)
+        {
+          giza_set_colour_index (nlevel == 2 ? 3 : 2 + k);
+          if (how == FILL)
+            giza_contour_fill (NX, NY, data, 0, NX-1, 0, NY-1, level[k], level[k+1], affine);
+          else
+            giza_contour_fill_float (NX, NY, fdata, 0, NX-1, 0, NY-1, flevel[k], flevel[k+1],
+                                     faffine);
+        }
+      break;
+    case LEVELS:
+      giza_contour_fill_levels (NX, NY, data, 0, NX-1, 0, NY-1, nlevel, level, affine);
+      break;
+    case LEVELS_FLOAT:
+      giza_contour_fill_levels_float (NX, NY, fdata, 0, NX-1, 0, NY-1, nlevel, flevel, faffine);
+      break;
+    }
+
+  return test_device_end (surface);
+}
@@ -0,0 +1,95 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that labelled contours come out the same when drawn again after
+ * other labelled contours, which reuse the same buffers, and that labels
+ * on a large grid with many crowded lines leave gaps in them */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 600
+#define NY 450
+#define W 600
+#define H 450
+
+static double data[NY*NX];
+
+static cairo_surface_t *draw (int nx, int ny, double c, const char *label);
+
+int
+main (void)
+{
+  cairo_surface_t *want, *got, *other;
+  int i, j, failed = 0;
+
+  giza_start_warnings ();
+
+  /* many closed rings of each level, a few cells apart */
+  for (j = 0; j < NY; j++)
+    for (i = 0; i < NX; i++)
+      data[j*NX+i] = sin (0.3 * hypot (i - 0.4*NX, j - 0.6*NY)) + 0.001*i;
+
+  want = draw (80, 60, 0.5, "0.5");
+  other = draw (NX, NY, -0.2, "-0.2");
+  got = draw (80, 60, 0.5, "0.5");
+  if (test_surfaces_differ (want, got))
+    {
+      fprintf (stderr, "Error: labelled contour differs when drawn again\n");
+      failed++;
+    }
+  cairo_surface_destroy (want);
+  cairo_surface_destroy (got);
+
+  want = draw (NX, NY, -0.2, "");
+  if (!test_surfaces_differ (want, other))
+    {
+      fprintf (stderr, "Error: labels on the large grid left no gaps\n");
+      failed++;
+    }
+  got = draw (NX, NY, -0.2, "-0.2");
+  if (test_surfaces_differ (other, got))
+    {
+      fprintf (stderr, "Error: labelled contours on the large grid differ when drawn again\n");
+      failed++;
+    }
+  cairo_surface_destroy (got);
+  cairo_surface_destroy (want);
+  cairo_surface_destroy (other);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* draws the contour at c of the first nx by ny of the data */
+static cairo_surface_t *
+draw (int nx, int ny, double c, const char *label)
+{
+  static const double affine[6] = { 1., 0., 0., 1., 0., 0. };
+  cairo_surface_t *surface;
+
+  surface = test_device_begin (W, H);
+  giza_set_window (0., NX, 0., NY);
+
+  giza_contour_labelled (NX, NY, data, 0, nx-1, 0, ny-1, c, affine, label, 15, 10);
+
+  return test_device_end (surface);
+}
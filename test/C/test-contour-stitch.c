@@ -0,0 +1,250 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that contour segments given in any order and either way round
+ * are joined into the polylines and closed rings they make up, with every
+ * segment used once, including where more than two segments meet, and
+ * that tracing contours in parallel finds the same segments in the same
+ * order as one thread does, whatever order the levels are given in, and
+ * that float data give the same contours as the same values in double */
+
+#include "giza-contour-private.h"
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NRING 100
+#define NOPEN 50
+#define NX 400
+#define NY 300
+#define NCONT 5
+
+static void add (giza_contour_segs_t *segs, double x1, double y1, double x2, double y2);
+static int check_trace (void);
+
+int
+main (void)
+{
+  giza_contour_segs_t segs = { NULL, 0, 0 };
+  giza_contour_lines_t lines = { NULL, NULL, 0, 0, 0, 0 };
+  double ring[NRING][2], tmp[4];
+  size_t k, r, m, nring = 0, nopen = 0;
+  int i, failed = 0;
+
+  for (i = 0; i < NRING; i++)
+    {
+      ring[i][0] = 10. + 5. * cos (2. * M_PI * i / NRING);
+      ring[i][1] = 10. + 5. * sin (2. * M_PI * i / NRING);
+    }
+
+  /* a ring and an open line, both cut up and some segments reversed */
+  for (i = 0; i < NRING; i++)
+    {
+      if (i % 3 == 0)
+        add (&segs, ring[(i+1) % NRING][0], ring[(i+1) % NRING][1], ring[i][0], ring[i][1]);
+      else
+        add (&segs, ring[i][0], ring[i][1], ring[(i+1) % NRING][0], ring[(i+1) % NRING][1]);
+    }
+  for (i = 0; i < NOPEN; i++)
+    add (&segs, 30. + i, 0.5 * i, 31. + i, 0.5 * (i + 1));
+
+  /* shuffle */
+  for (k = segs.nseg - 1; k > 0; k--)
+    {
+      r = (k * 2654435761UL) % (k + 1);
+      for (i = 0; i < 4; i++)
+        {
+          tmp[i] = segs.xy[4*k+i];
+          segs.xy[4*k+i] = segs.xy[4*r+i];
+          segs.xy[4*r+i] = tmp[i];
+        }
+    }
+
+  if (!_giza_contour_stitch (&segs, &lines))
+    {
+      fprintf (stderr, "Error: stitching failed\n");
+      return EXIT_FAILURE;
+    }
+  if (lines.nline != 2 || lines.npts - lines.nline != segs.nseg)
+    {
+      fprintf (stderr, "Error: %lu segments made %lu lines of %lu points, expected 2 lines\n",
+               (unsigned long) segs.nseg, (unsigned long) lines.nline, (unsigned long) lines.npts);
+      failed++;
+    }
+  for (k = 0; k < lines.nline; k++)
+    {
+      m = lines.start[k+1] - lines.start[k];
+      if (_giza_contour_line_closed (&lines, k))
+        {
+          nring++;
+          if (m != NRING + 1)
+            {
+              fprintf (stderr, "Error: ring has %lu points\n", (unsigned long) m);
+              failed++;
+            }
+        }
+      else
+        {
+          nopen++;
+          if (m != NOPEN + 1)
+            {
+              fprintf (stderr, "Error: open line has %lu points\n", (unsigned long) m);
+              failed++;
+            }
+        }
+      /* successive points are neighbours on the ring or the line */
+      for (r = lines.start[k] + 1; r < lines.start[k+1]; r++)
+        {
+          double dx = lines.xy[2*r] - lines.xy[2*r-2], dy = lines.xy[2*r+1] - lines.xy[2*r-1];
+          if (dx*dx + dy*dy > 1.3)
+            {
+              fprintf (stderr, "Error: line %lu jumps at point %lu\n", (unsigned long) k,
+                       (unsigned long) r);
+              failed++;
+              break;
+            }
+        }
+    }
+  if (nring != 1 || nopen != 1)
+    {
+      fprintf (stderr, "Error: found %lu rings and %lu open lines\n",
+               (unsigned long) nring, (unsigned long) nopen);
+      failed++;
+    }
+
+  /* three segments meeting at a point make two lines */
+  segs.nseg = 0;
+  add (&segs, 0., 0., 1., 1.);
+  add (&segs, 1., 1., 2., 0.);
+  add (&segs, 1., 2., 1., 1.);
+  if (!_giza_contour_stitch (&segs, &lines) || lines.nline != 2 || lines.npts != 5)
+    {
+      fprintf (stderr, "Error: three segments at a point made %lu lines of %lu points\n",
+               (unsigned long) lines.nline, (unsigned long) lines.npts);
+      failed++;
+    }
+
+  segs.nseg = 0;
+  if (!_giza_contour_stitch (&segs, &lines) || lines.nline != 0)
+    {
+      fprintf (stderr, "Error: no segments should make no lines\n");
+      failed++;
+    }
+
+  free (segs.xy);
+  _giza_contour_free_lines (&lines);
+
+  failed += check_trace ();
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int
+check_trace (void)
+{
+  static double data[NY*NX], widened[NY*NX];
+  static float fdata[NY*NX];
+  static const double cont[NCONT] = { -1., -0.5, 0., 0.5, 1. };
+  static const double shuffled[NCONT+1] = { 0.5, NAN, -1., 1., 0., -0.5 };
+  static const int where[NCONT] = { 2, 5, 4, 0, 3 };
+  giza_contour_segs_t serial[NCONT], parallel[NCONT], unsorted[NCONT+1];
+  giza_contour_segs_t sfloat[NCONT], sdouble[NCONT];
+  giza_contour_lines_t lines = { NULL, NULL, 0, 0, 0, 0 };
+  int i, j, k, failed = 0;
+
+  for (j = 0; j < NY; j++)
+    for (i = 0; i < NX; i++)
+      {
+        double x = -1.5 + 3. * i / (NX - 1.), y = -1.5 + 3. * j / (NY - 1.);
+        data[j*NX+i] = x * cos (10.*x*y);
+        fdata[j*NX+i] = (float) data[j*NX+i];
+        widened[j*NX+i] = fdata[j*NX+i];
+      }
+  memset (serial, 0, sizeof (serial));
+  memset (parallel, 0, sizeof (parallel));
+  memset (unsorted, 0, sizeof (unsorted));
+  memset (sfloat, 0, sizeof (sfloat));
+  memset (sdouble, 0, sizeof (sdouble));
+
+  giza_set_num_threads (1);
+  _giza_contour_trace (NX, GIZA_DATA_DOUBLE, data, 3, NX-2, 1, NY-1, NCONT, cont, NULL, serial);
+  giza_set_num_threads (4);
+  _giza_contour_trace (NX, GIZA_DATA_DOUBLE, data, 3, NX-2, 1, NY-1, NCONT, cont, NULL, parallel);
+  _giza_contour_trace (NX, GIZA_DATA_DOUBLE, data, 3, NX-2, 1, NY-1, NCONT+1, shuffled, NULL, unsorted);
+  _giza_contour_trace (NX, GIZA_DATA_FLOAT, fdata, 0, NX-1, 0, NY-1, NCONT, cont, NULL, sfloat);
+  _giza_contour_trace (NX, GIZA_DATA_DOUBLE, widened, 0, NX-1, 0, NY-1, NCONT, cont, NULL, sdouble);
+  if (unsorted[1].nseg != 0)
+    {
+      fprintf (stderr, "Error: a NaN level should have no contour\n");
+      failed++;
+    }
+
+  for (k = 0; k < NCONT; k++)
+    {
+      if (serial[k].nseg == 0 || serial[k].nseg != parallel[k].nseg
+          || memcmp (serial[k].xy, parallel[k].xy, 4 * serial[k].nseg * sizeof (double)) != 0)
+        {
+          fprintf (stderr, "Error: level %g traced in parallel differs (%lu and %lu segments)\n",
+                   cont[k], (unsigned long) serial[k].nseg, (unsigned long) parallel[k].nseg);
+          failed++;
+        }
+      if (serial[k].nseg != unsorted[where[k]].nseg
+          || memcmp (serial[k].xy, unsorted[where[k]].xy, 4 * serial[k].nseg * sizeof (double)) != 0)
+        {
+          fprintf (stderr, "Error: level %g traced among unsorted levels differs\n", cont[k]);
+          failed++;
+        }
+      if (sfloat[k].nseg == 0 || sfloat[k].nseg != sdouble[k].nseg
+          || memcmp (sfloat[k].xy, sdouble[k].xy, 4 * sfloat[k].nseg * sizeof (double)) != 0)
+        {
+          fprintf (stderr, "Error: level %g traced in float data differs\n", cont[k]);
+          failed++;
+        }
+
+      /* segments from conrec join up into far fewer lines */
+      if (!_giza_contour_stitch (&serial[k], &lines) || lines.npts - lines.nline != serial[k].nseg
+          || lines.nline * 20 > serial[k].nseg)
+        {
+          fprintf (stderr, "Error: level %g: %lu segments made %lu lines\n", cont[k],
+                   (unsigned long) serial[k].nseg, (unsigned long) lines.nline);
+          failed++;
+        }
+      free (serial[k].xy);
+      free (parallel[k].xy);
+      free (sfloat[k].xy);
+      free (sdouble[k].xy);
+    }
+  for (k = 0; k <= NCONT; k++)
+    free (unsorted[k].xy);
+  _giza_contour_free_lines (&lines);
+  return failed;
+}
+
+static void
+add (giza_contour_segs_t *segs, double x1, double y1, double x2, double y2)
+{
+  double seg[4];
+
+  seg[0] = x1;
+  seg[1] = y1;
+  seg[2] = x2;
+  seg[3] = y2;
+  _giza_contour_add_segs (segs, seg, 1);
+}
@@ -0,0 +1,130 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that truecolour images land pixel for pixel on the device, and
+ * that RGBA bytes and the equivalent premultiplied ARGB32 pixels (drawn
+ * from an odd stride and from a sub-range) give identical results */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NX 97
+#define NY 61
+
+static cairo_surface_t *draw (int mode, const unsigned char *data, int stride);
+
+int
+main (void)
+{
+  static unsigned char rgb[3*NX*NY], rgba[4*NX*NY];
+  static uint32_t argb[(NX+3)*NY];
+  cairo_surface_t *want, *got;
+  const unsigned char *pix;
+  uint32_t p;
+  int i, j, k, a, failed = 0;
+
+  giza_start_warnings ();
+
+  for (j = 0; j < NY; j++)
+    for (i = 0; i < NX; i++)
+      {
+        k = j*NX + i;
+        rgb[3*k] = rgba[4*k] = (unsigned char) (3*i);
+        rgb[3*k+1] = rgba[4*k+1] = (unsigned char) (4*j);
+        rgb[3*k+2] = rgba[4*k+2] = (unsigned char) (i*j);
+        a = (i + j) % 2 ? 255 : (i*5) % 256;
+        rgba[4*k+3] = (unsigned char) a;
+        argb[j*(NX+3) + i] = ((uint32_t) a << 24)
+                           | ((uint32_t) ((rgba[4*k]*a + 127)/255) << 16)
+                           | ((uint32_t) ((rgba[4*k+1]*a + 127)/255) << 8)
+                           | (uint32_t) ((rgba[4*k+2]*a + 127)/255);
+      }
+
+  /* opaque pixels are copied exactly, the first row at the bottom */
+  got = draw (0, rgb, 0);
+  pix = cairo_image_surface_get_data (got);
+  for (j = 0; j < NY; j++)
+    for (i = 0; i < NX; i++)
+      {
+        k = j*NX + i;
+        p = ((const uint32_t *) (pix + (NY-1-j)*cairo_image_surface_get_stride (got)))[i];
+        if (p != (0xff000000u | ((uint32_t) rgb[3*k] << 16)
+                  | ((uint32_t) rgb[3*k+1] << 8) | rgb[3*k+2]))
+          failed++;
+      }
+  if (failed)
+    fprintf (stderr, "Error: %d RGB pixels differ\n", failed);
+  cairo_surface_destroy (got);
+
+  want = draw (1, rgba, 0);
+  for (k = 2; k < 4; k++)
+    {
+      got = draw (k, (const unsigned char *) argb, 4*(NX+3));
+      if (test_surfaces_differ (want, got))
+        {
+          fprintf (stderr, "Error: ARGB32 image (%s) differs from RGBA\n",
+                   k == 2 ? "padded rows" : "repacked rows");
+          failed++;
+        }
+      cairo_surface_destroy (got);
+    }
+  cairo_surface_destroy (want);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static cairo_surface_t *
+draw (int mode, const unsigned char *data, int stride)
+{
+  static unsigned char shifted[4*(NX+3)*NY + 1];
+  cairo_surface_t *surface;
+
+  surface = test_device_begin (NX, NY);
+  giza_set_window (0., NX, 0., NY);
+
+  switch (mode)
+    {
+    case 0:
+      giza_draw_rgb (NX, NY, data, 0, NX-1, 0, NY-1, 0., NX, 0., NY,
+                     GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST);
+      break;
+    case 1:
+      giza_draw_rgba (NX, NY, data, 0, NX-1, 0, NY-1, 0., NX, 0., NY,
+                      GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST);
+      break;
+    case 2:
+      /* drawn in two halves straight from the caller's rows */
+      giza_draw_argb32 (NX, NY, stride, data, 0, NX-1, 0, NY/2-1, 0., NX, 0., NY/2,
+                        GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST);
+      giza_draw_argb32 (NX, NY, stride, data, 0, NX-1, NY/2, NY-1, 0., NX, NY/2, NY,
+                        GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST);
+      break;
+    default:
+      /* misaligned rows have to be copied first */
+      memcpy (shifted + 1, data, (size_t) stride * NY);
+      giza_draw_argb32 (NX, NY, stride, shifted + 1, 0, NX-1, 0, NY-1, 0., NX, 0., NY,
+                        GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST);
+    }
+
+  return test_device_end (surface);
+}
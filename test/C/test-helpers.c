@@ -0,0 +1,153 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Fixtures and oracles shared by the tests that draw into cairo image
+ * surfaces */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+/* the context bound to giza by the last test_surface_begin */
+static cairo_t *test_cr = NULL;
+
+/**
+ * Opens a cairo device of width x height pixels and binds a new image
+ * surface of the same size to it; returns NULL if either fails.
+ * Finish with test_device_end.
+ */
+cairo_surface_t *
+test_device_begin (int width, int height)
+{
+  if (giza_open_device_size_cairo (width, height, GIZA_UNITS_PIXELS) <= 0)
+    return NULL;
+  return test_surface_begin (width, height);
+}
+
+/**
+ * Releases the surface from test_device_begin and closes the device,
+ * returning the surface ready to be read
+ */
+cairo_surface_t *
+test_device_end (cairo_surface_t *surface)
+{
+  giza_release_cairo_context ();
+  giza_close_device ();
+  if (test_cr)
+    cairo_destroy (test_cr);
+  test_cr = NULL;
+  if (surface)
+    cairo_surface_flush (surface);
+  return surface;
+}
+
+/**
+ * Binds a new ARGB32 image surface of width x height pixels to the cairo
+ * device already open, with the viewport covering all of it; returns NULL
+ * if giza does not accept it. Finish with test_surface_end.
+ */
+cairo_surface_t *
+test_surface_begin (int width, int height)
+{
+  cairo_surface_t *surface;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  test_cr = cairo_create (surface);
+  if (giza_set_cairo_context (test_cr) != 0)
+    {
+      cairo_destroy (test_cr);
+      test_cr = NULL;
+      cairo_surface_destroy (surface);
+      return NULL;
+    }
+  giza_set_viewport (0., 1., 0., 1.);
+  return surface;
+}
+
+/**
+ * Releases the surface from test_surface_begin, leaving the device open,
+ * and returns it ready to be read
+ */
+cairo_surface_t *
+test_surface_end (cairo_surface_t *surface)
+{
+  giza_release_cairo_context ();
+  if (test_cr)
+    cairo_destroy (test_cr);
+  test_cr = NULL;
+  if (surface)
+    cairo_surface_flush (surface);
+  return surface;
+}
+
+/**
+ * Returns 1 unless both surfaces exist and hold exactly the same pixels
+ */
+int
+test_surfaces_differ (cairo_surface_t *a, cairo_surface_t *b)
+{
+  int height;
+
+  if (!a || !b)
+    return 1;
+  height = cairo_image_surface_get_height (a);
+  if (cairo_image_surface_get_width (b) != cairo_image_surface_get_width (a)
+      || cairo_image_surface_get_height (b) != height
+      || cairo_image_surface_get_stride (b) != cairo_image_surface_get_stride (a))
+    return 1;
+  return memcmp (cairo_image_surface_get_data (a), cairo_image_surface_get_data (b),
+                 (size_t) cairo_image_surface_get_stride (a) * height) != 0;
+}
+
+/**
+ * The packed ARGB32 pixel at (x,y) of a surface; device y runs downwards
+ */
+uint32_t
+test_pixel (cairo_surface_t *surface, int x, int y)
+{
+  const unsigned char *pix = cairo_image_surface_get_data (surface);
+
+  return *(const uint32_t *) (pix + (size_t) y * cairo_image_surface_get_stride (surface)
+                              + 4 * (size_t) x);
+}
+
+/**
+ * Packed ARGB32 pixel that an opaque image gives a value, computed the
+ * long way round from the colour index range and representation; vmax
+ * may be below vmin to reverse the colours
+ */
+uint32_t
+test_expected_pixel (double val, double vmin, double vmax)
+{
+  double r, g, b, frac;
+  int cimin, cimax, ci;
+
+  giza_get_colour_index_range (&cimin, &cimax);
+  frac = (vmax > vmin) ? (fmin (vmax, fmax (vmin, val)) - vmin)/(vmax - vmin)
+                       : (fmin (vmin, fmax (vmax, val)) - vmax)/(vmin - vmax);
+  ci = cimin + (int) round ((cimax - cimin) * frac);
+  giza_get_colour_representation (ci, &r, &g, &b);
+
+  return ((uint32_t) 255 << 24)
+       | ((uint32_t) (unsigned char) (r * 255.) << 16)
+       | ((uint32_t) (unsigned char) (g * 255.) << 8)
+       |  (uint32_t) (unsigned char) (b * 255.);
+}
@@ -0,0 +1,38 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Fixtures and oracles shared by the tests that draw into cairo image
+ * surfaces, so each is written (and fixed) in one place */
+
+#ifndef GIZA_TEST_HELPERS_H
+#define GIZA_TEST_HELPERS_H
+
+#include <cairo/cairo.h>
+#include <stdint.h>
+
+cairo_surface_t *test_device_begin (int width, int height);
+cairo_surface_t *test_device_end (cairo_surface_t *surface);
+cairo_surface_t *test_surface_begin (int width, int height);
+cairo_surface_t *test_surface_end (cairo_surface_t *surface);
+
+int test_surfaces_differ (cairo_surface_t *a, cairo_surface_t *b);
+uint32_t test_pixel (cairo_surface_t *surface, int x, int y);
+uint32_t test_expected_pixel (double val, double vmin, double vmax);
+
+#endif
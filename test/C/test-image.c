@@ -0,0 +1,140 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that persistent images draw the same pixels as giza_render,
+ * as the colour table, colour index range, transfer function, colour mode
+ * and data change */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 60
+#define NY 50
+
+static int compare (int image, const double *data, int transparent, const char *what);
+
+int
+main (void)
+{
+  static double data[NX*NY];
+  double cp[2] = { 0., 1. }, red[2] = { 1., 0.2 }, green[2] = { 0., 0.9 };
+  int i, image, timage, failed = 0;
+
+  giza_start_warnings ();
+
+  /* one device throughout, as the settings belong to it */
+  if (giza_open_device_size_cairo (NX, NY, GIZA_UNITS_PIXELS) <= 0)
+    {
+      fprintf (stderr, "Error: giza_open_device_size_cairo failed\n");
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < NX*NY; i++)
+    data[i] = (i % NX) / (double) NX + 0.01 * (i / NX);
+
+  image = giza_image_create (NX, NY, data, 0, NX-1, 0, NY-1, 0.1, 0.9, 0);
+  timage = giza_image_create (NX, NY, data, 0, NX-1, 0, NY-1, 0.1, 0.9, 1);
+  if (image <= 0 || timage <= 0 || image == timage)
+    {
+      fprintf (stderr, "Error: giza_image_create failed\n");
+      return EXIT_FAILURE;
+    }
+
+  failed += compare (image, data, 0, "first draw");
+  failed += compare (image, data, 0, "redraw");
+  failed += compare (timage, data, 1, "transparent");
+
+  giza_set_colour_table (cp, red, green, cp, 2, 1., 0.5);
+  failed += compare (image, data, 0, "colour table");
+
+  giza_set_colour_index_range (20, 120);
+  failed += compare (image, data, 0, "colour index range");
+  failed += compare (timage, data, 1, "transparent colour index range");
+
+  giza_set_image_transfer_function (2);
+  failed += compare (image, data, 0, "transfer function");
+  giza_set_image_transfer_function (GIZA_ITF_ASINH);
+  failed += compare (image, data, 0, "asinh transfer function");
+  giza_set_image_transfer_function (GIZA_ITF_HISTEQ);
+  failed += compare (image, data, 0, "histogram equalisation");
+  failed += compare (timage, data, 1, "transparent histogram equalisation");
+  giza_set_image_transfer_function (2);
+
+  giza_set_image_colour_mode (GIZA_COLOUR_MODE_CONTINUOUS);
+  failed += compare (image, data, 0, "continuous colour mode");
+  failed += compare (timage, data, 1, "transparent continuous colour mode");
+  giza_set_colour_table (cp, green, red, cp, 2, 1., 0.5);
+  failed += compare (image, data, 0, "continuous colour table");
+  giza_set_image_colour_mode (GIZA_COLOUR_MODE_INDEXED);
+  failed += compare (image, data, 0, "indexed colour mode");
+
+  for (i = 0; i < NX*NY; i++)
+    data[i] = 1. - data[i];
+  giza_image_update (image, NX, NY, data, 0, NX-1, 0, NY-1, 0.1, 0.9);
+  failed += compare (image, data, 0, "update");
+
+  giza_image_destroy (image);
+  giza_image_destroy (timage);
+  if (giza_image_create (NX, NY, data, 0, NX-1, 0, NY-1, 0.1, 0.9, 0) != image)
+    {
+      fprintf (stderr, "Error: destroyed image handle was not reused\n");
+      failed++;
+    }
+
+  giza_close_device ();
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* draws the image and renders the data on separate surfaces, and compares them */
+static int
+compare (int image, const double *data, int transparent, const char *what)
+{
+  cairo_surface_t *surface[2];
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+  int k, failed = 0;
+
+  for (k = 0; k < 2; k++)
+    {
+      surface[k] = test_surface_begin (NX, NY);
+      giza_set_window (0., NX, 0., NY);
+
+      if (k == 0)
+        giza_image_draw (image, GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+      else if (transparent)
+        giza_render_transparent (NX, NY, data, 0, NX-1, 0, NY-1, 0.1, 0.9,
+                                 GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+      else
+        giza_render (NX, NY, data, 0, NX-1, 0, NY-1, 0.1, 0.9,
+                     GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+
+      test_surface_end (surface[k]);
+    }
+
+  if (test_surfaces_differ (surface[0], surface[1]))
+    {
+      fprintf (stderr, "%s: image differs from giza_render\n", what);
+      failed++;
+    }
+  cairo_surface_destroy (surface[0]);
+  cairo_surface_destroy (surface[1]);
+  return failed;
+}
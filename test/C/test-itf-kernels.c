@@ -0,0 +1,278 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that the row (SIMD) image transfer function kernels give exactly
+ * the same colour indices as the scalar giza_itf_idx routines, that
+ * transfer functions applied through a table (registered functions and
+ * histogram equalisation) look up the right entries, and that the row
+ * kernels finding blank values find NaNs and the blank value */
+
+#include "giza-itf.h"
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NVAL 1031
+
+typedef struct
+{
+  double vmin, vmax;
+  int cimin, cimax;
+} itf_range_t;
+
+static void fill_values (const itf_range_t *r, double *dval, float *fval);
+static int check_range (int level, int itf, const itf_range_t *r,
+                        const double *dval, const float *fval, int off, int n);
+static int check_blank (int level, double blank, const double *dval, const float *fval,
+                        int off, int n);
+static int check_lut (void);
+static double square (double f, void *user);
+
+int
+main (void)
+{
+  static itf_range_t const ranges[] = {
+    { 0.,    1.,    16,  271 },
+    { 1.,    0.,    16,  271 },
+    { -3.5,  250.,  0,   255 },
+    { 2.,    -7.,   20,  30 },
+    { 0.,    1.,    100, 10 },
+    { 1e-12, 3e-12, 16,  271 },
+    { 0.,    1.,    5,   5 },
+  };
+  static double dval[NVAL];
+  static float  fval[NVAL];
+  int level, maxlevel, itf;
+  size_t r;
+  int failed = 0;
+
+  maxlevel = _giza_itf_set_simd_level (-1);
+  for (level = GIZA_ITF_SIMD_NONE; level <= maxlevel; level++)
+    {
+      _giza_itf_set_simd_level (level);
+      for (r = 0; r < sizeof (ranges) / sizeof (ranges[0]); r++)
+        {
+          fill_values (&ranges[r], dval, fval);
+          for (itf = GIZA_ITF_LINEAR; itf <= GIZA_ITF_ASINH; itf++)
+            {
+              /* whole rows, and rows that are neither aligned nor a
+               * multiple of the vector length */
+              failed += check_range (level, itf, &ranges[r], dval, fval, 0, NVAL);
+              failed += check_range (level, itf, &ranges[r], dval, fval, 3, NVAL - 8);
+              failed += check_range (level, itf, &ranges[r], dval, fval, 1, 5);
+            }
+          failed += check_blank (level, NAN, dval, fval, 0, NVAL);
+          failed += check_blank (level, dval[20], dval, fval, 0, NVAL);
+          failed += check_blank (level, ranges[r].vmin, dval, fval, 3, NVAL - 8);
+        }
+    }
+
+  _giza_itf_set_simd_level (-1);
+  failed += check_lut ();
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* values spanning and overshooting the range, including ones that land
+ * close to half way between two colour indices, and special values */
+static void
+fill_values (const itf_range_t *r, double *dval, float *fval)
+{
+  double span = r->vmax - r->vmin;
+  int ncol = abs (r->cimax - r->cimin);
+  int i;
+
+  for (i = 0; i < NVAL; i++)
+    {
+      if (i % 3 == 0 && ncol > 0)
+        dval[i] = r->vmin + span * ((i / 3) % ncol + 0.5) / ncol;
+      else
+        dval[i] = r->vmin + span * (-0.25 + 1.5 * i / (NVAL - 1.));
+    }
+  dval[2] = NAN;
+  dval[4] = INFINITY;
+  dval[5] = -INFINITY;
+  dval[7] = r->vmin;
+  dval[8] = r->vmax;
+  dval[11] = -0.;
+
+  for (i = 0; i < NVAL; i++)
+    fval[i] = (float) dval[i];
+}
+
+static int
+check_range (int level, int itf, const itf_range_t *r,
+             const double *dval, const float *fval, int off, int n)
+{
+  static int idx[NVAL], idx_f[NVAL];
+  int i, want, failed = 0;
+
+  _giza_itf_idx_row (itf, NULL, dval + off, n, r->vmin, r->vmax, r->cimin, r->cimax, idx);
+  _giza_itf_idx_row_f (itf, NULL, fval + off, n, (float) r->vmin, (float) r->vmax,
+                       r->cimin, r->cimax, idx_f);
+
+  for (i = 0; i < n; i++)
+    {
+      want = giza_itf_idx[itf] (dval[off + i], r->vmin, r->vmax, r->cimin, r->cimax);
+      if (idx[i] != want)
+        {
+          fprintf (stderr, "level %d itf %d: value %.17g in [%g,%g] gave %d, expected %d\n",
+                   level, itf, dval[off + i], r->vmin, r->vmax, idx[i], want);
+          failed++;
+        }
+      want = giza_itf_idx_f[itf] (fval[off + i], (float) r->vmin, (float) r->vmax,
+                                  r->cimin, r->cimax);
+      if (idx_f[i] != want)
+        {
+          fprintf (stderr, "level %d itf %d (float): value %.9g in [%g,%g] gave %d, expected %d\n",
+                   level, itf, fval[off + i], r->vmin, r->vmax, idx_f[i], want);
+          failed++;
+        }
+    }
+  return failed;
+}
+
+static int
+check_blank (int level, double blank, const double *dval, const float *fval, int off, int n)
+{
+  static unsigned char blanked[NVAL], blanked_f[NVAL];
+  int i, want, nblank, nblank_f, nwant = 0, nwant_f = 0, failed = 0;
+
+  nblank = _giza_itf_blank_row (dval + off, n, blank, blanked);
+  nblank_f = _giza_itf_blank_row_f (fval + off, n, (float) blank, blanked_f);
+
+  for (i = 0; i < n; i++)
+    {
+      want = isnan (dval[off + i]) || dval[off + i] == blank;
+      nwant += want;
+      if (blanked[i] != want)
+        {
+          fprintf (stderr, "level %d: value %.17g with blank %g flagged %d, expected %d\n",
+                   level, dval[off + i], blank, blanked[i], want);
+          failed++;
+        }
+      want = isnan (fval[off + i]) || fval[off + i] == (float) blank;
+      nwant_f += want;
+      if (blanked_f[i] != want)
+        {
+          fprintf (stderr, "level %d (float): value %.9g with blank %g flagged %d, expected %d\n",
+                   level, fval[off + i], blank, blanked_f[i], want);
+          failed++;
+        }
+    }
+  if (nblank != nwant || nblank_f != nwant_f)
+    {
+      fprintf (stderr, "level %d: %d and %d blanks counted, expected %d and %d\n",
+               level, nblank, nblank_f, nwant, nwant_f);
+      failed++;
+    }
+  return failed;
+}
+
+static double
+square (double f, void *user)
+{
+  return *(const double *) user * f * f;
+}
+
+static int
+check_lut (void)
+{
+  static double dval[NVAL], lut[GIZA_ITF_LUT_SIZE];
+  static size_t hist[GIZA_ITF_LUT_SIZE];
+  static int idx[NVAL];
+  static float fval[NVAL];
+  double scale = 1., want;
+  int i, k, itf, nlow, failed = 0;
+
+  /* a registered function is sampled in the middle of each bin */
+  itf = giza_register_image_transfer_function (square, &scale);
+  if (itf <= GIZA_ITF_HISTEQ || !_giza_itf_uses_lut (itf) || !_giza_itf_lut (itf, NULL, lut))
+    {
+      fprintf (stderr, "registered transfer function %d has no table\n", itf);
+      return 1;
+    }
+  for (k = 0; k < GIZA_ITF_LUT_SIZE; k++)
+    {
+      want = (k + 0.5)/GIZA_ITF_LUT_SIZE;
+      if (lut[k] != want*want)
+        {
+          fprintf (stderr, "registered table entry %d is %g, expected %g\n", k, lut[k], want*want);
+          failed++;
+          break;
+        }
+    }
+  for (i = 0; i < NVAL; i++)
+    {
+      dval[i] = -0.1 + 1.2 * i / (NVAL - 1.);
+      fval[i] = (float) dval[i];
+    }
+  dval[2] = NAN;
+  fval[2] = NAN;
+  _giza_itf_idx_row (itf, lut, dval, NVAL, 0., 1., 16, 271, idx);
+  for (i = 0; i < NVAL; i++)
+    {
+      if (i == 2)
+        continue;
+      k = (dval[i] <= 0.) ? 0 : (dval[i] >= 1.) ? GIZA_ITF_LUT_SIZE - 1
+                                                : (int) (dval[i] * GIZA_ITF_LUT_SIZE);
+      if (idx[i] != 16 + (int) round (255. * lut[k]))
+        {
+          fprintf (stderr, "registered function: value %g gave %d, expected %d\n",
+                   dval[i], idx[i], 16 + (int) round (255. * lut[k]));
+          failed++;
+        }
+    }
+  _giza_itf_idx_row_f (itf, lut, fval, NVAL, 0.f, 1.f, 16, 271, idx);
+  for (i = 0; i < NVAL; i++)
+    if (idx[i] < 16 || idx[i] > 271)
+      {
+        fprintf (stderr, "registered function (float): value %g gave %d\n", fval[i], idx[i]);
+        failed++;
+      }
+
+  /* histogram equalisation of skewed data uses the colours evenly */
+  for (i = 0; i < NVAL; i++)
+    dval[i] = exp (6. * i / (NVAL - 1.));
+  dval[5] = NAN;
+  _giza_itf_hist_row (dval, NVAL, 1., exp (6.), NULL, hist);
+  if (_giza_itf_lut (GIZA_ITF_HISTEQ, NULL, lut) || !_giza_itf_lut (GIZA_ITF_HISTEQ, hist, lut))
+    {
+      fprintf (stderr, "histogram equalisation should need a histogram\n");
+      return failed + 1;
+    }
+  for (k = 1; k < GIZA_ITF_LUT_SIZE; k++)
+    if (lut[k] < lut[k-1])
+      {
+        fprintf (stderr, "histogram equalisation table decreases at %d\n", k);
+        failed++;
+        break;
+      }
+  _giza_itf_idx_row (GIZA_ITF_HISTEQ, lut, dval, NVAL, 1., exp (6.), 0, 100, idx);
+  nlow = 0;
+  for (i = 0; i < NVAL; i++)
+    nlow += (i != 5 && idx[i] < 50);
+  if (idx[0] != 0 || idx[NVAL-1] != 100 || abs (2*nlow - (NVAL - 1)) > NVAL/20)
+    {
+      fprintf (stderr, "histogram equalisation gave %d to %d with %d of %d values in the lower half\n",
+               idx[0], idx[NVAL-1], nlow, NVAL - 1);
+      failed++;
+    }
+  return failed;
+}
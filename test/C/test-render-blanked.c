@@ -0,0 +1,130 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that giza_render_blanked leaves NaNs, blank values and masked
+ * pixels fully transparent and colours the rest as giza_render does */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 90
+#define NY 70
+#define BLANK -999.
+
+static cairo_surface_t *draw (int variant, const double *data, const float *fdata,
+                              const unsigned char *mask);
+
+int
+main (void)
+{
+  static double data[NX*NY];
+  static float fdata[NX*NY];
+  static unsigned char mask[(NX*NY + 7)/8];
+  cairo_surface_t *want[2], *got;
+  const uint32_t *w, *g;
+  int i, j, k, variant, blank, failed = 0;
+
+  giza_start_warnings ();
+
+  if (giza_open_device_size_cairo (NX, NY, GIZA_UNITS_PIXELS) <= 0)
+    {
+      fprintf (stderr, "Error: giza_open_device_size_cairo failed\n");
+      return EXIT_FAILURE;
+    }
+
+  for (k = 0; k < NX*NY; k++)
+    {
+      data[k] = sin (0.1 * k);
+      if (k % 13 == 0)
+        data[k] = NAN;
+      else if (k % 17 == 0)
+        data[k] = BLANK;
+      fdata[k] = (float) data[k];
+      if ((k / NX) % 5 != 2 && k % 11 != 0)
+        mask[k >> 3] |= (unsigned char) (1 << (k & 7));
+    }
+
+  want[0] = draw (0, data, fdata, NULL);
+  want[1] = draw (5, data, fdata, NULL);
+  for (variant = 1; variant <= 4; variant++)
+    {
+      got = draw (variant, data, fdata, (variant % 2) ? mask : NULL);
+      for (j = 0; j < NY; j++)
+        {
+          /* rows in the surface run from the top of the image down */
+          w = (const uint32_t *) (cairo_image_surface_get_data (want[variant > 2])
+                                  + (NY-1-j) * cairo_image_surface_get_stride (got));
+          g = (const uint32_t *) (cairo_image_surface_get_data (got)
+                                  + (NY-1-j) * cairo_image_surface_get_stride (got));
+          for (i = 0; i < NX; i++)
+            {
+              k = j*NX + i;
+              blank = isnan (data[k]) || data[k] == BLANK
+                      || ((variant % 2) && !(mask[k >> 3] & (1 << (k & 7))));
+              if (g[i] != (blank ? 0u : w[i]))
+                {
+                  fprintf (stderr, "Error: variant %d pixel (%d,%d) is %08x, expected %08x\n",
+                           variant, i, j, (unsigned) g[i], blank ? 0u : (unsigned) w[i]);
+                  failed++;
+                  j = NY;
+                  break;
+                }
+            }
+        }
+      cairo_surface_destroy (got);
+    }
+  cairo_surface_destroy (want[0]);
+  cairo_surface_destroy (want[1]);
+
+  giza_close_device ();
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* giza_render_blanked with doubles (variants 1, 2) or floats (3, 4), or
+ * giza_render (0) or giza_render_float (5) to compare them with */
+static cairo_surface_t *
+draw (int variant, const double *data, const float *fdata, const unsigned char *mask)
+{
+  cairo_surface_t *surface;
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+  float faffine[6] = { 1.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+
+  surface = test_surface_begin (NX, NY);
+  giza_set_window (0., NX, 0., NY);
+
+  if (variant == 0)
+    giza_render (NX, NY, data, 0, NX-1, 0, NY-1, -1., 1.,
+                 GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+  else if (variant == 5)
+    giza_render_float (NX, NY, fdata, 0, NX-1, 0, NY-1, -1.f, 1.f,
+                       GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, faffine);
+  else if (variant <= 2)
+    giza_render_blanked (NX, NY, data, mask, BLANK, 0, NX-1, 0, NY-1, -1., 1.,
+                         GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+  else
+    giza_render_blanked_float (NX, NY, fdata, mask, (float) BLANK, 0, NX-1, 0, NY-1,
+                               -1.f, 1.f, GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, faffine);
+
+  return test_surface_end (surface);
+}
@@ -0,0 +1,126 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that images in continuous colour mode are coloured straight from
+ * the colour table, without being limited to the colour index range */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 1024
+#define NY 4
+
+static cairo_surface_t *draw (const double *data, int mode);
+static int count_colours (cairo_surface_t *surface);
+
+int
+main (void)
+{
+  static double data[NX*NY];
+  double cp[3] = { 0., 0.3, 1. }, red[3] = { 0., 1., 0.2 }, green[3] = { 0., 0.5, 1. };
+  double blue[3] = { 1., 0., 0.5 }, r, g, b;
+  cairo_surface_t *surface;
+  const uint32_t *row;
+  uint32_t want;
+  int i, k, n, failed = 0;
+
+  giza_start_warnings ();
+
+  if (giza_open_device_size_cairo (NX, NY, GIZA_UNITS_PIXELS) <= 0)
+    {
+      fprintf (stderr, "Error: giza_open_device_size_cairo failed\n");
+      return EXIT_FAILURE;
+    }
+  giza_set_colour_table (cp, red, green, blue, 3, 1., 0.5);
+  giza_set_colour_index_range (16, 31);
+
+  for (i = 0; i < NX*NY; i++)
+    data[i] = (i % NX) / (NX - 1.);
+
+  surface = draw (data, GIZA_COLOUR_MODE_INDEXED);
+  n = count_colours (surface);
+  if (n > 16)
+    {
+      fprintf (stderr, "Error: %d colours from 16 colour indices\n", n);
+      failed++;
+    }
+  cairo_surface_destroy (surface);
+
+  surface = draw (data, GIZA_COLOUR_MODE_CONTINUOUS);
+  n = count_colours (surface);
+  if (n < 500)
+    {
+      fprintf (stderr, "Error: only %d colours in continuous colour mode\n", n);
+      failed++;
+    }
+
+  /* each pixel is the table colour at its value, to the table resolution */
+  row = (const uint32_t *) cairo_image_surface_get_data (surface);
+  for (i = 0; i < NX; i++)
+    {
+      k = (int) (data[i] * 4095. + 0.5);
+      giza_rgb_from_table (k / 4095., &r, &g, &b);
+      want = 0xff000000u | ((uint32_t) (unsigned char) (r * 255.) << 16)
+           | ((uint32_t) (unsigned char) (g * 255.) << 8) | (unsigned char) (b * 255.);
+      if (row[i] != want)
+        {
+          fprintf (stderr, "Error: pixel %d is %08x, expected %08x\n", i,
+                   (unsigned) row[i], (unsigned) want);
+          failed++;
+          break;
+        }
+    }
+  cairo_surface_destroy (surface);
+
+  giza_close_device ();
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static cairo_surface_t *
+draw (const double *data, int mode)
+{
+  cairo_surface_t *surface;
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+
+  surface = test_surface_begin (NX, NY);
+  giza_set_window (0., NX, 0., NY);
+  giza_set_image_colour_mode (mode);
+
+  giza_render (NX, NY, data, 0, NX-1, 0, NY-1, 0., 1.,
+               GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+
+  return test_surface_end (surface);
+}
+
+/* the number of different colours along the first row */
+static int
+count_colours (cairo_surface_t *surface)
+{
+  const uint32_t *row = (const uint32_t *) cairo_image_surface_get_data (surface);
+  int i, n = 1;
+
+  for (i = 1; i < NX; i++)
+    if (row[i] != row[i-1])
+      n++;
+  return n;
+}
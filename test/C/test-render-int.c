@@ -0,0 +1,143 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that integer images are coloured exactly as the same values
+ * given to giza_render as doubles, both for images large enough to be
+ * coloured from a table of every value and for small ones */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 400
+#define NY 300
+
+static cairo_surface_t *draw (int type, int itf, int nx, int ny, const void *data,
+                              double vmin, double vmax);
+
+int
+main (void)
+{
+  static const char *names[] = { "double", "float", "u8", "u16", "i16", "i32" };
+  static double dval[NX*NY];
+  static unsigned char u8[NX*NY];
+  static unsigned short u16[NX*NY];
+  static short i16[NX*NY];
+  static int i32[NX*NY];
+  const void *data[6];
+  double vmin[6], vmax[6];
+  cairo_surface_t *want, *got;
+  int i, type, itf, small, nx, ny, failed = 0;
+
+  giza_start_warnings ();
+
+  data[GIZA_DATA_U8] = u8;
+  data[GIZA_DATA_U16] = u16;
+  data[GIZA_DATA_I16] = i16;
+  data[GIZA_DATA_I32] = i32;
+  vmin[GIZA_DATA_U8] = 10.;     vmax[GIZA_DATA_U8] = 200.;
+  vmin[GIZA_DATA_U16] = 100.;   vmax[GIZA_DATA_U16] = 30000.;
+  vmin[GIZA_DATA_I16] = -2000.; vmax[GIZA_DATA_I16] = 30000.;
+  vmin[GIZA_DATA_I32] = 1.;     vmax[GIZA_DATA_I32] = 6.e7;
+
+  for (itf = 0; itf < 3; itf++)
+    {
+      giza_set_num_threads (1 + itf);
+      for (type = GIZA_DATA_U8; type <= GIZA_DATA_I32; type++)
+        {
+          for (small = 0; small < 2; small++)
+            {
+              nx = small ? 50 : NX;
+              ny = small ? 40 : NY;
+              for (i = 0; i < nx*ny; i++)
+                {
+                  long v = (long) ((i * 7919L) % 65536);
+                  switch (type)
+                    {
+                    case GIZA_DATA_U8:
+                      u8[i] = (unsigned char) (v & 255);
+                      dval[i] = u8[i];
+                      break;
+                    case GIZA_DATA_U16:
+                      u16[i] = (unsigned short) v;
+                      dval[i] = u16[i];
+                      break;
+                    case GIZA_DATA_I16:
+                      i16[i] = (short) (v - 32768);
+                      dval[i] = i16[i];
+                      break;
+                    default:
+                      i32[i] = (int) (v * 1000 - 5000000);
+                      dval[i] = i32[i];
+                    }
+                }
+
+              want = draw (GIZA_DATA_DOUBLE, itf, nx, ny, dval, vmin[type], vmax[type]);
+              got = draw (type, itf, nx, ny, data[type], vmin[type], vmax[type]);
+              if (test_surfaces_differ (want, got))
+                {
+                  fprintf (stderr, "Error: %s image (%dx%d, itf %d) differs from %s\n",
+                           names[type], nx, ny, itf, names[GIZA_DATA_DOUBLE]);
+                  failed++;
+                }
+              cairo_surface_destroy (want);
+              cairo_surface_destroy (got);
+            }
+        }
+    }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static cairo_surface_t *
+draw (int type, int itf, int nx, int ny, const void *data, double vmin, double vmax)
+{
+  cairo_surface_t *surface;
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+
+  surface = test_device_begin (nx, ny);
+  giza_set_window (0., nx, 0., ny);
+  giza_set_image_transfer_function (itf);
+
+  switch (type)
+    {
+    case GIZA_DATA_U8:
+      giza_render_u8 (nx, ny, data, 0, nx-1, 0, ny-1, vmin, vmax,
+                      GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+      break;
+    case GIZA_DATA_U16:
+      giza_render_u16 (nx, ny, data, 0, nx-1, 0, ny-1, vmin, vmax,
+                       GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+      break;
+    case GIZA_DATA_I16:
+      giza_render_i16 (nx, ny, data, 0, nx-1, 0, ny-1, vmin, vmax,
+                       GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+      break;
+    case GIZA_DATA_I32:
+      giza_render_i32 (nx, ny, data, 0, nx-1, 0, ny-1, vmin, vmax,
+                       GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+      break;
+    default:
+      giza_render (nx, ny, data, 0, nx-1, 0, ny-1, vmin, vmax,
+                   GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+    }
+
+  return test_device_end (surface);
+}
@@ -0,0 +1,160 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that histogram equalisation and registered transfer functions
+ * colour double, float and 16 bit data alike, with and without blanks (and
+ * asinh double and 16 bit data; floats use single precision arithmetic),
+ * and that a registered function decides the colour of every pixel */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 320
+#define NY 240
+
+static cairo_surface_t *draw (int type, int itf, const void *data, const unsigned char *mask);
+static double top (double f, void *user);
+static double power (double f, void *user);
+
+int
+main (void)
+{
+  static const char *names[] = { "double", "float", "u8", "u16" };
+  static double dval[NX*NY];
+  static float fval[NX*NY];
+  static unsigned short u16[NX*NY];
+  static unsigned char mask[(NX*NY + 7)/8];
+  const void *data[4];
+  cairo_surface_t *want, *got;
+  const uint32_t *pix;
+  double gamma = 2.5;
+  int i, t, m, itf[3], type, failed = 0;
+
+  giza_start_warnings ();
+
+  /* skewed data, as histogram equalisation is meant for */
+  for (i = 0; i < NX*NY; i++)
+    {
+      u16[i] = (unsigned short) ((unsigned long) i * i % 4093 * (i % 7 + 1) % 30000);
+      dval[i] = u16[i];
+      fval[i] = (float) u16[i];
+      if (i % 11 != 4)
+        mask[i >> 3] |= (unsigned char) (1 << (i & 7));
+    }
+  data[GIZA_DATA_DOUBLE] = dval;
+  data[GIZA_DATA_FLOAT] = fval;
+  data[GIZA_DATA_U16] = u16;
+
+  itf[0] = GIZA_ITF_ASINH;
+  itf[1] = GIZA_ITF_HISTEQ;
+  itf[2] = giza_register_image_transfer_function (power, &gamma);
+  if (itf[2] <= GIZA_ITF_HISTEQ)
+    {
+      fprintf (stderr, "Error: could not register a transfer function\n");
+      return EXIT_FAILURE;
+    }
+
+  for (t = 0; t < 3; t++)
+    for (m = 0; m < 2; m++)
+      {
+        want = draw (GIZA_DATA_DOUBLE, itf[t], dval, m ? mask : NULL);
+        for (type = GIZA_DATA_FLOAT; type <= GIZA_DATA_U16; type++)
+          {
+            if (type == GIZA_DATA_U8 || (m && type == GIZA_DATA_U16)
+                || (type == GIZA_DATA_FLOAT && itf[t] == GIZA_ITF_ASINH))
+              continue;
+            got = draw (type, itf[t], data[type], m ? mask : NULL);
+            if (test_surfaces_differ (want, got))
+              {
+                fprintf (stderr, "Error: %s image with transfer function %d%s differs from double\n",
+                         names[type], itf[t], m ? " and a mask" : "");
+                failed++;
+              }
+            cairo_surface_destroy (got);
+          }
+        cairo_surface_destroy (want);
+      }
+
+  /* every pixel takes the colour the registered function gives */
+  t = giza_register_image_transfer_function (top, NULL);
+  want = draw (GIZA_DATA_DOUBLE, t, dval, NULL);
+  pix = (const uint32_t *) cairo_image_surface_get_data (want);
+  for (i = 1; i < NX; i++)
+    if (pix[i] != pix[0])
+      {
+        fprintf (stderr, "Error: registered function did not give one colour\n");
+        failed++;
+        break;
+      }
+  cairo_surface_destroy (want);
+
+  if (giza_register_image_transfer_function (NULL, NULL) != -1)
+    {
+      fprintf (stderr, "Error: registering no function should fail\n");
+      failed++;
+    }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static double
+top (double f, void *user)
+{
+  return 1.;
+}
+
+static double
+power (double f, void *user)
+{
+  return pow (f, *(const double *) user);
+}
+
+static cairo_surface_t *
+draw (int type, int itf, const void *data, const unsigned char *mask)
+{
+  cairo_surface_t *surface;
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+  float affine_f[6] = { 1.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+
+  surface = test_device_begin (NX, NY);
+  giza_set_window (0., NX, 0., NY);
+  giza_set_image_transfer_function (itf);
+
+  if (type == GIZA_DATA_U16)
+    giza_render_u16 (NX, NY, data, 0, NX-1, 0, NY-1, 100., 25000.,
+                     GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+  else if (type == GIZA_DATA_FLOAT && mask)
+    giza_render_blanked_float (NX, NY, data, mask, -1.f, 0, NX-1, 0, NY-1, 100.f, 25000.f,
+                               GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine_f);
+  else if (type == GIZA_DATA_FLOAT)
+    giza_render_float (NX, NY, data, 0, NX-1, 0, NY-1, 100.f, 25000.f,
+                       GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine_f);
+  else if (mask)
+    giza_render_blanked (NX, NY, data, mask, -1., 0, NX-1, 0, NY-1, 100., 25000.,
+                         GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+  else
+    giza_render (NX, NY, data, 0, NX-1, 0, NY-1, 100., 25000.,
+                 GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+
+  return test_device_end (surface);
+}
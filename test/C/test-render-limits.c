@@ -0,0 +1,176 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that the percentile limits from giza_get_render_limits are the
+ * values found by sorting the data that are not blanked, over windows of
+ * the data and with several threads */
+
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 300
+#define NY 200
+#define BLANK -999.
+
+static int cmp (const void *a, const void *b);
+static int check (const char *name, int type, const void *data, const double *dval,
+                  const unsigned char *mask, double blank,
+                  int i1, int i2, int j1, int j2, double pmin, double pmax);
+
+int
+main (void)
+{
+  static double dval[NX*NY];
+  static float fval[NX*NY];
+  static short i16[NX*NY];
+  static unsigned char mask[(NX*NY + 7)/8];
+  static const double pct[][2] = { { 0., 100. }, { 1., 99. }, { 0.5, 99.5 }, { 50., 50. }, { 25., 75. } };
+  int i, p, nthreads, failed = 0;
+
+  giza_start_warnings ();
+
+  for (i = 0; i < NX*NY; i++)
+    {
+      /* a long tail, some repeated values and a few that are left out */
+      unsigned long r = (unsigned long) i * 2654435761UL % 1000003UL;
+      dval[i] = (r % 17 == 0) ? (double) (r % 5) : exp ((double) r / 1.e5) - 3.;
+      if (r % 101 == 0)
+        dval[i] = NAN;
+      else if (r % 103 == 0)
+        dval[i] = BLANK;
+      else if (r % 107 == 0)
+        dval[i] = INFINITY;
+      fval[i] = (float) dval[i];
+      i16[i] = (short) ((long) (r % 40000) - 20000);
+      if (i % 5 != 3)
+        mask[i >> 3] |= (unsigned char) (1 << (i & 7));
+    }
+
+  for (nthreads = 1; nthreads <= 4; nthreads += 3)
+    {
+      giza_set_num_threads (nthreads);
+      for (p = 0; p < (int) (sizeof (pct)/sizeof (pct[0])); p++)
+        {
+          failed += check ("double", GIZA_DATA_DOUBLE, dval, dval, NULL, BLANK,
+                           0, NX-1, 0, NY-1, pct[p][0], pct[p][1]);
+          failed += check ("masked double", GIZA_DATA_DOUBLE, dval, dval, mask, NAN,
+                           0, NX-1, 0, NY-1, pct[p][0], pct[p][1]);
+          failed += check ("double window", GIZA_DATA_DOUBLE, dval, dval, mask, BLANK,
+                           17, 250, 3, 180, pct[p][0], pct[p][1]);
+          failed += check ("float", GIZA_DATA_FLOAT, fval, dval, NULL, BLANK,
+                           5, NX-1, 10, NY-1, pct[p][0], pct[p][1]);
+          failed += check ("i16", GIZA_DATA_I16, i16, NULL, mask, -20000.,
+                           0, NX-1, 0, NY-1, pct[p][0], pct[p][1]);
+        }
+    }
+
+  /* the float interface gives the same as float data through the typed one */
+  {
+    float fmin, fmax;
+    double vmin, vmax;
+
+    if (giza_get_render_limits_float (NX, NY, fval, mask, (float) BLANK, 0, NX-1, 0, NY-1,
+                                      1.f, 99.f, &fmin, &fmax) != 0
+        || giza_get_render_limits_typed (NX, NY, GIZA_DATA_FLOAT, fval, mask, BLANK,
+                                         0, NX-1, 0, NY-1, 1., 99., &vmin, &vmax) != 0
+        || fmin != (float) vmin || fmax != (float) vmax)
+      {
+        fprintf (stderr, "Error: giza_get_render_limits_float differs from the typed limits\n");
+        failed++;
+      }
+  }
+
+  /* data that are all the same, and data that are all left out */
+  {
+    double flat[12] = { 3., 3., 3., 3., 3., 3., 3., 3., 3., 3., 3., 3. };
+    double vmin, vmax;
+
+    if (giza_get_render_limits (4, 3, flat, NULL, NAN, 0, 3, 0, 2, 5., 95., &vmin, &vmax) != 0
+        || vmin != 3. || vmax != 3.)
+      {
+        fprintf (stderr, "Error: limits of constant data should both be 3\n");
+        failed++;
+      }
+    if (giza_get_render_limits (4, 3, flat, NULL, 3., 0, 3, 0, 2, 5., 95., &vmin, &vmax) == 0)
+      {
+        fprintf (stderr, "Error: limits of data that are all blank should fail\n");
+        failed++;
+      }
+  }
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int
+cmp (const void *a, const void *b)
+{
+  double x = *(const double *) a, y = *(const double *) b;
+  return (x > y) - (x < y);
+}
+
+/* compares the limits with those found by sorting the values that count */
+static int
+check (const char *name, int type, const void *data, const double *dval,
+       const unsigned char *mask, double blank,
+       int i1, int i2, int j1, int j2, double pmin, double pmax)
+{
+  static double sorted[NX*NY];
+  double v, vmin, vmax, want[2];
+  size_t n = 0, k;
+  int i, j;
+
+  for (j = j1; j <= j2; j++)
+    for (i = i1; i <= i2; i++)
+      {
+        k = (size_t) j * NX + i;
+        switch (type)
+          {
+          case GIZA_DATA_FLOAT:
+            v = ((const float *) data)[k];
+            break;
+          case GIZA_DATA_I16:
+            v = ((const short *) data)[k];
+            break;
+          default:
+            v = dval[k];
+          }
+        if (!isfinite (v) || v == blank || (mask && !(mask[k >> 3] & (1 << (k & 7)))))
+          continue;
+        sorted[n++] = v;
+      }
+  qsort (sorted, n, sizeof (double), cmp);
+  want[0] = sorted[(size_t) floor (pmin/100. * (double) (n - 1) + 0.5)];
+  want[1] = sorted[(size_t) floor (pmax/100. * (double) (n - 1) + 0.5)];
+
+  if (giza_get_render_limits_typed (NX, NY, type, data, mask, blank, i1, i2, j1, j2,
+                                    pmin, pmax, &vmin, &vmax) != 0)
+    {
+      fprintf (stderr, "Error: %s limits failed\n", name);
+      return 1;
+    }
+  if (vmin != want[0] || vmax != want[1])
+    {
+      fprintf (stderr, "Error: %s limits at %g%% and %g%% are %g, %g; should be %g, %g\n",
+               name, pmin, pmax, vmin, vmax, want[0], want[1]);
+      return 1;
+    }
+  return 0;
+}
@@ -0,0 +1,107 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks the pixels written by giza_render against the colour
+ * representation of the index chosen by the image transfer function */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#define NX 4
+#define NY 4
+#define CELL 10
+
+static int check_cells (cairo_surface_t *surface, const double *data,
+                        double vmin, double vmax, const char *what);
+
+int
+main (void)
+{
+  cairo_surface_t *surface;
+  double data[NX*NY], alpha[NX*NY], affine[6];
+  double cp[2], ramp[2];
+  int i, failed = 0;
+
+  giza_start_warnings ();
+
+  surface = test_device_begin (NX*CELL, NY*CELL);
+  if (!surface)
+    {
+      fprintf (stderr, "Error: could not draw on a cairo device\n");
+      return EXIT_FAILURE;
+    }
+  giza_set_window (0., NX, 0., NY);
+
+  cp[0] = 0.; ramp[0] = 0.1;
+  cp[1] = 1.; ramp[1] = 0.9;
+  giza_set_colour_table (cp, ramp, cp, ramp, 2, 1., 0.5);
+
+  for (i = 0; i < NX*NY; i++)
+    {
+      data[i]  = -0.2 + 1.4 * i / (double) (NX*NY - 1);
+      alpha[i] = 1.;
+    }
+
+  affine[0] = 1.; affine[1] = 0.;
+  affine[2] = 0.; affine[3] = 1.;
+  affine[4] = 0.; affine[5] = 0.;
+
+  giza_render (NX, NY, data, 0, NX-1, 0, NY-1, 0., 1.,
+               GIZA_EXTEND_PAD, GIZA_FILTER_NEAREST, affine);
+  failed += check_cells (surface, data, 0., 1., "giza_render");
+
+  giza_render_alpha (NX, NY, data, alpha, 0, NX-1, 0, NY-1, 1., 0.,
+                     GIZA_EXTEND_PAD, GIZA_FILTER_NEAREST, affine);
+  failed += check_cells (surface, data, 1., 0., "giza_render_alpha");
+
+  cairo_surface_destroy (test_device_end (surface));
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int
+check_cells (cairo_surface_t *surface, const double *data,
+             double vmin, double vmax, const char *what)
+{
+  int i, j, x, y, failed = 0;
+  uint32_t got, want;
+
+  cairo_surface_flush (surface);
+
+  for (j = 0; j < NY; j++)
+    for (i = 0; i < NX; i++)
+      {
+        /* sample the centre of each cell; device y runs downwards */
+        x = i*CELL + CELL/2;
+        y = (NY - 1 - j)*CELL + CELL/2;
+        got  = test_pixel (surface, x, y);
+        want = test_expected_pixel (data[j*NX + i], vmin, vmax);
+        if (got != want)
+          {
+            fprintf (stderr, "%s: cell (%d,%d) got %08x, expected %08x\n",
+                     what, i, j, (unsigned) got, (unsigned) want);
+            failed++;
+          }
+      }
+  return failed;
+}
@@ -0,0 +1,133 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that images reduced to the device resolution are coloured with
+ * the nearest, mean, minimum or maximum of the data in each device pixel */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+
+#define NPIX 40
+#define BLOCK 10
+#define NDATA (NPIX*BLOCK)
+
+static double reduce (const double *data, int bi, int bj, int mode);
+
+int
+main (void)
+{
+  static double data[NDATA*NDATA];
+  static const char *names[] = { "none", "nearest", "mean", "min", "max" };
+  cairo_surface_t *surface;
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+  int i, j, bi, bj, mode, failed = 0;
+  uint32_t got, want;
+
+  giza_start_warnings ();
+
+  surface = test_device_begin (NPIX, NPIX);
+  if (!surface)
+    {
+      fprintf (stderr, "Error: could not draw on a cairo device\n");
+      return EXIT_FAILURE;
+    }
+  giza_set_window (0., NDATA, 0., NDATA);
+
+  giza_get_image_resample (&mode);
+  if (mode != GIZA_RESAMPLE_NONE)
+    {
+      fprintf (stderr, "Error: resampling is on by default\n");
+      failed++;
+    }
+
+  /* a different level in each device pixel, with some structure and
+   * blanked pixels inside, but none at the centre */
+  for (j = 0; j < NDATA; j++)
+    for (i = 0; i < NDATA; i++)
+      {
+        bi = i / BLOCK;
+        bj = j / BLOCK;
+        data[j*NDATA + i] = 0.05 + 0.9 * ((bi*7 + bj*13) % NPIX) / NPIX
+                            + 0.003 * ((i*3 + j*5) % 7);
+        if ((i + 2*j) % 23 == 0 && i % BLOCK != BLOCK/2)
+          data[j*NDATA + i] = NAN;
+      }
+
+  for (mode = GIZA_RESAMPLE_NEAREST; mode <= GIZA_RESAMPLE_MAX; mode++)
+    {
+      giza_set_image_resample (mode);
+      giza_render (NDATA, NDATA, data, 0, NDATA-1, 0, NDATA-1, 0., 1.,
+                   GIZA_EXTEND_NONE, GIZA_FILTER_BEST, affine);
+
+      cairo_surface_flush (surface);
+      for (bj = 0; bj < NPIX; bj++)
+        for (bi = 0; bi < NPIX; bi++)
+          {
+            /* device y runs downwards */
+            got  = test_pixel (surface, bi, NPIX - 1 - bj);
+            want = test_expected_pixel (reduce (data, bi, bj, mode), 0., 1.);
+            if (got != want)
+              {
+                fprintf (stderr, "%s: pixel (%d,%d) got %08x, expected %08x\n",
+                         names[mode], bi, bj, (unsigned) got, (unsigned) want);
+                failed++;
+              }
+          }
+    }
+
+  giza_set_image_resample (GIZA_RESAMPLE_MAX + 1);
+  giza_get_image_resample (&mode);
+  if (mode != GIZA_RESAMPLE_MAX)
+    {
+      fprintf (stderr, "Error: invalid resampling mode was accepted\n");
+      failed++;
+    }
+
+  cairo_surface_destroy (test_device_end (surface));
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* the data in device pixel (bi,bj), reduced the long way round */
+static double
+reduce (const double *data, int bi, int bj, int mode)
+{
+  double val, sum = 0., best = NAN;
+  int i, j, n = 0;
+
+  if (mode == GIZA_RESAMPLE_NEAREST)
+    return data[(bj*BLOCK + BLOCK/2)*NDATA + bi*BLOCK + BLOCK/2];
+
+  for (j = bj*BLOCK; j < (bj + 1)*BLOCK; j++)
+    for (i = bi*BLOCK; i < (bi + 1)*BLOCK; i++)
+      {
+        val = data[j*NDATA + i];
+        if (isnan (val))
+          continue;
+        sum += val;
+        n++;
+        if (isnan (best) || (mode == GIZA_RESAMPLE_MIN ? val < best : val > best))
+          best = val;
+      }
+  return (mode == GIZA_RESAMPLE_MEAN) ? sum / n : best;
+}
@@ -0,0 +1,99 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that images rendered with several threads are identical to
+ * those rendered with one */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 700
+#define NY 500
+
+static cairo_surface_t *render_with_threads (int nthreads, const double *data,
+                                             const float *fdata, const double *alpha);
+
+int
+main (void)
+{
+  static double data[NX*NY], alpha[NX*NY];
+  static float fdata[NX*NY];
+  cairo_surface_t *serial, *parallel;
+  int i, nthreads, failed = 0;
+
+  giza_start_warnings ();
+
+  for (i = 0; i < NX*NY; i++)
+    {
+      data[i] = rand () / (double) RAND_MAX;
+      fdata[i] = (float) data[i];
+      alpha[i] = (i % 5) / 4.;
+    }
+
+  serial = render_with_threads (1, data, fdata, alpha);
+  for (nthreads = 2; nthreads <= 7; nthreads += 5)
+    {
+      parallel = render_with_threads (nthreads, data, fdata, alpha);
+      if (test_surfaces_differ (serial, parallel))
+        {
+          fprintf (stderr, "Error: image rendered with %d threads differs from serial\n",
+                   nthreads);
+          failed++;
+        }
+      if (parallel)
+        cairo_surface_destroy (parallel);
+      giza_get_num_threads (&i);
+      if (i != nthreads)
+        {
+          fprintf (stderr, "Error: giza_get_num_threads gave %d, expected %d\n", i, nthreads);
+          failed++;
+        }
+    }
+  if (serial)
+    cairo_surface_destroy (serial);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static cairo_surface_t *
+render_with_threads (int nthreads, const double *data, const float *fdata,
+                     const double *alpha)
+{
+  cairo_surface_t *surface;
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+  float faffine[6] = { 1.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+
+  giza_set_num_threads (nthreads);
+  surface = test_device_begin (NX, NY);
+  if (!surface)
+    return NULL;
+  giza_set_window (0., NX, 0., NY);
+  giza_render (NX, NY, data, 0, NX-1, 0, NY-1, 0.1, 0.9,
+               GIZA_EXTEND_PAD, GIZA_FILTER_NEAREST, affine);
+  giza_set_image_transfer_function (1);
+  giza_render_transparent_float (NX, NY, fdata, 0, NX-1, 0, NY/2, 0.2f, 0.8f,
+                                 GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, faffine);
+  giza_set_image_transfer_function (2);
+  giza_render_alpha (NX, NY, data, alpha, NX/3, NX-1, 0, NY-1, 1., 0.,
+                     GIZA_EXTEND_NONE, GIZA_FILTER_NEAREST, affine);
+
+  return test_device_end (surface);
+}
@@ -0,0 +1,158 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that images rendered a tile at a time, from a callback or a raw
+ * file, match images rendered in one go, with no seams between tiles */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* several tiles across, one up */
+#define NX 4500
+#define NY 120
+#define DATAFILE "test-render-tiled.dat"
+
+typedef struct
+{
+  const float *data;
+  int calls;
+} source_t;
+
+static int read_tile (void *user, int i1, int i2, int j1, int j2, void *tile);
+static cairo_surface_t *draw (int how, int devx, int filter, const float *data, source_t *src);
+static int compare (cairo_surface_t *a, cairo_surface_t *b, int tol, const char *what);
+
+int
+main (void)
+{
+  static float data[NX*NY];
+  static const int filters[] = { GIZA_FILTER_NEAREST, GIZA_FILTER_BILINEAR, GIZA_FILTER_GOOD };
+  static const char *names[] = { "nearest", "bilinear", "good" };
+  cairo_surface_t *whole, *tiled;
+  source_t src;
+  FILE *fp;
+  int i, k, failed = 0;
+
+  giza_start_warnings ();
+
+  for (i = 0; i < NX*NY; i++)
+    data[i] = (float) ((i % 97) / 97. + (i / NX) / (2.*NY));
+  src.data = data;
+
+  /* one data pixel per device pixel, then reduced five times across */
+  for (k = 0; k < 3; k++)
+    {
+      whole = draw (0, NX, filters[k], data, &src);
+      tiled = draw (1, NX, filters[k], data, &src);
+      failed += compare (whole, tiled, 0, names[k]);
+      cairo_surface_destroy (tiled);
+      cairo_surface_destroy (whole);
+
+      whole = draw (0, NX/5, filters[k], data, &src);
+      tiled = draw (1, NX/5, filters[k], data, &src);
+      failed += compare (whole, tiled, (filters[k] == GIZA_FILTER_NEAREST) ? 0 : 2, names[k]);
+      cairo_surface_destroy (tiled);
+      cairo_surface_destroy (whole);
+    }
+  if (src.calls < 3)
+    {
+      fprintf (stderr, "Error: image was read in %d tiles\n", src.calls);
+      failed++;
+    }
+
+  fp = fopen (DATAFILE, "wb");
+  if (!fp || fwrite (data, sizeof (float), NX*NY, fp) != NX*NY)
+    {
+      fprintf (stderr, "Error: could not write %s\n", DATAFILE);
+      return EXIT_FAILURE;
+    }
+  fclose (fp);
+  whole = draw (0, NX, GIZA_FILTER_NEAREST, data, &src);
+  tiled = draw (2, NX, GIZA_FILTER_NEAREST, data, &src);
+  failed += compare (whole, tiled, 0, "file");
+  cairo_surface_destroy (tiled);
+  cairo_surface_destroy (whole);
+  remove (DATAFILE);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int
+read_tile (void *user, int i1, int i2, int j1, int j2, void *tile)
+{
+  source_t *src = (source_t *) user;
+  float *dest = (float *) tile;
+  int j;
+
+  for (j = j1; j <= j2; j++)
+    {
+      memcpy (dest, src->data + (size_t) j * NX + i1, (i2 - i1 + 1) * sizeof (float));
+      dest += i2 - i1 + 1;
+    }
+  src->calls++;
+  return 0;
+}
+
+/* how is 0 for giza_render_float, 1 for giza_render_tiled and 2 for giza_render_file */
+static cairo_surface_t *
+draw (int how, int devx, int filter, const float *data, source_t *src)
+{
+  cairo_surface_t *surface;
+  float faffine[6] = { 1.f, 0.f, 0.f, 1.f, 0.f, 0.f };
+  double affine[6] = { 1., 0., 0., 1., 0., 0. };
+
+  surface = test_device_begin (devx, NY);
+  giza_set_window (0., NX, 0., NY);
+
+  if (how == 0)
+    giza_render_float (NX, NY, data, 0, NX-1, 0, NY-1, 0.1f, 0.9f,
+                       GIZA_EXTEND_PAD, filter, faffine);
+  else if (how == 1)
+    giza_render_tiled (NX, NY, GIZA_DATA_FLOAT, read_tile, src, 0, NX-1, 0, NY-1, 0.1, 0.9,
+                       GIZA_EXTEND_PAD, filter, affine);
+  else
+    giza_render_file (DATAFILE, 0, GIZA_DATA_FLOAT, NX, NY, 0, NX-1, 0, NY-1, 0.1, 0.9,
+                      GIZA_EXTEND_PAD, filter, affine);
+
+  return test_device_end (surface);
+}
+
+/* compares two surfaces, allowing each channel to differ by tol */
+static int
+compare (cairo_surface_t *a, cairo_surface_t *b, int tol, const char *what)
+{
+  unsigned char *pa = cairo_image_surface_get_data (a);
+  unsigned char *pb = cairo_image_surface_get_data (b);
+  size_t k, n = (size_t) cairo_image_surface_get_stride (a) * cairo_image_surface_get_height (a);
+
+  for (k = 0; k < n; k++)
+    {
+      if (abs ((int) pa[k] - (int) pb[k]) > tol)
+        {
+          fprintf (stderr, "%s: tiled image differs at byte %lu of %d pixels across (%d vs %d)\n",
+                   what, (unsigned long) k, cairo_image_surface_get_width (a),
+                   (int) pa[k], (int) pb[k]);
+          return 1;
+        }
+    }
+  return 0;
+}
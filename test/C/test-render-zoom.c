@@ -0,0 +1,109 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks that zooming in on part of a large image, where only the pixels
+ * that can be seen are coloured, draws the same as a persistent image,
+ * which always colours every pixel */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NX 1500
+#define NY 1200
+#define DX 80
+#define DY 60
+
+static cairo_surface_t *draw (int image, const double *data, const double *window,
+                              int extend, int filter, const double *affine);
+
+int
+main (void)
+{
+  static double data[NX*NY];
+  static const double windows[3][4] = {
+    { 700., 740., 500., 530. },    /* inside the image */
+    { -10., 30., 1180., 1210. },   /* over a corner */
+    { 2000., 2040., 500., 530. }   /* off the image */
+  };
+  double affine[2][6] = {
+    { 1., 0., 0., 1., 0., 0. },
+    { 0.8, 0.3, -0.2, 0.9, 300., -50. }
+  };
+  static const int filters[2] = { GIZA_FILTER_NEAREST, GIZA_FILTER_BILINEAR };
+  static const int extends[2] = { GIZA_EXTEND_NONE, GIZA_EXTEND_PAD };
+  cairo_surface_t *want, *got;
+  int i, image, w, a, f, e, failed = 0;
+
+  giza_start_warnings ();
+
+  if (giza_open_device_size_cairo (DX, DY, GIZA_UNITS_PIXELS) <= 0)
+    {
+      fprintf (stderr, "Error: giza_open_device_size_cairo failed\n");
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < NX*NY; i++)
+    data[i] = sin (0.05 * (i % NX)) * cos (0.07 * (i / NX));
+
+  for (a = 0; a < 2; a++)
+    {
+      image = giza_image_create (NX, NY, data, 0, NX-1, 0, NY-1, -1., 1., 0);
+      for (w = 0; w < 3; w++)
+        for (f = 0; f < 2; f++)
+          for (e = 0; e < 2; e++)
+            {
+              want = draw (image, data, windows[w], extends[e], filters[f], affine[a]);
+              got = draw (0, data, windows[w], extends[e], filters[f], affine[a]);
+              if (test_surfaces_differ (want, got))
+                {
+                  fprintf (stderr, "Error: zoomed image differs (affine %d, window %d, "
+                           "filter %d, extend %d)\n", a, w, filters[f], extends[e]);
+                  failed++;
+                }
+              cairo_surface_destroy (want);
+              cairo_surface_destroy (got);
+            }
+      giza_image_destroy (image);
+    }
+
+  giza_close_device ();
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* draws the persistent image, or renders the data if image is 0 */
+static cairo_surface_t *
+draw (int image, const double *data, const double *window,
+      int extend, int filter, const double *affine)
+{
+  cairo_surface_t *surface;
+
+  surface = test_surface_begin (DX, DY);
+  giza_set_window (window[0], window[1], window[2], window[3]);
+
+  if (image)
+    giza_image_draw (image, extend, filter, affine);
+  else
+    giza_render (NX, NY, data, 0, NX-1, 0, NY-1, -1., 1., extend, filter, affine);
+
+  return test_surface_end (surface);
+}
@@ -0,0 +1,130 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+
+/* Checks giza_rgb_from_table and giza_rgb_from_table_array against
+ * interpolating the control points directly, including after the colour
+ * table is changed, saved and restored */
+
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NCP 200
+#define NPOS 5001
+
+static void reference (const double *cp, const double *red, int n, double pos, double *r);
+static int check (const double *cp, const double *red, const double *green, int n,
+                  const char *what);
+
+int
+main (void)
+{
+  static double cp[NCP], red[NCP], green[NCP], blue[NCP];
+  double cp2[2] = { 0., 1. }, ramp[2] = { 1., 0. };
+  int i, failed = 0;
+
+  giza_start_warnings ();
+
+  if (giza_open_device ("/null", "rgb-from-table") <= 0)
+    {
+      fprintf (stderr, "Error: giza_open_device failed\n");
+      return EXIT_FAILURE;
+    }
+
+  for (i = 0; i < NCP; i++)
+    {
+      /* unevenly spaced control points */
+      cp[i] = pow (i / (NCP - 1.), 1.7);
+      red[i] = 0.5 + 0.5 * sin (0.37 * i);
+      green[i] = (i % 7) / 6.;
+      blue[i] = 1. - red[i];
+    }
+
+  giza_set_colour_table (cp, red, green, blue, NCP, 1., 0.5);
+  failed += check (cp, red, green, NCP, "colour table");
+
+  giza_save_colour_table ();
+  giza_set_colour_table (cp2, ramp, cp2, ramp, 2, 1., 0.5);
+  failed += check (cp2, ramp, cp2, 2, "changed colour table");
+
+  giza_restore_colour_table ();
+  failed += check (cp, red, green, NCP, "restored colour table");
+
+  giza_close_device ();
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* linear interpolation of values between n increasing control points */
+static void
+reference (const double *cp, const double *val, int n, double pos, double *r)
+{
+  int i;
+
+  if (pos < cp[0])
+    {
+      *r = val[0];
+      return;
+    }
+  for (i = 1; i < n; i++)
+    if (pos < cp[i])
+      {
+        double d = cp[i] - cp[i-1];
+        double fraction = (pos - cp[i-1]) / d;
+        *r = val[i-1] + fraction * (val[i] - val[i-1]);
+        return;
+      }
+  *r = val[n-1];
+}
+
+static int
+check (const double *cp, const double *red, const double *green, int n, const char *what)
+{
+  static double pos[NPOS], r[NPOS], g[NPOS], b[NPOS];
+  double want, sr, sg, sb;
+  int k, failed = 0;
+
+  for (k = 0; k < NPOS; k++)
+    pos[k] = -0.1 + 1.2 * k / (NPOS - 1.);
+  giza_rgb_from_table_array (NPOS, pos, r, g, b);
+
+  for (k = 0; k < NPOS && !failed; k++)
+    {
+      giza_rgb_from_table (pos[k], &sr, &sg, &sb);
+      if (sr != r[k] || sg != g[k] || sb != b[k])
+        {
+          fprintf (stderr, "%s: array and single lookups differ at %g\n", what, pos[k]);
+          failed++;
+        }
+      reference (cp, red, n, pos[k], &want);
+      if (fabs (r[k] - want) > 1.e-12)
+        {
+          fprintf (stderr, "%s: red at %g is %g, expected %g\n", what, pos[k], r[k], want);
+          failed++;
+        }
+      reference (cp, green, n, pos[k], &want);
+      if (fabs (g[k] - want) > 1.e-12)
+        {
+          fprintf (stderr, "%s: green at %g is %g, expected %g\n", what, pos[k], g[k], want);
+          failed++;
+        }
+    }
+  return failed;
+}
@@ -0,0 +1,100 @@
+/* giza - a scientific plotting library built on cairo
+ *
+ * Copyright (c) 2010-2026 Daniel Price
+ *
+ * This library is free software; and you are welcome to redistribute
+ * it under the terms of the GNU Lesser General Public License
+ * (LGPL, see COPYING.LESSER file for details) and the provision that
+ * this notice remains intact. If you modify this file, please
+ * note section 2 of the LGPLv3 states that:
+ *
+ *  a) The work must carry prominent notices stating that you modified
+ *  it, and giving a relevant date.
+ *
+ * This software is distributed "AS IS", with ABSOLUTELY NO WARRANTY.
+ * See the LGPL for specific language governing rights and limitations.
+ *
+ * The Original code is the giza plotting library.
+ */
+/* Checks that streamlines integrated with several threads are drawn
+ * exactly as those integrated with one */
+
+#include "test-helpers.h"
+#include <giza.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NPIX 120
+#define WIDTH 600
+#define HEIGHT 600
+
+static cairo_surface_t *stream_with_threads (int nthreads, const double *u, const double *v,
+                                             const float *uf, const float *vf);
+
+int
+main (void)
+{
+  static double u[NPIX*NPIX], v[NPIX*NPIX];
+  static float uf[NPIX*NPIX], vf[NPIX*NPIX];
+  cairo_surface_t *serial, *parallel;
+  double x, y;
+  int i, j, nthreads, failed = 0;
+
+  giza_start_warnings ();
+
+  /* Orszag-Tang B field, with a blanked corner */
+  for (j = 0; j < NPIX; j++)
+    for (i = 0; i < NPIX; i++)
+      {
+        x = (i + 0.5) / NPIX;
+        y = (j + 0.5) / NPIX;
+        u[j*NPIX + i] = -sin (2. * M_PI * y);
+        v[j*NPIX + i] = sin (4. * M_PI * x);
+        if (x > 0.7 && y > 0.7)
+          {
+            u[j*NPIX + i] = 9999.;
+            v[j*NPIX + i] = 9999.;
+          }
+        uf[j*NPIX + i] = (float) (sin (9. * x * y) + cos (7. * y));
+        vf[j*NPIX + i] = (float) (cos (11. * x) - sin (5. * x * y));
+      }
+
+  serial = stream_with_threads (1, u, v, uf, vf);
+  for (nthreads = 2; nthreads <= 7; nthreads += 5)
+    {
+      parallel = stream_with_threads (nthreads, u, v, uf, vf);
+      if (test_surfaces_differ (serial, parallel))
+        {
+          fprintf (stderr, "Error: streamlines integrated with %d threads differ from serial\n",
+                   nthreads);
+          failed++;
+        }
+      if (parallel)
+        cairo_surface_destroy (parallel);
+    }
+  if (serial)
+    cairo_surface_destroy (serial);
+
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static cairo_surface_t *
+stream_with_threads (int nthreads, const double *u, const double *v,
+                     const float *uf, const float *vf)
+{
+  cairo_surface_t *surface;
+  double affine[6] = { 1./NPIX, 0., 0., 1./NPIX, 0., 0. };
+  float faffine[6] = { 1.f/NPIX, 0.f, 0.f, 1.f/NPIX, 0.f, 0.f };
+
+  giza_set_num_threads (nthreads);
+  surface = test_device_begin (WIDTH, HEIGHT);
+  if (!surface)
+    return NULL;
+  giza_set_window (0., 1., 0., 1.);
+  giza_streamplot (NPIX, NPIX, u, v, 0, NPIX-1, 0, NPIX-1, 4., affine, 9999.);
+  giza_set_colour_index (2);
+  giza_streamplot_float (NPIX, NPIX, uf, vf, 10, NPIX-11, 0, NPIX-1, 2.5f, faffine, 9999.f);
+
+  return test_device_end (surface);
+}